@@ -75,6 +75,8 @@ def amalgamate_source(source_top_dir=None,
     header.add_file(os.path.join(INCLUDE_PATH, "allocator.h"))
     header.add_file(os.path.join(INCLUDE_PATH, "config.h"))
     header.add_file(os.path.join(INCLUDE_PATH, "forwards.h"))
+    header.add_file(os.path.join(INCLUDE_PATH, "arena.h"))
+    header.add_file(os.path.join(INCLUDE_PATH, "segmented_array.h"))
     header.add_file(os.path.join(INCLUDE_PATH, "json_features.h"))
     header.add_file(os.path.join(INCLUDE_PATH, "value.h"))
     header.add_file(os.path.join(INCLUDE_PATH, "reader.h"))
@@ -124,6 +126,9 @@ def amalgamate_source(source_top_dir=None,
 """)
     source.add_text("")
     source.add_file(os.path.join(SRC_PATH, "json_tool.h"))
+    source.add_file(os.path.join(SRC_PATH, "json_double.h"))
+    source.add_file(os.path.join(SRC_PATH, "json_simd.h"))
+    source.add_file(os.path.join(SRC_PATH, "json_lazy.h"))
     source.add_file(os.path.join(SRC_PATH, "json_reader.cpp"))
     source.add_file(os.path.join(SRC_PATH, "json_valueiterator.inl"))
     source.add_file(os.path.join(SRC_PATH, "json_value.cpp"))
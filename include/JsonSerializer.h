@@ -24,8 +24,12 @@
 #define JSONSERIALIZER_H
 
 #include <json/json.h>
+#include <cstring>
+#include <deque>
+#include <map>
 #include <type_traits>
 #include <string>
+#include <vector>
 
 enum class SerializerMode
 {
@@ -61,7 +65,7 @@ private:
 	//Serialize using a free function defined for the type (default fallback)
 	template<typename TValue>
 	void SerializeImpl(TValue& value,
-					   typename std::enable_if<!HasSerialize<TValue>::value >::type* dummy = 0)
+					   typename std::enable_if<!HasSerialize<TValue>::value >::type* = 0)
 	{
 		//prototype for the serialize free function, so we will get a link error if it's missing
 		//this way we don't need a header with all the serialize functions for misc types (eg math)
@@ -72,37 +76,87 @@ private:
 
 	//Serialize using a member function Serialize(JsonSerializer&)
 	template<typename TValue>
-	void SerializeImpl(TValue& value, typename std::enable_if<HasSerialize<TValue>::value >::type* dummy = 0)
+	void SerializeImpl(TValue& value, typename std::enable_if<HasSerialize<TValue>::value >::type* = 0)
 	{
 		value.Serialize(*this);
 	}
 	
+	//A serializer for a member of this one: it writes straight into the member,
+	//or reads the member in place, without copying it
+	JsonSerializer(Json::Value* target, const Json::Value* source)
+		: IsWriter(target != nullptr), Target(target), Source(source)
+	{ }
+
+	//Begin writing a new member, dropping what was there
+	template<typename TKey>
+	Json::Value& NewMember(TKey key)
+	{
+		Json::Value& member = (*Target)[key];
+		member = Json::Value();
+		return member;
+	}
+
+	//Find a member for reading, without adding it to the source like operator[]
+	const Json::Value* Find(const char* key) const
+	{
+		if(!Source->isObject())
+			return nullptr;
+		return Source->find(key, key + strlen(key));
+	}
+
+	const Json::Value* Find(const std::string& key) const
+	{
+		if(!Source->isObject())
+			return nullptr;
+		return Source->find(key.data(), key.data() + key.size());
+	}
+
+	template<typename TIndex>
+	const Json::Value* Find(TIndex index, typename std::enable_if<std::is_integral<TIndex>::value >::type* = 0) const
+	{
+		if(!Source->isArray() || !Source->isValidIndex(Json::ArrayIndex(index)))
+			return nullptr;
+		return &(*Source)[Json::ArrayIndex(index)];
+	}
+
 public:
 	JsonSerializer(bool isWriter)
-	: IsWriter(isWriter)
+	: IsWriter(isWriter), Target(&JsonValue), Source(&JsonValue)
 	{ }
 	JsonSerializer(bool isWriter, Json::Value value)
-		: IsWriter(isWriter), JsonValue(value)
+		: JsonValue(std::move(value)), IsWriter(isWriter), Target(&JsonValue), Source(&JsonValue)
 	{ }
 	JsonSerializer(SerializerMode mode)
-		: IsWriter(mode == SerializerMode::Writer)
+		: IsWriter(mode == SerializerMode::Writer), Target(&JsonValue), Source(&JsonValue)
 	{ }
+	//Copies own what they serialize, like the serializer they copy
+	JsonSerializer(const JsonSerializer& other)
+		: JsonValue(other.IsWriter ? *other.Target : *other.Source), IsWriter(other.IsWriter), Target(&JsonValue), Source(&JsonValue)
+	{ }
+	JsonSerializer& operator=(const JsonSerializer& other)
+	{
+		if(this != &other)
+		{
+			JsonValue = other.IsWriter ? *other.Target : *other.Source;
+			IsWriter = other.IsWriter;
+			Target = &JsonValue;
+			Source = &JsonValue;
+		}
+		return *this;
+	}
 
 	template<typename TKey, typename TValue>
-	void Serialize(TKey key, TValue& value, typename std::enable_if<std::is_class<TValue>::value >::type* dummy = 0)
+	void Serialize(TKey key, TValue& value, typename std::enable_if<std::is_class<TValue>::value >::type* = 0)
 	{
-		JsonSerializer subVal(IsWriter);
-		if(!IsWriter)
+		if(IsWriter)
 		{
-			subVal.JsonValue = JsonValue[key];
-			if(subVal.JsonValue.isNull())
-				return;
+			JsonSerializer(&NewMember(key), nullptr).SerializeImpl(value);
+			return;
 		}
-		
-		subVal.SerializeImpl(value);
-		
-		if(IsWriter)
-			JsonValue[key] = subVal.JsonValue;
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
+			return;
+		JsonSerializer(nullptr, found).SerializeImpl(value);
 	}
 		
 	//Serialize a string value
@@ -117,7 +171,7 @@ public:
 	
 	//Serialize a non class type directly using JsonCpp
 	template<typename TKey, typename TValue>
-	void Serialize(TKey key, TValue& value, typename std::enable_if<std::is_fundamental<TValue>::value >::type* dummy = 0)
+	void Serialize(TKey key, TValue& value, typename std::enable_if<std::is_fundamental<TValue>::value >::type* = 0)
 	{
 		if(IsWriter)
 			Write(key, value);
@@ -127,7 +181,7 @@ public:
 	
 	//Serialize an enum type to JsonCpp 
 	template<typename TKey, typename TEnum>
-	void Serialize(TKey key, TEnum& value, typename std::enable_if<std::is_enum<TEnum>::value >::type* dummy = 0)
+	void Serialize(TKey key, TEnum& value, typename std::enable_if<std::is_enum<TEnum>::value >::type* = 0)
 	{
 		int ival = (int) value;
 		if(IsWriter)
@@ -143,7 +197,7 @@ public:
 	
 	//Serialize only when writing (saving), useful for r-values
 	template<typename TKey, typename TValue>
-	void WriteOnly(TKey key, TValue value, typename std::enable_if<std::is_fundamental<TValue>::value >::type* dummy = 0)
+	void WriteOnly(TKey key, TValue value, typename std::enable_if<std::is_fundamental<TValue>::value >::type* = 0)
 	{
 		if(IsWriter)
 			Write(key, value);
@@ -156,19 +210,19 @@ public:
 		if(!IsWriter)
 			return;
 		
-		JsonSerializer subVal(IsWriter);
+		Json::Value& array = NewMember(key);
+		array = Json::arrayValue;
+		JsonSerializer subVal(&array, nullptr);
 		int index = 0;
-		subVal.JsonValue = Json::arrayValue;
 		for(TItor it = first; it != last; ++it)
 		{
 			subVal.Serialize(index, *it);
 			++index;
 		}
-		JsonValue[key] = subVal.JsonValue;
 	}
 	
 	template<typename TKey, typename TValue>
-	void ReadOnly(TKey key, TValue& value, typename std::enable_if<std::is_fundamental<TValue>::value >::type* dummy = 0)
+	void ReadOnly(TKey key, TValue& value, typename std::enable_if<std::is_fundamental<TValue>::value >::type* = 0)
 	{
 		if(!IsWriter)
 			Read(key, value);
@@ -179,16 +233,16 @@ public:
 	{
 		if(IsWriter)
 			return;
-		if(!JsonValue.isArray())
+		if(!Source->isArray())
 			return;
 		
 		vec.clear();
-		vec.reserve(vec.size() + JsonValue.size());
-		for(int i = 0; i < JsonValue.size(); ++i)
+		vec.reserve(vec.size() + Source->size());
+		for(int i = 0; i < int(Source->size()); ++i)
 		{
-			TValue val;
+			TValue val{};
 			Serialize(i, val);
-			vec.push_back(val);
+			vec.push_back(std::move(val));
 		}
 	}
 	
@@ -201,9 +255,9 @@ public:
 		}
 		else
 		{
-			JsonSerializer subVal(IsWriter);
-			subVal.JsonValue = JsonValue[key];
-			subVal.ReadOnly(vec);
+			const Json::Value* found = Find(key);
+			if(found)
+				JsonSerializer(nullptr, found).ReadOnly(vec);
 		}
 	}
 	
@@ -212,15 +266,15 @@ public:
 	{
 		if(IsWriter)
 			return;
-		if(!JsonValue.isArray())
+		if(!Source->isArray())
 			return;
 		
 		dq.clear();
-		for(int i = 0; i < JsonValue.size(); ++i)
+		for(int i = 0; i < int(Source->size()); ++i)
 		{
-			TValue val;
+			TValue val{};
 			Serialize(i, val);
-			dq.push_back(val);
+			dq.push_back(std::move(val));
 		}
 	}
 	
@@ -233,9 +287,9 @@ public:
 		}
 		else
 		{
-			JsonSerializer subVal(IsWriter);
-			subVal.JsonValue = JsonValue[key];
-			subVal.ReadOnly(dq);
+			const Json::Value* found = Find(key);
+			if(found)
+				JsonSerializer(nullptr, found).ReadOnly(dq);
 		}
 	}
 	
@@ -244,18 +298,16 @@ public:
 	{
 		if(IsWriter)
 			return;
-		if(!JsonValue.isObject())
+		if(!Source->isObject())
 			return;
 
 		m.clear();
-		for(auto it = JsonValue.begin(); it != JsonValue.end(); ++it)
+		for(auto it = Source->begin(); it != Source->end(); ++it)
 		{
-			JsonSerializer subVal(IsWriter);
-			subVal.JsonValue = *it;
-			std::string key = it.key().asString();
-			TValue value;
+			std::string key = it.name();
+			TValue value{};
 			Serialize(key, value);
-			m[key] = value;
+			m[key] = std::move(value);
 		}
 	}
 
@@ -265,12 +317,11 @@ public:
 		if(!IsWriter)
 			return;
 		
-		JsonSerializer subVal(IsWriter);
+		JsonSerializer subVal(&NewMember(key), nullptr);
 		for(auto it = m.begin(); it != m.end(); ++it)
 		{
 			subVal.Serialize(it->first, it->second);
 		}
-		JsonValue[key] = subVal.JsonValue;
 	}
 
 	template<typename TKey, typename TValue>
@@ -282,9 +333,9 @@ public:
 		}
 		else
 		{
-			JsonSerializer subVal(IsWriter);
-			subVal.JsonValue = JsonValue[key];
-			subVal.ReadOnly(m);
+			const Json::Value* found = Find(key);
+			if(found)
+				JsonSerializer(nullptr, found).ReadOnly(m);
 		}
 	}
 
@@ -292,24 +343,25 @@ public:
 	template<typename TKey>
 	void WriteOnly(TKey key, const Json::Value& value)
 	{
-		Write(key, value);
+		if(IsWriter)
+			(*Target)[key] = value;
 	}
 	
 	//Forward a pointer
 	template<typename TKey, typename TValue>
-	void Serialize(TKey key, TValue* value, typename std::enable_if<!std::is_fundamental<TValue>::value >::type* dummy = 0)
+	void Serialize(TKey key, TValue* value, typename std::enable_if<!std::is_fundamental<TValue>::value >::type* = 0)
 	{
 		Serialize(key, *value);
 	}
 	
 	template<typename TKey, typename TValue>
-	void WriteOnly(TKey key, TValue* value, typename std::enable_if<!std::is_fundamental<TValue>::value >::type* dummy = 0)
+	void WriteOnly(TKey key, TValue* value, typename std::enable_if<!std::is_fundamental<TValue>::value >::type* = 0)
 	{
 		Serialize(key, *value);
 	}
 	
 	template<typename TKey, typename TValue>
-	void ReadOnly(TKey key, TValue* value, typename std::enable_if<!std::is_fundamental<TValue>::value >::type* dummy = 0)
+	void ReadOnly(TKey key, TValue* value, typename std::enable_if<!std::is_fundamental<TValue>::value >::type* = 0)
 	{
 		ReadOnly(key, *value);
 	}
@@ -331,119 +383,132 @@ public:
 	bool IsWriter;
 	
 private:
+	//Where this writes to and reads from: JsonValue, or a member of the parent
+	Json::Value* Target;
+	const Json::Value* Source;
+	
 	template<typename TKey, typename TValue>
 	void Write(TKey key, TValue value)
 	{
-		JsonValue[key] = value;
+		(*Target)[key] = value;
 	}
 	
 	template<typename TKey>
 	void Write(TKey key, long value)
 	{
-		JsonValue[key] = (int) value;
+		(*Target)[key] = (int) value;
 	}
 	
 	template<typename TKey>
 	void Write(TKey key, unsigned long value)
 	{
-		JsonValue[key] = (unsigned int) value;
+		(*Target)[key] = Json::UInt64(value);
 	}
 	
 	template<typename TKey>
-	void Write(TKey key, size_t value)
+	void Write(TKey key, unsigned long long value)
 	{
-		JsonValue[key] = (unsigned int)value;
+		(*Target)[key] = Json::UInt64(value);
 	}
 
 	template<typename TKey, typename TValue>
-	void Read(TKey key, TValue& value, typename std::enable_if<std::is_arithmetic<TValue>::value >::type* dummy = 0)
+	void Read(TKey key, TValue& value, typename std::enable_if<std::is_arithmetic<TValue>::value >::type* = 0)
 	{
-		Json::Value subval = JsonValue[key];
-		if(subval.isNull())
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
 			return;
-		int ival = subval.asInt();
+		int ival = found->asInt();
 		value = (TValue) ival;
 	}
 	
 	template<typename TKey>
 	void Read(TKey key, bool& value)
 	{
-		Json::Value subval = JsonValue[key];
-		if(subval.isNull())
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
 			return;
-		value = subval.asBool();
+		value = found->asBool();
 	}
 	
 	template<typename TKey>
 	void Read(TKey key, int& value)
 	{
-		Json::Value subval = JsonValue[key];
-		if(subval.isNull())
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
 			return;
-		value = subval.asInt();
+		value = found->asInt();
 	}
 	
 	template<typename TKey>
 	void Read(TKey key, long& value)
 	{
-		Json::Value subval = JsonValue[key];
-		if(subval.isNull())
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
 			return;
-		value = subval.asInt();
+		value = found->asInt();
 	}
 	
 	template<typename TKey>
 	void Read(TKey key, unsigned int& value)
 	{
-		Json::Value subval = JsonValue[key];
-		if(subval.isNull())
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
 			return;
-		value = subval.asUInt();
+		value = found->asUInt();
 	}
 	
 	template<typename TKey>
 	void Read(TKey key, unsigned long& value)
 	{
-		Json::Value subval = JsonValue[key];
-		if(subval.isNull())
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
+			return;
+		value = (unsigned long) found->asUInt64();
+	}
+
+	template<typename TKey>
+	void Read(TKey key, unsigned long long& value)
+	{
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
 			return;
-		value = subval.asUInt();
+		value = found->asUInt64();
 	}
 
 	/*template<typename TKey>
 	void Read(TKey key, size_t& value)
 	{
-		Json::Value subval = JsonValue[key];
-		if(subval.isNull())
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
 			return;
-		value = subval.asUInt();
+		value = found->asUInt();
 	}*/
 
 	template<typename TKey>
 	void Read(TKey key, float& value)
 	{
-		Json::Value subval = JsonValue[key];
-		if(subval.isNull())
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
 			return;
-		value = subval.asFloat();
+		value = found->asFloat();
 	}
 	
 	template<typename TKey>
 	void Read(TKey key, double& value)
 	{
-		Json::Value subval = JsonValue[key];
-		if(subval.isNull())
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
 			return;
-		value = subval.asDouble();
+		value = found->asDouble();
 	}
 	
 	template<typename TKey>
 	void Read(TKey key, std::string& value)
 	{
-		Json::Value subval = JsonValue[key];
-		if(subval.isNull())
+		const Json::Value* found = Find(key);
+		if(!found || found->isNull())
 			return;
-		value = subval.asString();
+		value = found->asString();
 	}
 };
 
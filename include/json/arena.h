@@ -0,0 +1,125 @@
+// Copyright 2007-2010 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#ifndef JSON_ARENA_H_INCLUDED
+#define JSON_ARENA_H_INCLUDED
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "config.h"
+#endif // if !defined(JSON_IS_AMALGAMATION)
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+#pragma pack(push, 8)
+
+namespace Json {
+
+/** \brief Monotonic memory resource for whole-document Value trees.
+ *
+ * Memory is handed out by bumping a pointer through blocks obtained from
+ * global operator new. Giving memory back to an Arena does nothing: all of it
+ * is returned at once when the Arena is released or destroyed, so a tree
+ * allocated from it must not be used, or destroyed, after that.
+ *
+ * An Arena is not thread-safe.
+ *
+ * \sa ArenaAllocator, CharReader::parseInArena()
+ */
+class JSON_API Arena {
+public:
+  static constexpr size_t defaultBlockSize = 64 * 1024;
+
+  explicit Arena(size_t blockSize = defaultBlockSize);
+  ~Arena();
+  Arena(Arena const&) = delete;
+  Arena& operator=(Arena const&) = delete;
+
+  /// Return size bytes aligned on alignment, which must be a power of two.
+  void* allocate(size_t size, size_t alignment) {
+    size_t padding =
+        (0 - reinterpret_cast<uintptr_t>(cursor_)) & (alignment - 1);
+    if (size + padding > static_cast<size_t>(limit_ - cursor_))
+      return allocateBlock(size, alignment);
+    char* p = cursor_ + padding;
+    cursor_ = p + size;
+    return p;
+  }
+
+  /// Return all the memory handed out so far.
+  void release();
+
+  /// The number of bytes obtained from operator new and not yet released.
+  size_t capacity() const { return capacity_; }
+
+private:
+  struct Block {
+    Block* next;
+  };
+
+  void* allocateBlock(size_t size, size_t alignment);
+
+  size_t blockSize_;
+  size_t capacity_ = 0;
+  Block* blocks_ = nullptr;
+  char* cursor_ = nullptr;
+  char* limit_ = nullptr;
+};
+
+/** \brief Allocator taking its memory from an Arena, if it has one.
+ *
+ * A default-constructed ArenaAllocator uses global operator new and delete.
+ * Copies of a container do not inherit its Arena.
+ */
+template <typename T> class ArenaAllocator {
+public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  ArenaAllocator() = default;
+  explicit ArenaAllocator(Arena* arena) : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+  template <typename U> struct rebind { using other = ArenaAllocator<U>; };
+
+  T* allocate(size_t n) {
+    if (!arena_)
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_t) {
+    if (!arena_)
+      ::operator delete(p);
+  }
+
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+
+  Arena* arena() const { return arena_; }
+
+private:
+  Arena* arena_ = nullptr;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+  return a.arena() != b.arena();
+}
+
+} // namespace Json
+
+#pragma pack(pop)
+
+#endif // JSON_ARENA_H_INCLUDED
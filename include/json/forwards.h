@@ -34,6 +34,8 @@ class StaticString;
 class Path;
 class PathArgument;
 class Value;
+class NamePool;
+class ValuePool;
 class ValueIteratorBase;
 class ValueIterator;
 class ValueConstIterator;
@@ -11,6 +11,7 @@
 #include "value.h"
 #endif // if !defined(JSON_IS_AMALGAMATION)
 #include <deque>
+#include <functional>
 #include <iosfwd>
 #include <istream>
 #include <stack>
@@ -240,7 +241,43 @@ private:
   bool collectComments_{};
 }; // Reader
 
+/** \brief Receives the events of an event-driven (SAX-style) parse.
+ *
+ * CharReader::parseEvents() reports the document to a handler in document
+ * order instead of building a Value tree. Every callback returns \c true to
+ * continue or \c false to stop parsing. The default implementations ignore
+ * the event and continue, so a handler only overrides the events it needs.
+ *
+ * Strings and member names are passed as [begin, end) ranges that are only
+ * valid during the call and may contain embedded zeroes.
+ */
+class JSON_API ParseHandler {
+public:
+  virtual ~ParseHandler();
+  virtual bool onNull();
+  virtual bool onBool(bool value);
+  virtual bool onInt(LargestInt value);
+  virtual bool onUInt(LargestUInt value);
+  virtual bool onDouble(double value);
+  virtual bool onString(char const* begin, char const* end);
+  virtual bool onStartObject();
+  virtual bool onKey(char const* begin, char const* end);
+  virtual bool onEndObject();
+  virtual bool onStartArray();
+  virtual bool onEndArray();
+};
+
 /** Interface for reading JSON from a char array.
+ *
+ * A CharReader can be kept and reused for any number of documents, which
+ * saves creating one per document in a loop. Each call of parse(),
+ * parseEvents(), parseStream() or parseInArena() starts from a clean state:
+ * the position, the errors, the pending comments and the stack of values of
+ * the previous call are reset, and nothing of the previous document or root
+ * is referenced. Only the capacity of scratch buffers, and the names shared
+ * by `"internKeys"`, are kept from one call to the next. A CharReader must
+ * not be used by two threads at once.
+ * \sa threadLocalCharReader()
  */
 class JSON_API CharReader {
 public:
@@ -264,6 +301,84 @@ public:
   virtual bool parse(char const* beginDoc, char const* endDoc, Value* root,
                      String* errs) = 0;
 
+  /** \brief Read a JSON document, reporting it to a handler as a sequence of
+   * events instead of building a Value.
+   *
+   * Parsing stops at the first error, or as soon as a callback of handler
+   * returns \c false, which is reported as an error too. Events already
+   * delivered are not taken back.
+   *
+   * The default implementation parses the document into a Value and replays
+   * it; the readers built by CharReaderBuilder read the events directly,
+   * with the same settings as parse().
+   *
+   * \param      beginDoc Pointer on the beginning of the UTF-8 encoded string
+   *                      of the document to read.
+   * \param      endDoc   Pointer on the end of the UTF-8 encoded string of the
+   *                      document to read. Must be >= beginDoc.
+   * \param      handler  Receives the events.
+   * \param[out] errs     Formatted error messages (if not NULL).
+   * \return \c true if the whole document was read, \c false otherwise.
+   */
+  virtual bool parseEvents(char const* beginDoc, char const* endDoc,
+                           ParseHandler* handler, String* errs);
+
+  /** \brief Read a Value from a JSON document in a stream.
+   *
+   * The default implementation reads the whole stream into memory and calls
+   * parse(). The readers built by CharReaderBuilder read it in blocks of
+   * `"streamBlockSize"` bytes instead, keeping only the part of the document
+   * that is still needed, so that memory use is bounded by the size of the
+   * tree plus about one block. Unless `"failIfExtra"` is set, they stop at
+   * the first token after the document (and the comments following it).
+   * The bytes of the last block from there on are given back by seeking the
+   * stream, so the caller can read them, unless the stream cannot seek
+   * (like a pipe), in which case they are lost. They never borrow strings
+   * from the stream.
+   *
+   * \param      sin  The stream to read the UTF-8 encoded document from.
+   * \param[out] root Contains the root value of the document if it was
+   *                  successfully parsed.
+   * \param[out] errs Formatted error messages (if not NULL).
+   * \return \c true if the document was successfully parsed, \c false if an
+   * error occurred.
+   */
+  virtual bool parseStream(IStream& sin, Value* root, String* errs);
+
+  /** \brief Read a Value from a JSON document, allocating it from an Arena.
+   *
+   * Like parse(), but the arrays, objects, member names and strings of the
+   * document take their memory from arena, so that building the tree only
+   * bumps a pointer and destroying it frees nothing until arena is released.
+   * arena must outlive root and every value of the tree; values copied out of
+   * it are allocated normally. Objects with hashed member lookup, borrowed
+   * strings and comments do not use arena.
+   *
+   * The default implementation ignores arena and calls parse().
+   *
+   * \param      beginDoc Pointer on the beginning of the UTF-8 encoded string
+   *                      of the document to read.
+   * \param      endDoc   Pointer on the end of the UTF-8 encoded string of the
+   *                      document to read. Must be >= beginDoc.
+   * \param      arena    Provides the memory of the tree.
+   * \param[out] root     Contains the root value of the document if it was
+   *                      successfully parsed.
+   * \param[out] errs     Formatted error messages (if not NULL).
+   * \return \c true if the document was successfully parsed, \c false if an
+   * error occurred.
+   */
+  virtual bool parseInArena(char const* beginDoc, char const* endDoc,
+                            Arena* arena, Value* root, String* errs);
+
+  /** \brief Whether the values read by parse() may refer to the document,
+   * which must then outlive them.
+   *
+   * The default implementation returns \c false. The readers built by
+   * CharReaderBuilder return \c true if `"borrowStrings"` or `"lazy"` is
+   * set.
+   */
+  virtual bool refersToDocument() const;
+
   class JSON_API Factory {
   public:
     virtual ~Factory() = default;
@@ -274,6 +389,63 @@ public:
   }; // Factory
 };   // CharReader
 
+/** \brief The settings of CharReaderBuilder as a struct.
+ *
+ * Each member has the meaning and the default of the setting of the same
+ * name (see CharReaderBuilder::settings_). A reader made from it by
+ * newCharReader(CharReaderOptions const&) looks no setting up by name, and a
+ * misspelt option does not compile:
+ *   \code
+ *   Json::CharReaderOptions options;
+ *   options.allowComments = false;
+ *   std::unique_ptr<Json::CharReader> reader(Json::newCharReader(options));
+ *   \endcode
+ * It is a literal type, so options can be constants:
+ *   \code
+ *   constexpr auto strict = Json::CharReaderOptions::strictMode();
+ *   \endcode
+ */
+struct JSON_API CharReaderOptions {
+  bool collectComments = true;
+  bool collectOffsets = false;
+  bool allowComments = true;
+  bool allowTrailingCommas = true;
+  bool strictRoot = false;
+  bool allowDroppedNullPlaceholders = false;
+  bool allowNumericKeys = false;
+  bool allowSingleQuotes = false;
+  unsigned stackLimit = 1000;
+  bool failIfExtra = false;
+  bool rejectDupKeys = false;
+  bool allowSpecialFloats = false;
+  bool skipBom = true;
+  bool hashObjectMembers = false;
+  bool borrowStrings = false;
+  bool internKeys = false;
+  bool internValues = false;
+  bool packNumbers = false;
+  bool lazy = false;
+  unsigned streamBlockSize = 65536;
+
+  CharReaderOptions() = default;
+
+  /// The options set by CharReaderBuilder::strictMode().
+  static constexpr CharReaderOptions strictMode() {
+    return CharReaderOptions(Strict());
+  }
+
+private:
+  struct Strict {};
+  constexpr explicit CharReaderOptions(Strict)
+      : allowComments(false), allowTrailingCommas(false), strictRoot(true),
+        failIfExtra(true), rejectDupKeys(true) {}
+};
+
+/** Allocate a CharReader via operator new(), with options instead of the
+ * settings of a CharReaderBuilder.
+ */
+JSON_API CharReader* newCharReader(CharReaderOptions const& options);
+
 /** \brief Build a CharReader implementation.
  *
  * Usage:
@@ -297,6 +469,12 @@ public:
    *   - true to collect comment and allow writing them back during
    *     serialization, false to discard comments.  This parameter is ignored
    *     if allowComments is false.
+   * - `"collectOffsets": false or true`
+   *   - true to record in each parsed value the range of bytes of the document
+   *     it was read from (see Value::getOffsetStart()), false to leave them
+   *     0. Like comments, offsets are kept out of the values, in a block
+   *     allocated for each value which has some, which costs time and
+   *     memory.
    * - `"allowComments": false or true`
    *   - true if comments are allowed.
    * - `"allowTrailingCommas": false or true`
@@ -324,6 +502,59 @@ public:
    * - `"allowSpecialFloats": false or true`
    *   - If true, special float values (NaNs and infinities) are allowed and
    *     their values are lossfree restorable.
+   * - `"hashObjectMembers": false or true`
+   *   - If true, every parsed object is created with hashed member lookup
+   *     (see Value::Value(ValueType, bool)), which speeds up find() and
+   *     isMember() on objects with many members.
+   * - `"borrowStrings": false or true`
+   *   - If true, string values and member names without escape sequences
+   *     refer to the parsed text instead of copies of it (see
+   *     Value::Value(const char*, const char*, bool)). The caller must then
+   *     keep the text alive and unchanged for as long as the resulting
+   *     values are used.
+   * - `"internKeys": false or true`
+   *   - If true, member names of 8 chars or more are shared through a
+   *     NamePool kept by the CharReader across parses, so records with the
+   *     same keys share one copy of each (see Value::demand(const char*,
+   *     const char*, NamePool&)). The pool stops growing at
+   *     NamePool::defaultMaxSize names.
+   * - `"internValues": false or true`
+   *   - If true, equal strings of 8 chars or more, arrays and objects of a
+   *     document share one payload, found by their hashes (see
+   *     Value::share(ValuePool&)), so a document which repeats the same
+   *     parts keeps one copy of each. The values are copied on the first
+   *     change as usual. Costs time for documents without repeated parts.
+   *     Ignored for the arrays and objects of `"lazy"` and for
+   *     CharReader::parseInArena().
+   * - `"packNumbers": false or true`
+   *   - If true, every parsed array whose elements are all integers that fit
+   *     in a LargestInt, or all reals, is stored as one buffer of numbers
+   *     (see Value::packNumbers()), which takes half the memory and which
+   *     Value::getReals() and Value::getLargestInts() return as is. Arrays
+   *     with comments on their elements, and all arrays when
+   *     `"collectOffsets"` is true, are left as they are. Accessing the
+   *     elements of a packed array as Values stores them as usual again, so
+   *     such an access must not be made by several threads at once. Ignored
+   *     if `"internValues"` is true, since sharing an array stores it as
+   *     usual, and for CharReader::parseInArena().
+   * - `"lazy": false or true`
+   *   - If true, arrays and objects are not read when the document is parsed.
+   *     The parse only finds where each of them ends, and the values it
+   *     returns keep that range of the text. An array or object is read the
+   *     first time its elements or members are accessed (by operator[],
+   *     find(), size(), begin(), comparisons, and so on), one level at a
+   *     time, so only the parts of the document which are used are ever
+   *     read. Otherwise the Value API works as usual. The caller must keep
+   *     the text alive and unchanged until every value of the tree has been
+   *     read or destroyed. Syntax errors inside an array or object are only
+   *     found when it is read, and are thrown as a RuntimeError then; comments
+   *     are not collected. Since reading changes the value, a lazy value must
+   *     not be accessed by several threads at once, even through const
+   *     member functions, until it has been read. Ignored by
+   *     CharReader::parseStream() and CharReader::parseInArena().
+   * - `"streamBlockSize": integer`
+   *   - The number of bytes CharReader::parseStream() reads from the stream at
+   *     a time.
    *
    * You can examine 'settings_` yourself to see the defaults. You can also
    * write and read them just like any JSON Value.
@@ -359,13 +590,139 @@ public:
   static void strictMode(Json::Value* settings);
 };
 
-/** Consume entire stream and use its begin/end.
- * Someday we might have a real StreamReader, but for now this
- * is convenient.
+/** Read a Value from a stream with a reader made by the factory.
+ * \sa CharReader::parseStream()
  */
 bool JSON_API parseFromStream(CharReader::Factory const&, IStream&, Value* root,
                               String* errs);
 
+/** Return a CharReader with the settings of builder, kept by the calling
+ * thread for reuse.
+ *
+ * The reader is built again only when called with different settings than
+ * the last time on this thread, so that hot loops get a reader without
+ * allocating one per document:
+ *   \code
+ *   for (auto const& line : lines)
+ *     ok = Json::threadLocalCharReader(builder).parse(
+ *         line.data(), line.data() + line.size(), &root, &errs);
+ *   \endcode
+ * The reference stays valid until the next call on the same thread, and
+ * must not be handed to other threads. Each call compares the settings, so
+ * code that can keep its own reader across the loop should do so.
+ */
+JSON_API CharReader& threadLocalCharReader(CharReaderBuilder const& builder);
+
+/** \brief The read-only contents of a file, memory-mapped where possible.
+ *
+ * Non-empty regular files are mapped into memory on POSIX systems, so their
+ * contents are neither copied nor read up front. Other files (pipes, devices,
+ * and any file on other systems) are read into a buffer instead.
+ *
+ * [begin(), end()) can be handed to CharReader::parse() and stays valid
+ * until the file is closed, which makes it suitable for the "borrowStrings"
+ * setting of CharReaderBuilder:
+ *   \code
+ *   Json::MappedFile file;
+ *   Json::String errs;
+ *   if (file.open("data.json", &errs))
+ *     ok = reader->parse(file.begin(), file.end(), &root, &errs);
+ *   // use root while file is open
+ *   \endcode
+ */
+class JSON_API MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /** Open the file at path, closing the one opened before.
+   * \return \c false, with an error message in errs (if not NULL), if the
+   * file cannot be read.
+   */
+  bool open(const String& path, String* errs);
+  void close();
+  /// True if the contents are mapped rather than read into a buffer.
+  bool isMapped() const { return mapped_; }
+  char const* begin() const { return begin_; }
+  char const* end() const { return begin_ + size_; }
+
+private:
+  char const* begin_ = nullptr;
+  size_t size_ = 0;
+  bool mapped_ = false;
+  String buffer_;
+};
+
+/** Read a Value from the file at path with a reader made by the factory.
+ *
+ * The file is opened as a MappedFile and parsed in place. It is closed before
+ * returning, so this fails, with an error message in errs, if the reader
+ * refers to its document (see CharReader::refersToDocument()); pass a
+ * MappedFile for such readers.
+ */
+bool JSON_API parseFromFile(CharReader::Factory const&, const String& path,
+                            Value* root, String* errs);
+/** Same as parseFromFile(CharReader::Factory const&, const String&, ...),
+ * but the file is opened in file, which the caller keeps open for as long as
+ * the values are used. Strings borrowed from the file and lazy arrays and
+ * objects then refer to it rather than to a copy.
+ */
+bool JSON_API parseFromFile(CharReader::Factory const&, const String& path,
+                            MappedFile* file, Value* root, String* errs);
+
+/** \brief Reads newline-delimited JSON (NDJSON, JSON Lines) in parallel.
+ *
+ * Every line of the input is an independent document, read with the settings
+ * of a CharReaderBuilder. The lines are spread over worker threads that each
+ * own a reader. Blank lines are skipped, and a '\\r' ending a line is ignored.
+ *
+ * Usage:
+ *   \code
+ *   Json::NdjsonReader reader(builder, 8);
+ *   std::vector<Json::NdjsonReader::Record> records;
+ *   bool ok = reader.parse(begin, end, &records);
+ *   \endcode
+ */
+class JSON_API NdjsonReader {
+public:
+  /// An error in a record; offsets are relative to the start of its line.
+  struct Error {
+    ptrdiff_t offset_start;
+    ptrdiff_t offset_limit;
+    String message;
+  };
+  struct Record {
+    size_t line = 0; ///< 1-based line number in the input.
+    Value value;
+    std::vector<Error> errors; ///< Empty if the record was read successfully.
+  };
+  using Callback = std::function<void(Record& record)>;
+
+  /// \param threads The number of worker threads, or 0 for one per hardware
+  /// thread.
+  explicit NdjsonReader(CharReaderBuilder const& builder, unsigned threads = 0);
+
+  /** Read the records of [beginDoc, endDoc) into records, in input order.
+   * \return \c true if every record was read successfully.
+   */
+  bool parse(char const* beginDoc, char const* endDoc,
+             std::vector<Record>* records) const;
+  /** Read the records of [beginDoc, endDoc), passing each one to callback as
+   * soon as it is read, in no particular order. The calls come from the
+   * worker threads, one at a time. An exception thrown by callback stops the
+   * reading and is rethrown.
+   * \return \c true if every record was read successfully.
+   */
+  bool parse(char const* beginDoc, char const* endDoc,
+             Callback const& callback) const;
+
+private:
+  Value settings_;
+  unsigned threads_;
+};
+
 /** \brief Read from 'sin' into 'root'.
  *
  * Always keep comments from the input JSON.
@@ -0,0 +1,271 @@
+// Copyright 2007-2010 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#ifndef JSON_SEGMENTED_ARRAY_H_INCLUDED
+#define JSON_SEGMENTED_ARRAY_H_INCLUDED
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include "config.h"
+#endif // if !defined(JSON_IS_AMALGAMATION)
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#pragma pack(push, 8)
+
+namespace Json {
+
+/** \brief Sequence container whose elements never move once created.
+ *
+ * Elements are kept in segments which double in size: the first holds 4
+ * elements, the next 8, and so on. Growing the array adds segments rather
+ * than moving the elements, so, as with the std::map which arrays used to be
+ * stored in, references to elements stay valid until the elements are
+ * removed. Indexing takes constant time, and most elements of a large array
+ * sit in its last few segments, contiguously.
+ *
+ * insert() and erase() shift the values of the following elements by move
+ * assignment, so a reference keeps referring to the element at its index.
+ */
+template <typename T, typename Allocator = std::allocator<T>>
+class SegmentedArray {
+  using Traits = std::allocator_traits<Allocator>;
+  using TableAllocator = typename Traits::template rebind_alloc<T*>;
+  using TableTraits = std::allocator_traits<TableAllocator>;
+
+public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+  using reference = T&;
+  using const_reference = const T&;
+
+  template <typename Array, typename Value> class Iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    Iterator() = default;
+    Iterator(Array* array, size_t index) : array_(array), index_(index) {}
+    reference operator*() const { return (*array_)[index_]; }
+    pointer operator->() const { return &(*array_)[index_]; }
+    Iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old(*this);
+      ++index_;
+      return old;
+    }
+    bool operator==(const Iterator& other) const {
+      return index_ == other.index_;
+    }
+    bool operator!=(const Iterator& other) const {
+      return index_ != other.index_;
+    }
+
+  private:
+    Array* array_ = nullptr;
+    size_t index_ = 0;
+  };
+  using iterator = Iterator<SegmentedArray, T>;
+  using const_iterator = Iterator<const SegmentedArray, const T>;
+
+  SegmentedArray() = default;
+  explicit SegmentedArray(const Allocator& allocator) : allocator_(allocator) {}
+  SegmentedArray(const SegmentedArray& other)
+      : allocator_(
+            Traits::select_on_container_copy_construction(other.allocator_)) {
+    reserve(other.size_);
+    for (const T& element : other)
+      emplace_back(element);
+  }
+  SegmentedArray(SegmentedArray&& other) noexcept
+      : allocator_(other.allocator_), table_(other.table_),
+        tableSize_(other.tableSize_), segments_(other.segments_),
+        size_(other.size_) {
+    other.table_ = nullptr;
+    other.tableSize_ = 0;
+    other.segments_ = 0;
+    other.size_ = 0;
+  }
+  SegmentedArray& operator=(SegmentedArray other) {
+    swap(other);
+    return *this;
+  }
+  ~SegmentedArray() {
+    clear();
+    TableAllocator tableAllocator(allocator_);
+    for (unsigned segment = 0; segment < segments_; ++segment)
+      Traits::deallocate(allocator_, table_[segment], segmentSize(segment));
+    if (table_)
+      TableTraits::deallocate(tableAllocator, table_, tableSize_);
+  }
+
+  void swap(SegmentedArray& other) {
+    std::swap(allocator_, other.allocator_);
+    std::swap(table_, other.table_);
+    std::swap(tableSize_, other.tableSize_);
+    std::swap(segments_, other.segments_);
+    std::swap(size_, other.size_);
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  size_t capacity() const { return segmentStart(segments_); }
+
+  T& operator[](size_t index) {
+    const unsigned segment = segmentOf(index);
+    return table_[segment][index - segmentStart(segment)];
+  }
+  const T& operator[](size_t index) const {
+    const unsigned segment = segmentOf(index);
+    return table_[segment][index - segmentStart(segment)];
+  }
+  T& front() { return (*this)[0]; }
+  const T& front() const { return (*this)[0]; }
+  T& back() { return (*this)[size_ - 1]; }
+  const T& back() const { return (*this)[size_ - 1]; }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, size_); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+
+  template <typename... Args> T& emplace_back(Args&&... args) {
+    if (size_ == capacity())
+      addSegment();
+    T* element = &(*this)[size_];
+    Traits::construct(allocator_, element, std::forward<Args>(args)...);
+    ++size_;
+    return *element;
+  }
+  void push_back(const T& value) { emplace_back(value); }
+  void push_back(T&& value) { emplace_back(std::move(value)); }
+  void pop_back() {
+    --size_;
+    Traits::destroy(allocator_, &(*this)[size_]);
+  }
+
+  /// Insert value before index, which must not exceed size().
+  void insert(size_t index, T&& value) {
+    if (index == size_) {
+      emplace_back(std::move(value));
+      return;
+    }
+    emplace_back(std::move(back()));
+    for (size_t i = size_ - 2; i > index; --i)
+      (*this)[i] = std::move((*this)[i - 1]);
+    (*this)[index] = std::move(value);
+  }
+  /// Remove the element at index, which must be below size().
+  void erase(size_t index) {
+    for (size_t i = index + 1; i < size_; ++i)
+      (*this)[i - 1] = std::move((*this)[i]);
+    pop_back();
+  }
+
+  void resize(size_t newSize) {
+    while (size_ > newSize)
+      pop_back();
+    reserve(newSize);
+    while (size_ < newSize)
+      emplace_back();
+  }
+  void reserve(size_t newCapacity) {
+    while (capacity() < newCapacity)
+      addSegment();
+  }
+  /// Destroy the elements, but keep the segments for reuse.
+  void clear() {
+    while (size_)
+      pop_back();
+  }
+
+private:
+  static constexpr unsigned firstSegmentBits = 2;
+
+  static size_t segmentSize(unsigned segment) {
+    return size_t(1) << (segment + firstSegmentBits);
+  }
+  // The index of the first element of segment.
+  static size_t segmentStart(unsigned segment) {
+    return segmentSize(segment) - segmentSize(0);
+  }
+  // The segment holding index: floor(log2(index + 4)) - 2.
+  static unsigned segmentOf(size_t index) {
+    const uint64_t biased = uint64_t(index) + segmentSize(0);
+#if defined(__GNUC__) || defined(__clang__)
+    const unsigned top = 63 - static_cast<unsigned>(__builtin_clzll(biased));
+#elif defined(_MSC_VER)
+    unsigned long bit;
+    unsigned top;
+    if (_BitScanReverse(&bit, static_cast<unsigned long>(biased >> 32)))
+      top = 32 + bit;
+    else {
+      _BitScanReverse(&bit, static_cast<unsigned long>(biased));
+      top = bit;
+    }
+#else
+    unsigned top = 0;
+    for (uint64_t rest = biased >> 1; rest; rest >>= 1)
+      ++top;
+#endif
+    return top - firstSegmentBits;
+  }
+
+  void addSegment() {
+    if (segments_ == tableSize_) {
+      TableAllocator tableAllocator(allocator_);
+      const unsigned tableSize = tableSize_ ? 2 * tableSize_ : 4;
+      T** table = TableTraits::allocate(tableAllocator, tableSize);
+      std::copy(table_, table_ + segments_, table);
+      if (table_)
+        TableTraits::deallocate(tableAllocator, table_, tableSize_);
+      table_ = table;
+      tableSize_ = tableSize;
+    }
+    table_[segments_] = Traits::allocate(allocator_, segmentSize(segments_));
+    ++segments_;
+  }
+
+  Allocator allocator_{};
+  // The segments, in a table with room for tableSize_ of them.
+  T** table_ = nullptr;
+  unsigned tableSize_ = 0;
+  unsigned segments_ = 0;
+  size_t size_ = 0;
+};
+
+template <typename T, typename Allocator>
+bool operator==(const SegmentedArray<T, Allocator>& a,
+                const SegmentedArray<T, Allocator>& b) {
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template <typename T, typename Allocator>
+bool operator<(const SegmentedArray<T, Allocator>& a,
+               const SegmentedArray<T, Allocator>& b) {
+  return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+}
+
+} // namespace Json
+
+#pragma pack(pop)
+
+#endif // JSON_SEGMENTED_ARRAY_H_INCLUDED
@@ -7,7 +7,9 @@
 #define JSON_H_INCLUDED
 
 #if !defined(JSON_IS_AMALGAMATION)
+#include "arena.h"
 #include "forwards.h"
+#include "segmented_array.h"
 #endif // if !defined(JSON_IS_AMALGAMATION)
 
 // Conditional NORETURN attribute on the throw functions would:
@@ -41,6 +43,7 @@
 
 #include <array>
 #include <exception>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -127,7 +130,8 @@ enum CommentPlacement {
  */
 enum PrecisionType {
   significantDigits = 0, ///< we set max number of significant digits in string
-  decimalPlaces          ///< we set max number of digits after "." in string
+  decimalPlaces,         ///< we set max number of digits after "." in string
+  shortestRoundTrip ///< as few digits as read back exactly; precision ignored
 };
 
 /** \brief Lightweight wrapper to tag static string.
@@ -184,6 +188,10 @@ private:
  * It is possible to iterate over the list of member keys of an object using
  * the getMemberNames() method.
  *
+ * Comments and source offsets are rare, so they are not stored in the Value
+ * itself. A Value which has some moves its payload into a separate block
+ * along with them, and otherwise is just its payload and type.
+ *
  * \note #Value string-length fit in size_t, but keys must be < 2^30.
  * (The reason is an implementation detail.) A #CharReader will raise an
  * exception if a bound is exceeded to avoid security holes in your app,
@@ -192,6 +200,9 @@ private:
  */
 class JSON_API Value {
   friend class ValueIteratorBase;
+  friend class NamePool;
+  friend class ValuePool;
+  friend class LazySource;
 
 public:
   using Members = std::vector<String>;
@@ -248,6 +259,10 @@ public:
   // converting Value::maxUInt64 to a double correctly (AIX/xlC).
   // Assumes that UInt64 is a 64 bits integer.
   static constexpr double maxUInt64AsDouble = 18446744073709551615.0;
+  /// The most elements operator[](ArrayIndex), resize() and reserve() add to
+  /// an array at once. Every element takes memory, so a larger gap throws
+  /// rather than let a size from untrusted input allocate gigabytes.
+  static constexpr ArrayIndex maxArrayGap = 1024 * 1024;
 // Workaround for bug in the NVIDIAs CUDA 9.1 nvcc compiler
 // when using gcc and clang backend compilers.  CZString
 // cannot be defined as private.  See issue #486
@@ -259,7 +274,12 @@ private:
 #ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
   class CZString {
   public:
-    enum DuplicationPolicy { noDuplication = 0, duplicate, duplicateOnCopy };
+    enum DuplicationPolicy {
+      noDuplication = 0,
+      duplicate,
+      duplicateOnCopy,
+      arenaCopy // owned by an Arena, so not released, but duplicated on copy
+    };
     CZString(ArrayIndex index);
     CZString(char const* str, unsigned length, DuplicationPolicy allocate);
     CZString(CZString const& other);
@@ -277,22 +297,43 @@ private:
     bool isStaticString() const;
 
   private:
+    friend class Json::NamePool;
     void swap(CZString& other);
+    bool isIndex() const { return !inline_ && !cstr_; }
+    void copyFrom(const CZString& other);
 
     struct StringStorage {
       unsigned policy_ : 2;
       unsigned length_ : 30; // 1GB max
     };
 
-    char const* cstr_; // actually, a prefixed string, unless policy is noDup
+    union {
+      char const* cstr_; // actually, a prefixed string, unless policy is noDup
+      char chars_[sizeof(char const*)]; // a short duplicate, if inline_
+    };
     union {
       ArrayIndex index_;
       StringStorage storage_;
     };
+    bool inline_;
+    bool shared_; // cstr_ is a reference counted name from a NamePool
   };
 
+  class HashedObjectValues;
+  class LazyNode;
+  class PackedNumbers;
+  class SharedPayload;
+  template <typename Values> class Shared;
+
 public:
-  typedef std::map<CZString, Value> ObjectValues;
+  // The allocator lets Value(ValueType, Arena&) keep its containers in an
+  // Arena; otherwise it uses operator new like std::allocator. It costs
+  // every array and object 8 bytes for the Arena pointer, which is simpler
+  // than a second set of container types for arena values.
+  typedef std::map<CZString, Value, std::less<CZString>,
+                   ArenaAllocator<std::pair<const CZString, Value>>>
+      ObjectValues;
+  typedef SegmentedArray<Value, ArenaAllocator<Value>> ArrayValues;
 #endif // ifndef JSONCPP_DOC_EXCLUDE_IMPLEMENTATION
 
 public:
@@ -313,6 +354,27 @@ public:
    *   \endcode
    */
   Value(ValueType type = nullValue);
+  /**
+   * \brief Create a default Value of the given type, optionally with hashed
+   * member lookup.
+   *
+   * If hashMembers is true and type is objectValue, the members are also
+   * indexed by a hash table once the object grows past a few members, so
+   * find(), isMember() and operator[] do not walk the member tree. Iteration
+   * order, getMemberNames() and comparisons are unchanged. Copies of such an
+   * object keep the index; objects stored into it as members do not inherit
+   * it.
+   */
+  Value(ValueType type, bool hashMembers);
+  /**
+   * \brief Create a default Value of the given type, whose elements or
+   * members are allocated from arena.
+   *
+   * Growing the array or object takes memory from arena, which must outlive
+   * this value. Copies of the value are allocated normally, and so are the
+   * values stored into it unless they are created from arena too.
+   */
+  Value(ValueType type, Arena& arena);
   Value(Int value);
   Value(UInt value);
 #if defined(JSON_HAS_INT64)
@@ -322,6 +384,18 @@ public:
   Value(double value);
   Value(const char* value); ///< Copy til first 0. (NULL causes to seg-fault.)
   Value(const char* begin, const char* end); ///< Copy all, incl zeroes.
+  /**
+   * \brief Constructs a string value from [begin, end), without copying it if
+   * borrow is true.
+   *
+   * A borrowed string refers to the caller's characters, which must stay
+   * alive and unchanged for as long as this value, or any copy of it, is
+   * used. They need not be null-terminated, so asCString() is not available
+   * on such a value; use getString() or asString() instead.
+   */
+  Value(const char* begin, const char* end, bool borrow);
+  /// Copy all of [begin, end) into arena, which must outlive this value.
+  Value(const char* begin, const char* end, Arena& arena);
   /**
    * \brief Constructs a value from a static string.
    *
@@ -362,6 +436,57 @@ public:
   /// copy values but leave comments and source offsets in place.
   void copyPayload(const Value& other);
 
+  /** \brief Share the strings, arrays and objects of this value between its
+   * copies.
+   *
+   * Afterwards, copying the value, or any value inside it, only counts a
+   * reference (atomically, so the copies may go to other threads). The first
+   * change made through a copy duplicates the arrays and objects on the way
+   * to what changes, and nothing else, so each copy still behaves as a copy.
+   *
+   * Lazy values are read and packed arrays are stored as usual first, as
+   * the copies must not change what they share. Values created from an
+   * Arena are left as they are.
+   *
+   * \warning References and iterators taken into the value before the call
+   * must not be used to change it afterwards.
+   */
+  void share();
+  /** \brief Same as share(), but strings, arrays and objects equal to a value
+   * of pool take its payload instead of keeping their own, and the others
+   * are added to pool.
+   *
+   * So a tree with many equal parts keeps one copy of each. Parts which are
+   * already shared are left as they are.
+   */
+  void share(ValuePool& pool);
+
+  /** \brief Store the elements of this array in one buffer of numbers, if
+   * they are all intValue or all realValue and have no comments or offsets.
+   *
+   * Such an array takes 8 bytes per element rather than sizeof(Value), and
+   * getReals() or getLargestInts() give its elements without a Value for
+   * each. Only size(), get(ArrayIndex, const Value&), insert() and
+   * removeIndex() of an element of the same type, clear(), hash(),
+   * comparisons for equality and the writers of StreamWriterBuilder keep it
+   * packed. Anything else which needs the elements as Values, including
+   * const operator[], iterators and share(), first stores them as usual
+   * again. Since that changes the value, a packed array must not be
+   * accessed that way by several threads at once.
+   *
+   * \return true if the array is packed, false if left as it is (also when
+   * it is empty, shared, lazy or created from an Arena).
+   */
+  bool packNumbers();
+  /** Get the elements of an array of realValue packed by packNumbers().
+   *  \return false if this is not such an array.
+   *  \note The pointers are only valid until the value is modified, moved
+   *  or destroyed.
+   */
+  bool getReals(double const** begin, double const** end) const;
+  /// Same as getReals(), for an array of intValue.
+  bool getLargestInts(LargestInt const** begin, LargestInt const** end) const;
+
   ValueType type() const;
 
   /// Compare payload only, not comments etc.
@@ -373,6 +498,20 @@ public:
   bool operator!=(const Value& other) const;
   int compare(const Value& other) const;
 
+  /** \brief Return a hash of the payload, the same for values that compare
+   * equal.
+   *
+   * Comments and offsets are not hashed. A different seed gives unrelated
+   * hashes. Hashes may change between platforms and releases, so they should
+   * not be stored.
+   *
+   * Arrays and objects shared by share() keep their hash for the default seed
+   * until changed, so hashing them again is constant time, and operator==
+   * tells them apart without looking at their members when those hashes are
+   * known and differ.
+   */
+  size_t hash(size_t seed = 0) const;
+
   const char* asCString() const; ///< Embedded zeroes could cause you trouble!
 #if JSONCPP_USING_SECURE_MEMORY
   unsigned getCStringLength() const; // Allows you to understand the length of
@@ -381,6 +520,9 @@ public:
   String asString() const; ///< Embedded zeroes are possible.
   /** Get raw char* of string-value.
    *  \return false if !string. (Seg-fault if str or end are NULL.)
+   *  \note Short strings are stored in the Value itself, so like the result
+   *  of asCString(), the pointers are only valid until the value is
+   *  modified, moved or destroyed.
    */
   bool getString(char const** begin, char const** end) const;
   Int asInt() const;
@@ -414,6 +556,9 @@ public:
 
   bool isConvertibleTo(ValueType other) const;
 
+  /// Return true if this is an object created with hashed member lookup.
+  bool hasHashedMembers() const;
+
   /// Number of values in array or object
   ArrayIndex size() const;
 
@@ -430,16 +575,25 @@ public:
   void clear();
 
   /// Resize the array to newSize elements.
-  /// New elements are initialized to null.
+  /// New elements are initialized to null. newSize may not exceed size() by
+  /// more than maxArrayGap.
   /// May only be called on nullValue or arrayValue.
   /// \pre type() is arrayValue or nullValue
   /// \post type() is arrayValue
   void resize(ArrayIndex newSize);
 
+  /// Reserve storage for at least newCapacity elements without changing
+  /// size(). newCapacity may not exceed size() by more than maxArrayGap.
+  /// May only be called on nullValue or arrayValue.
+  /// \pre type() is arrayValue or nullValue
+  /// \post type() is arrayValue
+  void reserve(ArrayIndex newCapacity);
+
   //@{
   /// Access an array element (zero based index). If the array contains less
   /// than index element, then null value are inserted in the array so that
-  /// its size is index+1.
+  /// its size is index+1. As each of them takes memory, index may not exceed
+  /// size() by more than maxArrayGap.
   /// (You may need to say 'value[0u]' to get your compiler to distinguish
   /// this from the operator[] which takes a string.)
   Value& operator[](ArrayIndex index);
@@ -516,6 +670,12 @@ public:
   /// \note As stated elsewhere, behavior is undefined if (end-begin) >= 2^30
   /// \return non-zero, but JSON_ASSERT if this is neither object nor nullValue.
   Value* demand(char const* begin, char const* end);
+  /// Same as demand(begin, end), but if borrowKey is true a new member's name
+  /// refers to [begin, end) instead of a copy, like a StaticString key.
+  Value* demand(char const* begin, char const* end, bool borrowKey);
+  /// Same as demand(begin, end), but a new member's name is shared through
+  /// pool, so members with the same name in other objects use the same copy.
+  Value* demand(char const* begin, char const* end, NamePool& pool);
   /// \brief Remove and return the named member.
   ///
   /// Do nothing if it did not exist.
@@ -597,14 +757,49 @@ private:
   }
   bool isAllocated() const { return bits_.allocated_; }
   void setIsAllocated(bool v) { bits_.allocated_ = v; }
+  HashedObjectValues* hashedMap() const;
+  // Read the array or object of a lazy value, and unpack a packed array
+  // (which reading may give), as every access to its members must do first.
+  void materialize() const {
+    if (bits_.lazy_)
+      materializeLazy();
+    if (bits_.packed_)
+      unpack();
+  }
+  void materializeLazy() const;
+  void unpack() const;
+  // Same as operator==() for two arrays, at least one of them packed.
+  bool packedEquals(const Value& other) const;
+  // Take the array or object of a shared value for this Value alone, which
+  // every change to its members must do first.
+  void unshare() {
+    if (bits_.shared_)
+      unsharePayload();
+  }
+  void unsharePayload();
+  // The reference count of a shared array or object, or null.
+  SharedPayload* sharedPayload() const;
+  void releaseShared();
+  // The hash kept by a shared array or object, or 0 if none is known.
+  size_t knownHash() const;
 
   void initBasic(ValueType type, bool allocated = false);
   void dupPayload(const Value& other);
   void releasePayload();
   void dupMeta(const Value& other);
+  void dupStringPayload(char const* str, unsigned length);
+  bool isNullString() const;
+
+  struct Meta;
+  Meta* findMeta() const;
+  Meta& demandMeta();
+  void releaseMeta();
 
   Value& resolveReference(const char* key);
-  Value& resolveReference(const char* key, const char* end);
+  Value& resolveReference(const char* key, const char* end,
+                          CZString::DuplicationPolicy policy,
+                          NamePool* pool = nullptr);
+  void decodeStringPayload(unsigned* length, char const** value) const;
 
   // struct MemberNamesTransform
   //{
@@ -622,6 +817,11 @@ private:
     bool bool_;
     char* string_; // if allocated_, ptr to { unsigned, char[] }.
     ObjectValues* map_;
+    ArrayValues* array_;
+    char chars_[sizeof(LargestInt)]; // if inline_, a null-terminated string.
+    LazyNode* lazy_;                 // if lazy_, the unread array or object.
+    PackedNumbers* packed_;          // if packed_, the numbers of an array.
+    Meta* meta_; // if hasMeta_, comments and offsets, and the payload.
   } value_;
 
   struct {
@@ -629,6 +829,28 @@ private:
     unsigned int value_type_ : 8;
     // Unless allocated_, string_ must be null-terminated.
     unsigned int allocated_ : 1;
+    // If hashed_, map_ is actually a HashedObjectValues.
+    unsigned int hashed_ : 1;
+    // If borrowed_, string_ points to length_ chars that we do not own and
+    // that need not be null-terminated.
+    unsigned int borrowed_ : 1;
+    // If inline_, the string is the first length_ chars_.
+    unsigned int inline_ : 1;
+    // If arena_, the string, array or object payload is owned by an Arena.
+    unsigned int arena_ : 1;
+    // If hasMeta_, value_ is a Meta holding comments or offsets for this
+    // Value, and its payload. Unlike the other bits, it stays with the Value
+    // when payloads move.
+    unsigned int hasMeta_ : 1;
+    // If lazy_, the array or object is still text of the parsed document.
+    unsigned int lazy_ : 1;
+    // If shared_, the string, array or object payload is reference counted
+    // and may belong to copies of this Value too; see share().
+    unsigned int shared_ : 1;
+    // If packed_, the array elements are numbers of one type; see
+    // packNumbers().
+    unsigned int packed_ : 1;
+    unsigned int length_;
   } bits_;
 
   class Comments {
@@ -646,12 +868,24 @@ private:
     using Array = std::array<String, numberOfCommentPlacement>;
     std::unique_ptr<Array> ptr_;
   };
-  Comments comments_;
 
-  // [start, limit) byte offsets in the source JSON text from which this Value
-  // was extracted.
-  ptrdiff_t start_;
-  ptrdiff_t limit_;
+  // The comments and source offsets of a Value. As they take the place of
+  // the payload in value_, they hold it too.
+  struct Meta {
+    Comments comments_;
+    // [start, limit) byte offsets in the source JSON text from which the
+    // Value was extracted.
+    ptrdiff_t start_ = 0;
+    ptrdiff_t limit_ = 0;
+    ValueHolder payload_;
+  };
+
+  ValueHolder& payload() {
+    return bits_.hasMeta_ ? value_.meta_->payload_ : value_;
+  }
+  const ValueHolder& payload() const {
+    return bits_.hasMeta_ ? value_.meta_->payload_ : value_;
+  }
 };
 
 template <> inline bool Value::as<bool>() const { return asBool(); }
@@ -684,6 +918,74 @@ template <> inline const char* Value::as<const char*>() const {
   return asCString();
 }
 
+/** \brief A table of object member names, shared by the objects built with it.
+ *
+ * Members added with Value::demand(begin, end, pool) refer to the pool's copy
+ * of their name rather than to a copy each, so an array of records keeps a
+ * single copy of each key, and comparing two names from the same pool stops
+ * at the pointer. Shared names are reference counted: values may outlive the
+ * pool and may be copied and destroyed from any thread, but the pool itself
+ * must be used by one thread at a time.
+ *
+ * Names shorter than 8 chars are stored in the member itself and never pooled.
+ * Once the pool holds maxSize names, other names are copied as usual.
+ */
+class JSON_API NamePool {
+public:
+  static constexpr size_t defaultMaxSize = 16 * 1024;
+
+  explicit NamePool(size_t maxSize = defaultMaxSize);
+  ~NamePool();
+  NamePool(const NamePool&) = delete;
+  NamePool& operator=(const NamePool&) = delete;
+
+  /// Number of names in the pool.
+  size_t size() const;
+  /// Forget all names. Values built with the pool keep theirs.
+  void clear();
+
+private:
+  friend class Value;
+  Value::CZString intern(char const* key, unsigned length);
+
+  struct Names;
+  std::unique_ptr<Names> names_;
+  size_t maxSize_;
+};
+
+/** \brief A table of shared values, used by Value::share(ValuePool&) to find
+ * the parts of a value equal to ones seen before.
+ *
+ * The pool keeps a reference to the payload of each of its values until it
+ * is cleared. Like the payloads of share(), they may be copied and destroyed
+ * from any thread, but the pool itself must be used by one thread at a time.
+ *
+ * Strings shorter than 8 chars are stored in the value itself and never
+ * pooled. Once the pool holds maxSize values, others are shared as usual.
+ */
+class JSON_API ValuePool {
+public:
+  static constexpr size_t defaultMaxSize = 64 * 1024;
+
+  explicit ValuePool(size_t maxSize = defaultMaxSize);
+  ~ValuePool();
+  ValuePool(const ValuePool&) = delete;
+  ValuePool& operator=(const ValuePool&) = delete;
+
+  /// Number of values in the pool.
+  size_t size() const;
+  /// Forget all values. Values shared with the pool keep their payloads.
+  void clear();
+
+private:
+  friend class Value;
+  void intern(Value& value);
+
+  struct Values;
+  std::unique_ptr<Values> values_;
+  size_t maxSize_;
+};
+
 /** \brief Experimental and untested: represents an element of the "path" to
  * access a node.
  */
@@ -775,6 +1077,8 @@ public:
   /// objectValue.
   /// \deprecated This cannot be used for UTF-8 strings, since there can be
   /// embedded nulls.
+  /// \note Member names borrowed from the parsed text (see the
+  /// `"borrowStrings"` setting of CharReaderBuilder) are not null-terminated.
   JSONCPP_DEPRECATED("Use `key = name();` instead.")
   char const* memberName() const;
   /// Return the member name of the referenced Value, or NULL if it is not an
@@ -804,6 +1108,10 @@ protected:
 
 private:
   Value::ObjectValues::iterator current_;
+  // For an arrayValue, current_ is unused and the iterator refers to
+  // (*array_)[index_] instead.
+  Value::ArrayValues* array_{nullptr};
+  ArrayIndex index_{0};
   // Indicates that iterator is for a null value.
   bool isNull_{true};
 
@@ -812,6 +1120,7 @@ public:
   // than earlier. No idea why.
   ValueIteratorBase();
   explicit ValueIteratorBase(const Value::ObjectValues::iterator& current);
+  ValueIteratorBase(Value::ArrayValues* array, ArrayIndex index);
 };
 
 /** \brief const iterator for object and array value.
@@ -835,6 +1144,7 @@ private:
   /*! \internal Use by Value to create an iterator.
    */
   explicit ValueConstIterator(const Value::ObjectValues::iterator& current);
+  ValueConstIterator(Value::ArrayValues* array, ArrayIndex index);
 
 public:
   SelfType& operator=(const ValueIteratorBase& other);
@@ -887,6 +1197,7 @@ private:
   /*! \internal Use by Value to create an iterator.
    */
   explicit ValueIterator(const Value::ObjectValues::iterator& current);
+  ValueIterator(Value::ArrayValues* array, ArrayIndex index);
 
 public:
   SelfType& operator=(const SelfType& other);
@@ -926,6 +1237,13 @@ inline void swap(Value& a, Value& b) { a.swap(b); }
 
 } // namespace Json
 
+namespace std {
+/// Hash a Value with Value::hash(), for unordered containers of values.
+template <> struct hash<Json::Value> {
+  size_t operator()(const Json::Value& value) const { return value.hash(); }
+};
+} // namespace std
+
 #pragma pack(pop)
 
 #if defined(JSONCPP_DISABLE_DLL_INTERFACE_WARNING)
@@ -46,12 +46,24 @@ public:
   virtual ~StreamWriter();
   /** Write Value into document as configured in sub-class.
    *   Do not take ownership of sout, but maintain a reference during function.
+   *   A StreamWriter can be reused for any number of documents: each call of
+   *   write() or append() starts at the root with no indentation and no
+   *   pending output, and only the capacity of scratch buffers is kept from
+   *   one call to the next. It must not be used by two threads at once.
    *   \pre sout != NULL
    *   \return zero on success (For now, we always return zero, so check the
    *   stream instead.) \throw std::exception possibly, depending on
    * configuration
    */
   virtual int write(Value const& root, OStream* sout) = 0;
+  /** Append the document write() would produce to *document.
+   *   The writers made by StreamWriterBuilder format it directly into
+   *   *document, with no stream in between. By default, it is written to an
+   *   OStringStream and then appended.
+   *   \pre document != NULL
+   *   \return zero on success
+   */
+  virtual int append(Value const& root, String* document);
 
   /** \brief A simple abstract factory.
    */
@@ -71,6 +83,41 @@ public:
 String JSON_API writeString(StreamWriter::Factory const& factory,
                             Value const& root);
 
+/** \brief The settings of StreamWriterBuilder as a struct.
+ *
+ * Each member has the meaning and the default of the setting of the same
+ * name (see StreamWriterBuilder::settings_), except that comments are
+ * written or dropped with a bool. A writer made from it by
+ * newStreamWriter(StreamWriterOptions const&) looks no setting up by name,
+ * and a misspelt option or an unknown precision type does not compile:
+ *   \code
+ *   Json::StreamWriterOptions options;
+ *   options.indentation = "";
+ *   options.precisionType = Json::shortestRoundTrip;
+ *   std::unique_ptr<Json::StreamWriter> writer(
+ *       Json::newStreamWriter(options));
+ *   \endcode
+ * It is a literal type, so options can be constants.
+ */
+struct JSON_API StreamWriterOptions {
+  /// "commentStyle": true for "All", false for "None".
+  bool writeComments = true;
+  /// Copied by newStreamWriter(), so it only has to live until then.
+  const char* indentation = "\t";
+  bool enableYAMLCompatibility = false;
+  bool dropNullPlaceholders = false;
+  bool useSpecialFloats = false;
+  bool emitUTF8 = false;
+  /// At most 17; larger values are treated as 17.
+  unsigned precision = 17;
+  PrecisionType precisionType = significantDigits;
+};
+
+/** Allocate a StreamWriter via operator new(), with options instead of the
+ * settings of a StreamWriterBuilder.
+ */
+JSON_API StreamWriter* newStreamWriter(StreamWriterOptions const& options);
+
 /** \brief Build a StreamWriter implementation.
 
 * Usage:
@@ -108,8 +155,11 @@ public:
    *  infinity as "-Infinity".
    *  - "precision": int
    *  - Number of precision digits for formatting of real values.
-   *  - "precisionType": "significant"(default) or "decimal"
-   *  - Type of precision for formatting of real values.
+   *  - "precisionType": "significant"(default), "decimal" or "shortest"
+   *  - Type of precision for formatting of real values. "shortest" ignores
+   *    "precision" and writes the shortest text that reads back as the same
+   *    double. Only the few doubles the fast algorithm cannot settle go
+   *    through snprintf and strtod.
    *  - "emitUTF8": false or true
    *  - If true, outputs raw UTF8 strings instead of escaping them.
 
@@ -144,6 +194,23 @@ public:
   static void setDefaults(Json::Value* settings);
 };
 
+/** Return a StreamWriter with the settings of builder, kept by the calling
+ * thread for reuse.
+ *
+ * The writer is built again only when called with different settings than
+ * the last time on this thread, and keeps the capacity of its buffers
+ * between documents:
+ *   \code
+ *   for (auto const& value : values)
+ *     Json::threadLocalStreamWriter(builder).append(value, &output);
+ *   \endcode
+ * The reference stays valid until the next call on the same thread, and
+ * must not be handed to other threads. Each call compares the settings, so
+ * code that can keep its own writer across the loop should do so.
+ */
+JSON_API StreamWriter&
+threadLocalStreamWriter(StreamWriterBuilder const& builder);
+
 /** \brief Abstract class for writers.
  * \deprecated Use StreamWriter. (And really, this is an implementation detail.)
  */
@@ -184,6 +251,9 @@ public:
 
   void omitEndingLineFeed();
 
+  /// Write reals as the shortest text that reads back as the same double.
+  void useShortestRoundTripReals();
+
 public: // overridden from Writer
   String write(const Value& root) override;
 
@@ -194,6 +264,7 @@ private:
   bool yamlCompatibilityEnabled_{false};
   bool dropNullPlaceholders_{false};
   bool omitEndingLineFeed_{false};
+  PrecisionType precisionType_{PrecisionType::significantDigits};
 };
 #if defined(_MSC_VER)
 #pragma warning(pop)
@@ -233,6 +304,9 @@ public:
   StyledWriter();
   ~StyledWriter() override = default;
 
+  /// Write reals as the shortest text that reads back as the same double.
+  void useShortestRoundTripReals();
+
 public: // overridden from Writer
   /** \brief Serialize a Value in <a HREF="http://www.json.org">JSON</a> format.
    * \param root Value to serialize.
@@ -262,6 +336,7 @@ private:
   unsigned int rightMargin_{74};
   unsigned int indentSize_{3};
   bool addChildValues_{false};
+  PrecisionType precisionType_{PrecisionType::significantDigits};
 };
 #if defined(_MSC_VER)
 #pragma warning(pop)
@@ -0,0 +1,669 @@
+// Copyright 2007-2010 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+/* This executable measures the throughput of the parser and writers on
+ * generated documents. It is not run as part of the test suite.
+ *
+ * Usage: jsonbench [filter] [repetitions]
+ * runs every benchmark whose name contains filter.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <json/json.h>
+#include <memory>
+#include <random>
+
+// Calls to malloc, which also serves operator new, where it can be counted.
+static std::atomic<size_t> allocations{0};
+
+#if defined(__GLIBC__)
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* malloc(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+#define JSONBENCH_COUNTS_ALLOCATIONS 1
+#endif
+
+namespace {
+
+struct Benchmark {
+  const char* name;
+  // Build the input once, outside of the timed region.
+  Json::String (*setup)();
+  // Process the input once; returns the number of items handled.
+  size_t (*run)(const Json::String& input);
+};
+
+Json::Value parseOrDie(const Json::String& input) {
+  Json::CharReaderBuilder builder;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  Json::Value root;
+  Json::String errs;
+  if (!reader->parse(input.data(), input.data() + input.size(), &root,
+                     &errs)) {
+    fprintf(stderr, "parse error: %s\n", errs.c_str());
+    exit(1);
+  }
+  return root;
+}
+
+// An array of reals in the shapes found in sensor dumps and geo data:
+// coordinates, 17-digit round-tripped values, and exponents.
+Json::String makeReals() {
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<double> coordinate(-180.0, 180.0);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  Json::String doc = "[";
+  char buffer[64];
+  for (int i = 0; i < 200000; ++i) {
+    switch (i % 4) {
+    case 0:
+      snprintf(buffer, sizeof(buffer), "%.7f", coordinate(rng));
+      break;
+    case 1:
+      snprintf(buffer, sizeof(buffer), "%.17g", unit(rng));
+      break;
+    case 2:
+      snprintf(buffer, sizeof(buffer), "%.6e", unit(rng) * 1e-9);
+      break;
+    default:
+      snprintf(buffer, sizeof(buffer), "%.3f", unit(rng) * 1000.0);
+      break;
+    }
+    if (i)
+      doc += ',';
+    doc += buffer;
+  }
+  doc += "]";
+  return doc;
+}
+
+size_t parseReals(const Json::String& input) {
+  return parseOrDie(input).size();
+}
+
+size_t writeReals(const Json::Value& root, const char* precisionType) {
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  builder["precisionType"] = precisionType;
+  return Json::writeString(builder, root).empty() ? 0 : root.size();
+}
+
+// The writer benchmarks parse their input once and cache the tree.
+const Json::Value& realsTree(const Json::String& input) {
+  static const Json::Value root = parseOrDie(input);
+  return root;
+}
+
+size_t writeRealsSignificant(const Json::String& input) {
+  return writeReals(realsTree(input), "significant");
+}
+
+size_t writeRealsShortest(const Json::String& input) {
+  return writeReals(realsTree(input), "shortest");
+}
+
+Json::Value parseRealsWith(const Json::String& input, bool pack) {
+  Json::CharReaderOptions options;
+  options.packNumbers = pack;
+  std::unique_ptr<Json::CharReader> reader(Json::newCharReader(options));
+  Json::Value root;
+  reader->parse(input.data(), input.data() + input.size(), &root, nullptr);
+  return root;
+}
+
+size_t parseRealsPacked(const Json::String& input) {
+  return parseRealsWith(input, true).size();
+}
+
+size_t sumReals(const Json::String& input) {
+  static const Json::Value root = parseRealsWith(input, false);
+  double sum = 0;
+  for (const Json::Value& element : root)
+    sum += element.asDouble();
+  return sum != 0 ? root.size() : 0;
+}
+
+size_t sumRealsPacked(const Json::String& input) {
+  static const Json::Value root = parseRealsWith(input, true);
+  double const* begin;
+  double const* end;
+  if (!root.getReals(&begin, &end))
+    return 0;
+  double sum = 0;
+  for (double const* real = begin; real != end; ++real)
+    sum += *real;
+  return sum != 0 ? root.size() : 0;
+}
+
+// An array of log records, of which a consumer typically needs one field.
+Json::String makeRecords() {
+  std::mt19937_64 rng(7);
+  Json::String doc = "[";
+  for (int i = 0; i < 50000; ++i) {
+    if (i)
+      doc += ',';
+    doc += "{\"id\":" + std::to_string(i) +
+           ",\"level\":\"" + (rng() % 8 ? "info" : "error") +
+           "\",\"latency\":" + std::to_string(rng() % 100000) +
+           ",\"host\":\"node-" + std::to_string(rng() % 64) +
+           ".example.com\",\"tags\":[\"http\",\"api\",\"v2\"]"
+           ",\"message\":\"request completed\"}";
+  }
+  doc += "]";
+  return doc;
+}
+
+// Counts the error records from the tree.
+size_t parseRecords(const Json::String& input) {
+  const Json::Value root = parseOrDie(input);
+  size_t errors = 0;
+  for (const Json::Value& record : root)
+    errors += record["level"] == "error";
+  return errors;
+}
+
+// The records, nested and indented as by a pretty printer.
+Json::String makePrettyRecords() {
+  Json::Value root;
+  root["response"]["result"]["records"] = parseOrDie(makeRecords());
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "    ";
+  return Json::writeString(builder, root);
+}
+
+size_t parsePrettyRecords(const Json::String& input) {
+  const Json::Value root = parseOrDie(input);
+  size_t errors = 0;
+  for (const Json::Value& record : root["response"]["result"]["records"])
+    errors += record["level"] == "error";
+  return errors;
+}
+
+const Json::Value& recordsTree(const Json::String& input) {
+  static const Json::Value root = parseOrDie(input);
+  return root;
+}
+
+// Copies each record and changes one member of the copy, as code handing
+// records to other stages does.
+size_t copyRecordsFrom(const Json::Value& root) {
+  size_t total = 0;
+  for (const Json::Value& record : root) {
+    Json::Value copy(record);
+    copy["latency"] = 0;
+    total += copy.size();
+  }
+  return total ? root.size() : 0;
+}
+
+size_t copyRecords(const Json::String& input) {
+  return copyRecordsFrom(recordsTree(input));
+}
+
+size_t copyRecordsShared(const Json::String& input) {
+  static const Json::Value root = [&input] {
+    Json::Value shared = parseOrDie(input);
+    shared.share();
+    return shared;
+  }();
+  return copyRecordsFrom(root);
+}
+
+// Hashes each record, as code looking for changed records does.
+size_t hashRecordsFrom(const Json::Value& root) {
+  size_t total = 0;
+  for (const Json::Value& record : root)
+    total += record.hash();
+  return total ? root.size() : 0;
+}
+
+size_t hashRecords(const Json::String& input) {
+  return hashRecordsFrom(recordsTree(input));
+}
+
+// The same once the records are shared, which keeps their hashes.
+size_t hashRecordsShared(const Json::String& input) {
+  static const Json::Value root = [&input] {
+    Json::Value shared = parseOrDie(input);
+    shared.share();
+    return shared;
+  }();
+  return hashRecordsFrom(root);
+}
+
+// Writes the records to a String with writeString.
+size_t writeRecords(const Json::String& input) {
+  const Json::Value& root = recordsTree(input);
+  Json::StreamWriterBuilder builder;
+  return Json::writeString(builder, root).empty() ? 0 : root.size();
+}
+
+// Writes the records to a stream.
+size_t writeRecordsStream(const Json::String& input) {
+  const Json::Value& root = recordsTree(input);
+  Json::StreamWriterBuilder builder;
+  std::unique_ptr<Json::StreamWriter> writer(builder.newStreamWriter());
+  Json::OStringStream sout;
+  writer->write(root, &sout);
+  return sout.str().empty() ? 0 : root.size();
+}
+
+// Counts the error records from a tree allocated from an Arena.
+size_t parseRecordsArena(const Json::String& input) {
+  Json::CharReaderBuilder builder;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  Json::Arena arena;
+  Json::Value root;
+  Json::String errs;
+  if (!reader->parseInArena(input.data(), input.data() + input.size(), &arena,
+                            &root, &errs)) {
+    fprintf(stderr, "parse error: %s\n", errs.c_str());
+    exit(1);
+  }
+  size_t errors = 0;
+  for (const Json::Value& record : root)
+    errors += record["level"] == "error";
+  return errors;
+}
+
+// An array of records holding long strings: base64 blobs, and log messages
+// with the occasional escaped quote or newline.
+Json::String makeLongStrings() {
+  static const char base64[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::mt19937_64 rng(13);
+  Json::String doc = "[";
+  for (int i = 0; i < 2000; ++i) {
+    if (i)
+      doc += ',';
+    doc += "{\"blob\":\"";
+    for (size_t n = 256 + rng() % 4096; n; --n)
+      doc += base64[rng() % 64];
+    doc += "\",\"log\":\"";
+    for (int line = 0; line < 8; ++line)
+      doc += "GET /api/v2/items?id=" + std::to_string(rng() % 100000) +
+             " \\\"curl/7.68\\\" completed in " +
+             std::to_string(rng() % 1000) + " ms\\n";
+    doc += "\"}";
+  }
+  doc += "]";
+  return doc;
+}
+
+size_t parseLongStrings(const Json::String& input) {
+  return parseOrDie(input).size();
+}
+
+size_t writeLongStrings(const Json::String& input, bool emitUTF8) {
+  static const Json::Value root = parseOrDie(input);
+  Json::StreamWriterBuilder builder;
+  builder["emitUTF8"] = emitUTF8;
+  return Json::writeString(builder, root).empty() ? 0 : root.size();
+}
+
+size_t writeLongStringsEscaped(const Json::String& input) {
+  return writeLongStrings(input, false);
+}
+
+size_t writeLongStringsUTF8(const Json::String& input) {
+  return writeLongStrings(input, true);
+}
+
+// An array of metrics records with long, repeated member names.
+Json::String makeMetrics() {
+  std::mt19937_64 rng(11);
+  Json::String doc = "[";
+  for (int i = 0; i < 20000; ++i) {
+    if (i)
+      doc += ',';
+    doc += "{\"timestamp_ms\":" + std::to_string(1600000000000 + i) +
+           ",\"request_id\":" + std::to_string(rng() % 1000000) +
+           ",\"status_code\":" + (rng() % 16 ? "200" : "503") +
+           ",\"duration_us\":" + std::to_string(rng() % 100000) +
+           ",\"bytes_received\":" + std::to_string(rng() % 4096) +
+           ",\"bytes_sent\":" + std::to_string(rng() % 65536) +
+           ",\"upstream_host\":\"node-" + std::to_string(rng() % 64) + "\"}";
+  }
+  doc += "]";
+  return doc;
+}
+
+size_t countFailures(const Json::Value& root) {
+  size_t failures = 0;
+  for (const Json::Value& record : root)
+    failures += record["status_code"] != 200;
+  return failures;
+}
+
+size_t parseMetrics(const Json::String& input) {
+  return countFailures(parseOrDie(input));
+}
+
+// Same, with member names shared through the reader's NamePool.
+size_t parseMetricsInterned(const Json::String& input) {
+  Json::CharReaderBuilder builder;
+  builder["internKeys"] = true;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  Json::Value root;
+  Json::String errs;
+  if (!reader->parse(input.data(), input.data() + input.size(), &root,
+                     &errs)) {
+    fprintf(stderr, "parse error: %s\n", errs.c_str());
+    exit(1);
+  }
+  return countFailures(root);
+}
+
+// Documents of 200 members, a quarter of them objects, one per line.
+Json::String makeWideDocuments() {
+  std::mt19937_64 rng(17);
+  Json::String doc;
+  for (int i = 0; i < 2000; ++i) {
+    doc += "{\"id\":" + std::to_string(i);
+    for (int k = 1; k < 200; ++k) {
+      doc += ",\"field_" + std::to_string(k) + "\":";
+      if (k % 4 == 0)
+        doc += "{\"name\":\"item-" + std::to_string(rng() % 1000) +
+               "\",\"values\":[" + std::to_string(rng() % 100) + "," +
+               std::to_string(rng() % 100) + "],\"extra\":{\"ok\":true}}";
+      else if (k % 2)
+        doc += std::to_string(rng() % 100000);
+      else
+        doc += "\"value-" + std::to_string(rng() % 1000) + "\"";
+    }
+    doc += "}\n";
+  }
+  return doc;
+}
+
+// An inventory of hosts, most with the same tags and settings.
+Json::String makeInventory() {
+  std::mt19937_64 rng(23);
+  Json::String doc = "[";
+  for (int i = 0; i < 20000; ++i) {
+    if (i)
+      doc += ',';
+    doc += "{\"host\":\"host-" + std::to_string(i) +
+           ".inventory.example.com\",\"rack\":" + std::to_string(rng() % 40) +
+           ",\"tags\":[\"production\",\"linux\",\"x86_64\",\"" +
+           (rng() % 4 ? "europe-west" : "us-central") +
+           "\"],\"settings\":{\"monitoring\":{\"enabled\":true,"
+           "\"interval_seconds\":30,\"endpoint\":"
+           "\"https://metrics.example.com/ingest\"},\"backup\":{"
+           "\"schedule\":\"daily-0200\",\"retention_days\":" +
+           (rng() % 8 ? "30" : "90") + "},\"kernel\":\"5.15.0-generic\"}}";
+  }
+  doc += "]";
+  return doc;
+}
+
+size_t parseInventoryWith(const Json::String& input, bool intern) {
+  Json::CharReaderOptions options;
+  options.internValues = intern;
+  std::unique_ptr<Json::CharReader> reader(Json::newCharReader(options));
+  Json::Value root;
+  reader->parse(input.data(), input.data() + input.size(), &root, nullptr);
+  return root.size();
+}
+
+size_t parseInventory(const Json::String& input) {
+  return parseInventoryWith(input, false);
+}
+
+size_t parseInventoryInterned(const Json::String& input) {
+  return parseInventoryWith(input, true);
+}
+
+// Parses every document and reads a few of its members.
+size_t readWideDocuments(const Json::String& input, bool lazy) {
+  Json::CharReaderOptions options;
+  options.lazy = lazy;
+  std::unique_ptr<Json::CharReader> reader(Json::newCharReader(options));
+  size_t total = 0;
+  const char* begin = input.data();
+  const char* end = begin + input.size();
+  while (begin != end) {
+    const char* newline = std::find(begin, end, '\n');
+    Json::Value root;
+    reader->parse(begin, newline, &root, nullptr);
+    total += root["id"].asUInt() + root["field_1"].asUInt() +
+             root["field_8"]["name"].asString().size() +
+             root["field_151"].asUInt();
+    begin = newline == end ? end : newline + 1;
+  }
+  return total ? 2000 : 0;
+}
+
+size_t parseWideEager(const Json::String& input) {
+  return readWideDocuments(input, false);
+}
+
+size_t parseWideLazy(const Json::String& input) {
+  return readWideDocuments(input, true);
+}
+
+// Counts the error records from the parse events, without building a tree.
+size_t parseRecordsEvents(const Json::String& input) {
+  struct Counter : Json::ParseHandler {
+    size_t errors = 0;
+    bool atLevel = false;
+    bool onKey(char const* begin, char const* end) override {
+      atLevel = Json::String(begin, end) == "level";
+      return true;
+    }
+    bool onString(char const* begin, char const* end) override {
+      errors += atLevel && Json::String(begin, end) == "error";
+      atLevel = false;
+      return true;
+    }
+  } counter;
+  Json::CharReaderBuilder builder;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  Json::String errs;
+  if (!reader->parseEvents(input.data(), input.data() + input.size(),
+                           &counter, &errs)) {
+    fprintf(stderr, "parse error: %s\n", errs.c_str());
+    exit(1);
+  }
+  return counter.errors;
+}
+
+// The records as NDJSON, one per line.
+Json::String makeRecordLines() {
+  const Json::Value root = parseOrDie(makeRecords());
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  Json::String doc;
+  for (const Json::Value& record : root)
+    doc += Json::writeString(builder, record) + "\n";
+  return doc;
+}
+
+// Reads the lines one after the other with a CharReader.
+size_t parseLinesSerial(const Json::String& input) {
+  Json::CharReaderBuilder builder;
+  std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+  std::vector<Json::Value> records;
+  const char* begin = input.data();
+  const char* end = begin + input.size();
+  while (begin != end) {
+    const char* newline = std::find(begin, end, '\n');
+    records.emplace_back();
+    reader->parse(begin, newline, &records.back(), nullptr);
+    begin = newline == end ? end : newline + 1;
+  }
+  return records.size();
+}
+
+// Reads each line with a reader of its own.
+size_t parseLinesFresh(const Json::String& input) {
+  Json::CharReaderBuilder builder;
+  std::vector<Json::Value> records;
+  const char* begin = input.data();
+  const char* end = begin + input.size();
+  while (begin != end) {
+    const char* newline = std::find(begin, end, '\n');
+    records.emplace_back();
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    reader->parse(begin, newline, &records.back(), nullptr);
+    begin = newline == end ? end : newline + 1;
+  }
+  return records.size();
+}
+
+// Reads each line with a reader of its own, made from typed options.
+size_t parseLinesFreshOptions(const Json::String& input) {
+  const Json::CharReaderOptions options;
+  std::vector<Json::Value> records;
+  const char* begin = input.data();
+  const char* end = begin + input.size();
+  while (begin != end) {
+    const char* newline = std::find(begin, end, '\n');
+    records.emplace_back();
+    std::unique_ptr<Json::CharReader> reader(Json::newCharReader(options));
+    reader->parse(begin, newline, &records.back(), nullptr);
+    begin = newline == end ? end : newline + 1;
+  }
+  return records.size();
+}
+
+// Writes each record with a writer of its own, made from typed options.
+size_t writeLinesFreshOptions(const Json::String& input) {
+  const Json::Value& root = recordsTree(input);
+  Json::StreamWriterOptions options;
+  options.indentation = "";
+  Json::String doc;
+  for (const Json::Value& record : root) {
+    std::unique_ptr<Json::StreamWriter> writer(Json::newStreamWriter(options));
+    writer->append(record, &doc);
+    doc += '\n';
+  }
+  return doc.empty() ? 0 : root.size();
+}
+
+// Reads each line with the reader kept by the thread.
+size_t parseLinesThreadLocal(const Json::String& input) {
+  Json::CharReaderBuilder builder;
+  std::vector<Json::Value> records;
+  const char* begin = input.data();
+  const char* end = begin + input.size();
+  while (begin != end) {
+    const char* newline = std::find(begin, end, '\n');
+    records.emplace_back();
+    Json::threadLocalCharReader(builder).parse(begin, newline,
+                                               &records.back(), nullptr);
+    begin = newline == end ? end : newline + 1;
+  }
+  return records.size();
+}
+
+// Writes each record as a document of its own with writeString().
+size_t writeLinesFresh(const Json::String& input) {
+  const Json::Value& root = recordsTree(input);
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  Json::String doc;
+  for (const Json::Value& record : root)
+    doc += Json::writeString(builder, record) + "\n";
+  return doc.empty() ? 0 : root.size();
+}
+
+// Writes each record with the writer kept by the thread.
+size_t writeLinesThreadLocal(const Json::String& input) {
+  const Json::Value& root = recordsTree(input);
+  Json::StreamWriterBuilder builder;
+  builder["indentation"] = "";
+  Json::String doc;
+  for (const Json::Value& record : root) {
+    Json::threadLocalStreamWriter(builder).append(record, &doc);
+    doc += '\n';
+  }
+  return doc.empty() ? 0 : root.size();
+}
+
+size_t parseLinesNdjson(const Json::String& input) {
+  Json::NdjsonReader reader{Json::CharReaderBuilder()};
+  std::vector<Json::NdjsonReader::Record> records;
+  reader.parse(input.data(), input.data() + input.size(), &records);
+  return records.size();
+}
+
+const Benchmark benchmarks[] = {
+    {"parseReals", makeReals, parseReals},
+    {"parseRealsPacked", makeReals, parseRealsPacked},
+    {"sumReals", makeReals, sumReals},
+    {"sumRealsPacked", makeReals, sumRealsPacked},
+    {"parseRecords", makeRecords, parseRecords},
+    {"parseRecordsArena", makeRecords, parseRecordsArena},
+    {"parsePrettyRecords", makePrettyRecords, parsePrettyRecords},
+    {"parsePrettyRecordsEvents", makePrettyRecords, parseRecordsEvents},
+    {"parseRecordsEvents", makeRecords, parseRecordsEvents},
+    {"parseLongStrings", makeLongStrings, parseLongStrings},
+    {"parseMetrics", makeMetrics, parseMetrics},
+    {"parseMetricsInterned", makeMetrics, parseMetricsInterned},
+    {"parseInventory", makeInventory, parseInventory},
+    {"parseInventoryInterned", makeInventory, parseInventoryInterned},
+    {"parseWideEager", makeWideDocuments, parseWideEager},
+    {"parseWideLazy", makeWideDocuments, parseWideLazy},
+    {"parseLinesSerial", makeRecordLines, parseLinesSerial},
+    {"parseLinesFresh", makeRecordLines, parseLinesFresh},
+    {"parseLinesFreshOptions", makeRecordLines, parseLinesFreshOptions},
+    {"parseLinesThreadLocal", makeRecordLines, parseLinesThreadLocal},
+    {"parseLinesNdjson", makeRecordLines, parseLinesNdjson},
+    {"writeRealsSignificant", makeReals, writeRealsSignificant},
+    {"writeRealsShortest", makeReals, writeRealsShortest},
+    {"copyRecords", makeRecords, copyRecords},
+    {"copyRecordsShared", makeRecords, copyRecordsShared},
+    {"hashRecords", makeRecords, hashRecords},
+    {"hashRecordsShared", makeRecords, hashRecordsShared},
+    {"writeRecords", makeRecords, writeRecords},
+    {"writeRecordsStream", makeRecords, writeRecordsStream},
+    {"writeLinesFresh", makeRecords, writeLinesFresh},
+    {"writeLinesFreshOptions", makeRecords, writeLinesFreshOptions},
+    {"writeLinesThreadLocal", makeRecords, writeLinesThreadLocal},
+    {"writeLongStringsEscaped", makeLongStrings, writeLongStringsEscaped},
+    {"writeLongStringsUTF8", makeLongStrings, writeLongStringsUTF8},
+};
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  const char* filter = argc > 1 ? argv[1] : "";
+  int repetitions = argc > 2 ? atoi(argv[2]) : 10;
+  if (repetitions <= 0)
+    repetitions = 1;
+
+  for (const Benchmark& benchmark : benchmarks) {
+    if (!strstr(benchmark.name, filter))
+      continue;
+    const Json::String input = benchmark.setup();
+    benchmark.run(input); // warm up
+    size_t items = 0;
+    size_t const allocationsBefore = allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repetitions; ++i)
+      items += benchmark.run(input);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double seconds = elapsed.count();
+    printf("%-24s %8.1f MB/s %8.1f ns/item", benchmark.name,
+           static_cast<double>(input.size()) * repetitions / seconds / 1e6,
+           seconds * 1e9 / static_cast<double>(items));
+#if defined(JSONBENCH_COUNTS_ALLOCATIONS)
+    printf(" %8.1f allocs/item",
+           static_cast<double>(allocations - allocationsBefore) /
+               static_cast<double>(items));
+#endif
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,46 @@
+// Copyright 2007-2010 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#ifndef LIB_JSONCPP_JSON_LAZY_H_INCLUDED
+#define LIB_JSONCPP_JSON_LAZY_H_INCLUDED
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include <json/value.h>
+#endif
+#include <memory>
+
+// It is an internal header that must not be exposed.
+
+namespace Json {
+
+/** Reads the arrays and objects of a document parsed with the "lazy"
+ * setting of CharReaderBuilder, the first time they are accessed.
+ *
+ * A lazy Value keeps the range of the document holding its array or object
+ * and the source which reads it, shared with the other lazy values of the
+ * document.
+ */
+class LazySource : public std::enable_shared_from_this<LazySource> {
+public:
+  virtual ~LazySource();
+
+  /** Read the array or object in [begin, end) into value, leaving the
+   * arrays and objects inside it lazy.
+   * \throw RuntimeError if the text is not valid JSON.
+   */
+  virtual void read(char const* begin, char const* end,
+                    Value& value) const = 0;
+
+  /// Whether the objects read look up their members through a hash table.
+  virtual bool hashesMembers() const = 0;
+
+  /// Make value a lazy array or object, which this reads from [begin, end).
+  void assign(Value& value, ValueType type, char const* begin,
+              char const* end) const;
+};
+
+} // namespace Json
+
+#endif // LIB_JSONCPP_JSON_LAZY_H_INCLUDED
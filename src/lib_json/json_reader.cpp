@@ -5,23 +5,41 @@
 // See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
 
 #if !defined(JSON_IS_AMALGAMATION)
+#include "json_double.h"
+#include "json_lazy.h"
+#include "json_simd.h"
 #include "json_tool.h"
 #include <json/assertions.h>
 #include <json/reader.h>
 #include <json/value.h>
 #endif // if !defined(JSON_IS_AMALGAMATION)
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cerrno>
 #include <cstring>
+#include <exception>
+#include <fstream>
 #include <iostream>
 #include <istream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <sstream>
+#include <thread>
 #include <utility>
 
 #include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define JSONCPP_HAS_MMAP 1
+#endif
+
 #if __cplusplus >= 201103L
 
 #if !defined(sscanf)
@@ -306,15 +324,7 @@ bool Reader::readToken(Token& token) {
   return ok;
 }
 
-void Reader::skipSpaces() {
-  while (current_ != end_) {
-    Char c = *current_;
-    if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
-      ++current_;
-    else
-      break;
-  }
-}
+void Reader::skipSpaces() { current_ = skipJsonSpaces(current_, end_); }
 
 bool Reader::match(const Char* pattern, int patternLength) {
   if (end_ - current_ < patternLength)
@@ -429,15 +439,15 @@ void Reader::readNumber() {
 }
 
 bool Reader::readString() {
-  Char c = '\0';
-  while (current_ != end_) {
-    c = getNextChar();
-    if (c == '\\')
-      getNextChar();
-    else if (c == '"')
-      break;
+  for (;;) {
+    current_ = findQuoteOrEscape(current_, end_, '"');
+    if (current_ == end_)
+      return false;
+    if (*current_++ == '"')
+      return true;
+    if (current_ != end_) // skip the escaped char
+      ++current_;
   }
-  return c == '"';
 }
 
 bool Reader::readObject(Token& token) {
@@ -599,6 +609,10 @@ bool Reader::decodeDouble(Token& token) {
 
 bool Reader::decodeDouble(Token& token, Value& decoded) {
   double value = 0;
+  if (decodeDoubleFast(token.start_, token.end_, &value)) {
+    decoded = value;
+    return true;
+  }
   String buffer(token.start_, token.end_);
   IStringStream is(buffer);
   if (!(is >> value))
@@ -870,7 +884,15 @@ public:
   bool rejectDupKeys_;
   bool allowSpecialFloats_;
   bool skipBom_;
+  bool hashObjectMembers_;
+  bool borrowStrings_;
+  bool collectOffsets_;
+  bool internKeys_;
+  bool internValues_;
+  bool packNumbers_;
+  bool lazy_;
   size_t stackLimit_;
+  size_t streamBlockSize_;
 }; // OurFeatures
 
 OurFeatures OurFeatures::all() { return {}; }
@@ -892,7 +914,11 @@ public:
 
   explicit OurReader(OurFeatures const& features);
   bool parse(const char* beginDoc, const char* endDoc, Value& root,
-             bool collectComments = true);
+             bool collectComments = true, Arena* arena = nullptr);
+  bool parse(const char* beginDoc, const char* endDoc, ParseHandler& handler);
+  bool parse(IStream& sin, Value& root, bool collectComments = true);
+  void readLazy(const char* document, const char* begin, const char* end,
+                Value& value, const LazySource& source);
   String getFormattedErrorMessages() const;
   std::vector<StructuredError> getStructuredErrors() const;
 
@@ -920,11 +946,22 @@ private:
     tokenError
   };
 
+  // The part of a number readNumber() stopped in.
+  enum NumberPart {
+    numberIntegral,
+    numberFraction,
+    numberExponentSign,
+    numberExponent
+  };
+
   class Token {
   public:
     TokenType type_;
     Location start_;
     Location end_;
+    // For a string, whether decoding may change it: if it has an escape
+    // sequence, or a double quote inside single quotes.
+    bool escaped_;
   };
 
   class ErrorInfo {
@@ -936,19 +973,30 @@ private:
 
   using Errors = std::deque<ErrorInfo>;
 
+  bool readDocument(Value& root, bool collectComments);
   bool readToken(Token& token);
+  bool scanToken(Token& token);
+  bool resumeToken(Token& token);
+  bool fillBuffer();
   void skipSpaces();
   void skipBom(bool skipBom);
   bool match(const Char* pattern, int patternLength);
   bool readComment();
   bool readCStyleComment(bool* containsNewLineResult);
   bool readCppStyleComment();
-  bool readString();
-  bool readStringSingleQuote();
+  bool readString(Token& token);
+  bool readStringSingleQuote(Token& token);
   bool readNumber(bool checkInf);
+  void readNumberParts();
   bool readValue();
   bool readObject(Token& token);
   bool readArray(Token& token);
+  bool skipContainer(Token& token, ValueType type);
+  bool emitValue(Token& token, size_t depth);
+  bool emitObject(Token& token, size_t depth);
+  bool emitArray(Token& token, size_t depth);
+  bool emitString(Token& token);
+  bool checkHandler(bool accepted, Token& token);
   bool decodeNumber(Token& token);
   bool decodeNumber(Token& token, Value& decoded);
   bool decodeString(Token& token);
@@ -969,11 +1017,16 @@ private:
   void getLocationLineAndColumn(Location location, int& line,
                                 int& column) const;
   String getLocationLineAndColumn(Location location) const;
+  ptrdiff_t offsetOf(Location location) const;
+  void setOffsetStart(Location start);
+  void setOffsetLimit(Location limit);
   void addComment(Location begin, Location end, CommentPlacement placement);
   void skipCommentTokens(Token& token);
 
   static String normalizeEOL(Location begin, Location end);
   static bool containsNewLine(Location begin, Location end);
+  static bool isPlainString(const Token& token);
+  bool canBorrow(const Token& token) const;
 
   using Nodes = std::stack<Value*>;
 
@@ -990,6 +1043,44 @@ private:
 
   OurFeatures const features_;
   bool collectComments_ = false;
+  ParseHandler* handler_ = nullptr;
+  // If set, containers and strings are allocated from it.
+  Arena* arena_ = nullptr;
+  // If features_.internKeys_, the member names of every parse, shared with
+  // the values built by them.
+  std::unique_ptr<NamePool> names_;
+  // If features_.internValues_, the values of the current parse, which equal
+  // values take the payload of.
+  std::unique_ptr<ValuePool> values_;
+  // Escaped strings and member names are decoded here, so that its capacity
+  // is reused by every string of every parse.
+  String scratch_{};
+  // If features_.lazy_, reads the arrays and objects which are skipped.
+  const LazySource* lazy_ = nullptr;
+  // The brackets open in the container being skipped, true for '{'.
+  std::vector<bool> skippedBrackets_;
+
+  // When reading from a stream, [begin_, end_) is the part of the document
+  // held in buffer_, which is refilled from stream_ one block at a time.
+  IStream* stream_ = nullptr;
+  // Where the document and the comments after it end; the rest of buffer_
+  // was read from stream_ ahead of time.
+  Location documentEnd_ = nullptr;
+  // If the string, number or comment last scanned ran into end_ before it
+  // was complete, where its scan can go on from once buffer_ is refilled;
+  // numberPart_ is the part of a number it stopped in.
+  Location resume_ = nullptr;
+  NumberPart numberPart_ = numberIntegral;
+  String buffer_{};
+  String block_{};
+  // The bytes, line breaks, and columns of the current line dropped from the
+  // front of buffer_ so far.
+  ptrdiff_t discarded_ = 0;
+  int discardedLines_ = 0;
+  ptrdiff_t discardedColumns_ = 0;
+  // Set until the root value turns out to be an array or an object, as
+  // the strictRoot_ error is reported at the start of the document.
+  bool keepDocumentStart_ = false;
 }; // OurReader
 
 // complete copy of Read impl, for OurReader
@@ -999,16 +1090,135 @@ bool OurReader::containsNewLine(OurReader::Location begin,
   return std::any_of(begin, end, [](char b) { return b == '\n' || b == '\r'; });
 }
 
-OurReader::OurReader(OurFeatures const& features) : features_(features) {}
+// True if decoding the string token would not change any character, so its
+// contents can be used in place.
+bool OurReader::isPlainString(const Token& token) { return !token.escaped_; }
+
+// True if the string token can be stored as a view of the document.
+bool OurReader::canBorrow(const Token& token) const {
+  return features_.borrowStrings_ && !stream_ && isPlainString(token);
+}
+
+OurReader::OurReader(OurFeatures const& features) : features_(features) {
+  if (features_.internKeys_)
+    names_.reset(new NamePool);
+  if (features_.internValues_)
+    values_.reset(new ValuePool);
+}
+
+// Reads the lazy arrays and objects of a document, each with a reader of
+// its own, so that values of one document can be read by several threads.
+class OurLazySource : public LazySource {
+public:
+  OurLazySource(OurFeatures const& features, const char* document)
+      : features_(features), document_(document) {}
+  void read(char const* begin, char const* end, Value& value) const override {
+    OurReader reader(features_);
+    reader.readLazy(document_, begin, end, value, *this);
+  }
+  bool hashesMembers() const override {
+    return features_.hashObjectMembers_;
+  }
+
+private:
+  OurFeatures const features_;
+  // Where offsets and line numbers are counted from.
+  const char* const document_;
+};
 
 bool OurReader::parse(const char* beginDoc, const char* endDoc, Value& root,
-                      bool collectComments) {
+                      bool collectComments, Arena* arena) {
+  stream_ = nullptr;
+  arena_ = arena;
+  discarded_ = 0;
+  discardedLines_ = 0;
+  discardedColumns_ = 0;
+  begin_ = beginDoc;
+  end_ = endDoc;
+  if (!features_.lazy_ || arena)
+    return readDocument(root, collectComments);
+  // The lazy values of the document keep the source once it is parsed.
+  const auto source = std::make_shared<OurLazySource>(features_, beginDoc);
+  lazy_ = source.get();
+  bool ok = false;
+  try {
+    ok = readDocument(root, false);
+  } catch (...) {
+    lazy_ = nullptr;
+    throw;
+  }
+  lazy_ = nullptr;
+  return ok;
+}
+
+void OurReader::readLazy(const char* document, const char* begin,
+                         const char* end, Value& value,
+                         const LazySource& source) {
+  stream_ = nullptr;
+  arena_ = nullptr;
+  lazy_ = &source;
+  discarded_ = 0;
+  discardedLines_ = 0;
+  discardedColumns_ = 0;
+  begin_ = document;
+  end_ = end;
+  current_ = begin;
+  collectComments_ = false;
+  errors_.clear();
+  while (!nodes_.empty())
+    nodes_.pop();
+  nodes_.push(&value);
+  Token token;
+  readToken(token);
+  // [begin, end) was checked to be an array or an object by skipContainer().
+  const bool ok = token.type_ == tokenObjectBegin ? readObject(token)
+                                                  : readArray(token);
+  nodes_.pop();
+  lazy_ = nullptr;
+  if (!ok)
+    throwRuntimeError(getFormattedErrorMessages());
+}
+
+// The longest token that is not delimited by the character following it is
+// "-Infinity"; the buffer is kept at least this far ahead of a token start.
+static const ptrdiff_t streamLookahead = 16;
+
+bool OurReader::parse(IStream& sin, Value& root, bool collectComments) {
+  stream_ = &sin;
+  arena_ = nullptr;
+  discarded_ = 0;
+  discardedLines_ = 0;
+  discardedColumns_ = 0;
+  keepDocumentStart_ = features_.strictRoot_;
+  block_.resize(features_.streamBlockSize_);
+  buffer_.clear();
+  begin_ = buffer_.data();
+  end_ = begin_;
+  current_ = begin_;
+  lastValueEnd_ = nullptr;
+  errors_.clear();
+  while (end_ - current_ < streamLookahead && fillBuffer()) {
+  }
+  bool ok = readDocument(root, collectComments);
+  // A short last block sets failbit along with eofbit, though the stream
+  // merely ended.
+  std::ios_base::iostate state = sin.rdstate();
+  if (state & std::ios_base::eofbit)
+    state &= ~std::ios_base::failbit;
+  sin.clear();
+  // Give the bytes read past the document back, if the stream can seek.
+  if (documentEnd_ != end_ && sin.tellg() != IStream::pos_type(-1) &&
+      sin.seekg(documentEnd_ - end_, std::ios_base::cur))
+    return ok;
+  sin.clear(state);
+  return ok;
+}
+
+bool OurReader::readDocument(Value& root, bool collectComments) {
   if (!features_.allowComments_) {
     collectComments = false;
   }
 
-  begin_ = beginDoc;
-  end_ = endDoc;
   collectComments_ = collectComments;
   current_ = begin_;
   lastValueEnd_ = nullptr;
@@ -1021,10 +1231,16 @@ bool OurReader::parse(const char* beginDoc, const char* endDoc, Value& root,
 
   // skip byte order mark if it exists at the beginning of the UTF-8 text.
   skipBom(features_.skipBom_);
+  if (values_)
+    values_->clear();
   bool successful = readValue();
   nodes_.pop();
+  // Values of this document must not outlive it through the pool.
+  if (values_)
+    values_->clear();
   Token token;
   skipCommentTokens(token);
+  documentEnd_ = token.type_ == tokenEndOfStream ? end_ : token.start_;
   if (features_.failIfExtra_ && (token.type_ != tokenEndOfStream)) {
     addError("Extra non-whitespace after JSON value.", token);
     return false;
@@ -1036,8 +1252,8 @@ bool OurReader::parse(const char* beginDoc, const char* endDoc, Value& root,
       // Set error location to start of doc, ideally should be first token found
       // in doc
       token.type_ = tokenError;
-      token.start_ = beginDoc;
-      token.end_ = endDoc;
+      token.start_ = begin_;
+      token.end_ = end_;
       addError(
           "A valid JSON document must be either an array or an object value.",
           token);
@@ -1047,6 +1263,42 @@ bool OurReader::parse(const char* beginDoc, const char* endDoc, Value& root,
   return successful;
 }
 
+bool OurReader::parse(const char* beginDoc, const char* endDoc,
+                      ParseHandler& handler) {
+  stream_ = nullptr;
+  discarded_ = 0;
+  discardedLines_ = 0;
+  discardedColumns_ = 0;
+  begin_ = beginDoc;
+  end_ = endDoc;
+  collectComments_ = false;
+  current_ = begin_;
+  lastValueEnd_ = nullptr;
+  lastValue_ = nullptr;
+  commentsBefore_.clear();
+  errors_.clear();
+  handler_ = &handler;
+
+  // skip byte order mark if it exists at the beginning of the UTF-8 text.
+  skipBom(features_.skipBom_);
+  Token token;
+  skipCommentTokens(token);
+  if (features_.strictRoot_ && token.type_ != tokenObjectBegin &&
+      token.type_ != tokenArrayBegin) {
+    return addError(
+        "A valid JSON document must be either an array or an object value.",
+        token);
+  }
+  if (!emitValue(token, 1))
+    return false;
+  skipCommentTokens(token);
+  if (features_.failIfExtra_ && (token.type_ != tokenEndOfStream)) {
+    addError("Extra non-whitespace after JSON value.", token);
+    return false;
+  }
+  return true;
+}
+
 bool OurReader::readValue() {
   //  To preserve the old behaviour we cast size_t to int.
   if (nodes_.size() > features_.stackLimit_)
@@ -1062,12 +1314,13 @@ bool OurReader::readValue() {
 
   switch (token.type_) {
   case tokenObjectBegin:
-    successful = readObject(token);
-    currentValue().setOffsetLimit(current_ - begin_);
+    successful =
+        lazy_ ? skipContainer(token, objectValue) : readObject(token);
+    setOffsetLimit(current_);
     break;
   case tokenArrayBegin:
-    successful = readArray(token);
-    currentValue().setOffsetLimit(current_ - begin_);
+    successful = lazy_ ? skipContainer(token, arrayValue) : readArray(token);
+    setOffsetLimit(current_);
     break;
   case tokenNumber:
     successful = decodeNumber(token);
@@ -1078,38 +1331,38 @@ bool OurReader::readValue() {
   case tokenTrue: {
     Value v(true);
     currentValue().swapPayload(v);
-    currentValue().setOffsetStart(token.start_ - begin_);
-    currentValue().setOffsetLimit(token.end_ - begin_);
+    setOffsetStart(token.start_);
+    setOffsetLimit(token.end_);
   } break;
   case tokenFalse: {
     Value v(false);
     currentValue().swapPayload(v);
-    currentValue().setOffsetStart(token.start_ - begin_);
-    currentValue().setOffsetLimit(token.end_ - begin_);
+    setOffsetStart(token.start_);
+    setOffsetLimit(token.end_);
   } break;
   case tokenNull: {
     Value v;
     currentValue().swapPayload(v);
-    currentValue().setOffsetStart(token.start_ - begin_);
-    currentValue().setOffsetLimit(token.end_ - begin_);
+    setOffsetStart(token.start_);
+    setOffsetLimit(token.end_);
   } break;
   case tokenNaN: {
     Value v(std::numeric_limits<double>::quiet_NaN());
     currentValue().swapPayload(v);
-    currentValue().setOffsetStart(token.start_ - begin_);
-    currentValue().setOffsetLimit(token.end_ - begin_);
+    setOffsetStart(token.start_);
+    setOffsetLimit(token.end_);
   } break;
   case tokenPosInf: {
     Value v(std::numeric_limits<double>::infinity());
     currentValue().swapPayload(v);
-    currentValue().setOffsetStart(token.start_ - begin_);
-    currentValue().setOffsetLimit(token.end_ - begin_);
+    setOffsetStart(token.start_);
+    setOffsetLimit(token.end_);
   } break;
   case tokenNegInf: {
     Value v(-std::numeric_limits<double>::infinity());
     currentValue().swapPayload(v);
-    currentValue().setOffsetStart(token.start_ - begin_);
-    currentValue().setOffsetLimit(token.end_ - begin_);
+    setOffsetStart(token.start_);
+    setOffsetLimit(token.end_);
   } break;
   case tokenArraySeparator:
   case tokenObjectEnd:
@@ -1120,16 +1373,26 @@ bool OurReader::readValue() {
       current_--;
       Value v;
       currentValue().swapPayload(v);
-      currentValue().setOffsetStart(current_ - begin_ - 1);
-      currentValue().setOffsetLimit(current_ - begin_);
+      if (features_.collectOffsets_) {
+        currentValue().setOffsetStart(offsetOf(current_) - 1);
+        currentValue().setOffsetLimit(offsetOf(current_));
+      }
       break;
     } // else, fall through ...
   default:
-    currentValue().setOffsetStart(token.start_ - begin_);
-    currentValue().setOffsetLimit(token.end_ - begin_);
+    setOffsetStart(token.start_);
+    setOffsetLimit(token.end_);
     return addError("Syntax error: value, object or array expected.", token);
   }
 
+  // Members are shared before their container, which can then be compared
+  // with the containers of the pool by their hashes. Sharing would read a
+  // lazy container.
+  if (values_ && successful &&
+      !(lazy_ && (token.type_ == tokenObjectBegin ||
+                  token.type_ == tokenArrayBegin)))
+    currentValue().share(*values_);
+
   if (collectComments_) {
     lastValueEnd_ = current_;
     lastValueHasAComment_ = false;
@@ -1151,7 +1414,45 @@ void OurReader::skipCommentTokens(Token& token) {
 
 bool OurReader::readToken(Token& token) {
   skipSpaces();
+  if (!stream_)
+    return scanToken(token);
+  while (end_ - current_ < streamLookahead && fillBuffer()) {
+  }
+  // A token that runs into the end of the buffer may continue in the next
+  // block of the stream. A string, number or comment is then read on from
+  // where its scan stopped, and any other token, which is short, is scanned
+  // again. Comments are only collected once the token is known to be
+  // complete.
+  const bool collectComments = collectComments_;
+  collectComments_ = false;
+  bool ok = scanToken(token);
+  while (current_ == end_) {
+    const ptrdiff_t resume = resume_ ? resume_ - token.start_ : 0;
+    current_ = token.start_;
+    if (!fillBuffer()) {
+      current_ = end_;
+      break;
+    }
+    if (resume) {
+      token.start_ = current_;
+      current_ += resume;
+      ok = resumeToken(token);
+    } else {
+      ok = scanToken(token);
+    }
+  }
+  collectComments_ = collectComments;
+  if (collectComments_ && token.type_ == tokenComment) {
+    current_ = token.start_;
+    ok = scanToken(token);
+  }
+  return ok;
+}
+
+bool OurReader::scanToken(Token& token) {
   token.start_ = current_;
+  token.escaped_ = false;
+  resume_ = nullptr;
   Char c = getNextChar();
   bool ok = true;
   switch (c) {
@@ -1169,12 +1470,12 @@ bool OurReader::readToken(Token& token) {
     break;
   case '"':
     token.type_ = tokenString;
-    ok = readString();
+    ok = readString(token);
     break;
   case '\'':
     if (features_.allowSingleQuotes_) {
       token.type_ = tokenString;
-      ok = readStringSingleQuote();
+      ok = readStringSingleQuote(token);
     } else {
       // If we don't allow single quotes, this is a failure case.
       ok = false;
@@ -1260,14 +1561,96 @@ bool OurReader::readToken(Token& token) {
   return ok;
 }
 
+// Reads on the string, number or comment token from current_, where its scan
+// stopped at the end of the previous buffer.
+bool OurReader::resumeToken(Token& token) {
+  resume_ = nullptr;
+  bool ok = true;
+  bool containsNewLine = false;
+  switch (*token.start_) {
+  case '"':
+    token.type_ = tokenString;
+    ok = readString(token);
+    break;
+  case '\'':
+    token.type_ = tokenString;
+    ok = readStringSingleQuote(token);
+    break;
+  case '/':
+    token.type_ = tokenComment;
+    ok = token.start_[1] == '*' ? readCStyleComment(&containsNewLine)
+                                : readCppStyleComment();
+    break;
+  default:
+    token.type_ = tokenNumber;
+    readNumberParts();
+    break;
+  }
+  if (!ok)
+    token.type_ = tokenError;
+  token.end_ = current_;
+  return ok;
+}
+
 void OurReader::skipSpaces() {
-  while (current_ != end_) {
-    Char c = *current_;
-    if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
-      ++current_;
-    else
-      break;
+  do {
+    current_ = skipJsonSpaces(current_, end_);
+    if (current_ != end_)
+      return;
+  } while (stream_ && fillBuffer());
+}
+
+// Reads the next block of stream_ into buffer_, and returns false at the end
+// of the stream. The text before current_ is dropped first, except what the
+// comment placement (lastValueEnd_), the reported errors or a strictRoot_
+// error may still refer to.
+// Every location into the buffer is rebased.
+bool OurReader::fillBuffer() {
+  stream_->read(&block_[0], static_cast<std::streamsize>(block_.size()));
+  const auto count = static_cast<size_t>(stream_->gcount());
+  if (count == 0)
+    return false;
+
+  Location keep = errors_.empty() && !keepDocumentStart_ ? current_ : begin_;
+  if (lastValueEnd_ && lastValueEnd_ < keep)
+    keep = lastValueEnd_;
+  if (keep != begin_ && keep[-1] == '\r') // do not split a DOS EOL
+    --keep;
+  for (Location p = begin_; p != keep; ++p) {
+    if (*p == '\r' && p + 1 != keep && p[1] == '\n')
+      continue;
+    if (*p == '\r' || *p == '\n') {
+      ++discardedLines_;
+      discardedColumns_ = 0;
+    } else {
+      ++discardedColumns_;
+    }
+  }
+  discarded_ += keep - begin_;
+
+  // Locations are kept as offsets from keep while buffer_ changes.
+  const ptrdiff_t current = current_ - keep;
+  const ptrdiff_t lastValueEnd = lastValueEnd_ ? lastValueEnd_ - keep : -1;
+  std::vector<ptrdiff_t> errorLocations;
+  for (const auto& error : errors_) {
+    errorLocations.push_back(error.token_.start_ - keep);
+    errorLocations.push_back(error.token_.end_ - keep);
+    errorLocations.push_back(error.extra_ ? error.extra_ - keep : -1);
+  }
+  buffer_.erase(0, static_cast<size_t>(keep - buffer_.data()));
+  buffer_.append(block_.data(), count);
+  begin_ = buffer_.data();
+  end_ = begin_ + buffer_.size();
+  current_ = begin_ + current;
+  lastValueEnd_ = lastValueEnd < 0 ? nullptr : begin_ + lastValueEnd;
+  auto location = errorLocations.begin();
+  for (auto& error : errors_) {
+    error.token_.start_ = begin_ + *location++;
+    error.token_.end_ = begin_ + *location++;
+    error.extra_ = *location < 0 ? nullptr : begin_ + *location;
+    ++location;
   }
+  return true;
 }
 
 void OurReader::skipBom(bool skipBom) {
@@ -1362,12 +1745,16 @@ bool OurReader::readCStyleComment(bool* containsNewLineResult) {
 
   while ((current_ + 1) < end_) {
     Char c = getNextChar();
-    if (c == '*' && *current_ == '/')
-      break;
+    if (c == '*' && *current_ == '/') {
+      ++current_;
+      return true;
+    }
     if (c == '\n')
       *containsNewLineResult = true;
   }
 
+  // The last char may yet start the "*/".
+  resume_ = current_;
   return getNextChar() == '/';
 }
 
@@ -1375,15 +1762,16 @@ bool OurReader::readCppStyleComment() {
   while (current_ != end_) {
     Char c = getNextChar();
     if (c == '\n')
-      break;
+      return true;
     if (c == '\r') {
       // Consume DOS EOL. It will be normalized in addComment.
       if (current_ != end_ && *current_ == '\n')
         getNextChar();
       // Break on Moc OS 9 EOL.
-      break;
+      return true;
     }
   }
+  resume_ = current_;
   return true;
 }
 
@@ -1393,56 +1781,89 @@ bool OurReader::readNumber(bool checkInf) {
     current_ = ++p;
     return false;
   }
-  char c = '0'; // stopgap for already consumed character
-  // integral part
-  while (c >= '0' && c <= '9')
-    c = (current_ = p) < end_ ? *p++ : '\0';
-  // fractional part
-  if (c == '.') {
-    c = (current_ = p) < end_ ? *p++ : '\0';
-    while (c >= '0' && c <= '9')
-      c = (current_ = p) < end_ ? *p++ : '\0';
-  }
-  // exponential part
-  if (c == 'e' || c == 'E') {
-    c = (current_ = p) < end_ ? *p++ : '\0';
-    if (c == '+' || c == '-')
-      c = (current_ = p) < end_ ? *p++ : '\0';
-    while (c >= '0' && c <= '9')
-      c = (current_ = p) < end_ ? *p++ : '\0';
-  }
+  // The already consumed character counts as an integral digit.
+  numberPart_ = numberIntegral;
+  readNumberParts();
   return true;
 }
-bool OurReader::readString() {
-  Char c = 0;
-  while (current_ != end_) {
-    c = getNextChar();
-    if (c == '\\')
-      getNextChar();
-    else if (c == '"')
-      break;
+
+// Reads the rest of a number from current_, which is in numberPart_.
+void OurReader::readNumberParts() {
+  Location p = current_;
+  for (;;) {
+    const Location digits = p;
+    while (p != end_ && *p >= '0' && *p <= '9')
+      ++p;
+    if (p != digits && numberPart_ == numberExponentSign)
+      numberPart_ = numberExponent;
+    current_ = p;
+    if (p == end_) {
+      resume_ = p;
+      return;
+    }
+    const Char c = *p++;
+    if (c == '.' && numberPart_ == numberIntegral)
+      numberPart_ = numberFraction;
+    else if ((c == 'e' || c == 'E') && numberPart_ <= numberFraction)
+      numberPart_ = numberExponentSign;
+    else if ((c == '+' || c == '-') && numberPart_ == numberExponentSign)
+      numberPart_ = numberExponent;
+    else
+      return;
+  }
+}
+
+bool OurReader::readString(Token& token) {
+  for (;;) {
+    current_ = findQuoteOrEscape(current_, end_, '"');
+    if (current_ == end_) {
+      resume_ = current_;
+      return false;
+    }
+    if (*current_++ == '"')
+      return true;
+    token.escaped_ = true;
+    if (current_ == end_) {
+      resume_ = current_ - 1; // the escaped char is still to come
+      return false;
+    }
+    ++current_; // skip the escaped char
   }
-  return c == '"';
 }
 
-bool OurReader::readStringSingleQuote() {
-  Char c = 0;
+bool OurReader::readStringSingleQuote(Token& token) {
   while (current_ != end_) {
-    c = getNextChar();
-    if (c == '\\')
-      getNextChar();
-    else if (c == '\'')
-      break;
+    Char c = getNextChar();
+    if (c == '\\') {
+      token.escaped_ = true;
+      if (current_ == end_) {
+        resume_ = current_ - 1; // the escaped char is still to come
+        return false;
+      }
+      ++current_;
+    } else if (c == '"') {
+      token.escaped_ = true;
+    } else if (c == '\'') {
+      return true;
+    }
   }
-  return c == '\'';
+  resume_ = current_;
+  return false;
 }
 
 bool OurReader::readObject(Token& token) {
   Token tokenName;
-  String name;
-  Value init(objectValue);
+  // The member name, either in the document or decoded into scratch_. It is
+  // only needed until the member is created, before its value is read.
+  Location nameBegin = nullptr;
+  Location nameEnd = nullptr;
+  bool emptyName = true;
+  Value init = arena_ && !features_.hashObjectMembers_
+                   ? Value(objectValue, *arena_)
+                   : Value(objectValue, features_.hashObjectMembers_);
   currentValue().swapPayload(init);
-  currentValue().setOffsetStart(token.start_ - begin_);
+  keepDocumentStart_ = false;
+  setOffsetStart(token.start_);
   while (readToken(tokenName)) {
     bool initialTokenOk = true;
     while (tokenName.type_ == tokenComment && initialTokenOk)
@@ -1450,25 +1871,35 @@ bool OurReader::readObject(Token& token) {
     if (!initialTokenOk)
       break;
     if (tokenName.type_ == tokenObjectEnd &&
-        (name.empty() ||
+        (emptyName ||
          features_.allowTrailingCommas_)) // empty object or trailing comma
       return true;
-    name.clear();
+    scratch_.clear();
+    // A stream may be refilled before the member is created, so only a name
+    // in a whole document can be used in place.
+    bool inPlace = false;
+    bool borrowName = false;
     if (tokenName.type_ == tokenString) {
-      if (!decodeString(tokenName, name))
+      inPlace = isPlainString(tokenName) && !stream_;
+      borrowName = canBorrow(tokenName);
+      if (!inPlace && !decodeString(tokenName, scratch_))
         return recoverFromError(tokenObjectEnd);
     } else if (tokenName.type_ == tokenNumber && features_.allowNumericKeys_) {
       Value numberName;
       if (!decodeNumber(tokenName, numberName))
         return recoverFromError(tokenObjectEnd);
-      name = numberName.asString();
+      scratch_ = numberName.asString();
     } else {
       break;
     }
-    if (name.length() >= (1U << 30))
+    nameBegin = inPlace ? tokenName.start_ + 1 : scratch_.data();
+    nameEnd = inPlace ? tokenName.end_ - 1 : scratch_.data() + scratch_.size();
+    emptyName = nameBegin == nameEnd;
+    if (nameEnd - nameBegin >= (1 << 30))
       throwRuntimeError("keylength >= 2^30");
-    if (features_.rejectDupKeys_ && currentValue().isMember(name)) {
-      String msg = "Duplicate key: '" + name + "'";
+    if (features_.rejectDupKeys_ &&
+        currentValue().isMember(nameBegin, nameEnd)) {
+      String msg = "Duplicate key: '" + String(nameBegin, nameEnd) + "'";
       return addErrorAndRecover(msg, tokenName, tokenObjectEnd);
     }
 
@@ -1477,7 +1908,10 @@ bool OurReader::readObject(Token& token) {
       return addErrorAndRecover("Missing ':' after object member name", colon,
                                 tokenObjectEnd);
     }
-    Value& value = currentValue()[name];
+    Value& value =
+        names_ && !borrowName
+            ? *currentValue().demand(nameBegin, nameEnd, *names_)
+            : *currentValue().demand(nameBegin, nameEnd, borrowName);
     nodes_.push(&value);
     bool ok = readValue();
     nodes_.pop();
@@ -1501,10 +1935,75 @@ bool OurReader::readObject(Token& token) {
                             tokenObjectEnd);
 }
 
+// Find the end of the array or object starting at token, and make it the
+// lazy value of the current node. Only strings, comments and brackets are
+// looked at; the rest is checked when the value is read.
+bool OurReader::skipContainer(Token& token, ValueType type) {
+  keepDocumentStart_ = false;
+  setOffsetStart(token.start_);
+  Token skipped;
+  skippedBrackets_.assign(1, type == objectValue);
+  // Nothing in the skipped text may be nested deeper than readValue()
+  // allows, or reading it later would go past the limit.
+  auto checkDepth = [this] {
+    if (nodes_.size() + skippedBrackets_.size() <= features_.stackLimit_)
+      return;
+    char const* next = skipJsonSpaces(current_, end_);
+    if (next != end_ && *next != ']' && *next != '}')
+      throwRuntimeError("Exceeded stackLimit in readValue().");
+  };
+  checkDepth();
+  while (!skippedBrackets_.empty()) {
+    current_ = findStructuralChar(current_, end_);
+    if (current_ == end_)
+      break;
+    bool ok = true;
+    const Char c = *current_++;
+    switch (c) {
+    case '[':
+    case '{':
+      skippedBrackets_.push_back(c == '{');
+      checkDepth();
+      break;
+    case ']':
+    case '}':
+      if (skippedBrackets_.back() != (c == '}')) {
+        skipped.type_ = c == '}' ? tokenObjectEnd : tokenArrayEnd;
+        skipped.start_ = current_ - 1;
+        skipped.end_ = current_;
+        return addError(skippedBrackets_.back()
+                            ? "Missing ',' or '}' in object declaration"
+                            : "Missing ',' or ']' in array declaration",
+                        skipped);
+      }
+      skippedBrackets_.pop_back();
+      break;
+    case '"':
+      ok = readString(skipped);
+      break;
+    case '\'':
+      ok = !features_.allowSingleQuotes_ || readStringSingleQuote(skipped);
+      break;
+    case '/':
+      ok = !features_.allowComments_ || readComment();
+      break;
+    }
+    if (!ok)
+      break;
+  }
+  if (!skippedBrackets_.empty())
+    return addError(type == objectValue ? "Missing '}' or object member name"
+                                        : "Missing ',' or ']' in array",
+                    token, current_);
+  lazy_->assign(currentValue(), type, token.start_, current_);
+  return true;
+}
+
 bool OurReader::readArray(Token& token) {
-  Value init(arrayValue);
+  Value init = arena_ ? Value(arrayValue, *arena_) : Value(arrayValue);
   currentValue().swapPayload(init);
-  currentValue().setOffsetStart(token.start_ - begin_);
+  keepDocumentStart_ = false;
+  setOffsetStart(token.start_);
   int index = 0;
   for (;;) {
     skipSpaces();
@@ -1540,16 +2039,189 @@ bool OurReader::readArray(Token& token) {
     if (currentToken.type_ == tokenArrayEnd)
       break;
   }
+  // Sharing the array through values_ would store it as usual again.
+  if (features_.packNumbers_ && !values_)
+    currentValue().packNumbers();
   return true;
 }
 
+// The event-driven counterparts of readValue(), readObject() and readArray().
+// They accept the same input, but report it to handler_ and stop at the first
+// error instead of recovering from it.
+
+bool OurReader::emitValue(Token& token, size_t depth) {
+  if (depth > features_.stackLimit_)
+    throwRuntimeError("Exceeded stackLimit in readValue().");
+  switch (token.type_) {
+  case tokenObjectBegin:
+    return emitObject(token, depth);
+  case tokenArrayBegin:
+    return emitArray(token, depth);
+  case tokenNumber: {
+    Value decoded;
+    if (!decodeNumber(token, decoded))
+      return false;
+    if (decoded.type() == intValue)
+      return checkHandler(handler_->onInt(decoded.asLargestInt()), token);
+    if (decoded.type() == uintValue)
+      return checkHandler(handler_->onUInt(decoded.asLargestUInt()), token);
+    return checkHandler(handler_->onDouble(decoded.asDouble()), token);
+  }
+  case tokenString:
+    return emitString(token);
+  case tokenTrue:
+    return checkHandler(handler_->onBool(true), token);
+  case tokenFalse:
+    return checkHandler(handler_->onBool(false), token);
+  case tokenNull:
+    return checkHandler(handler_->onNull(), token);
+  case tokenNaN:
+    return checkHandler(
+        handler_->onDouble(std::numeric_limits<double>::quiet_NaN()), token);
+  case tokenPosInf:
+    return checkHandler(
+        handler_->onDouble(std::numeric_limits<double>::infinity()), token);
+  case tokenNegInf:
+    return checkHandler(
+        handler_->onDouble(-std::numeric_limits<double>::infinity()), token);
+  case tokenArraySeparator:
+  case tokenObjectEnd:
+  case tokenArrayEnd:
+    if (features_.allowDroppedNullPlaceholders_) {
+      // "Un-read" the current token and report a null.
+      current_--;
+      return checkHandler(handler_->onNull(), token);
+    } // else, fall through ...
+  default:
+    return addError("Syntax error: value, object or array expected.", token);
+  }
+}
+
+bool OurReader::emitObject(Token& token, size_t depth) {
+  if (!checkHandler(handler_->onStartObject(), token))
+    return false;
+  Token tokenName;
+  String name;
+  Location nameBegin = nullptr;
+  Location nameEnd = nullptr;
+  std::set<String> names; // only filled if rejectDupKeys_
+  while (readToken(tokenName)) {
+    bool initialTokenOk = true;
+    while (tokenName.type_ == tokenComment && initialTokenOk)
+      initialTokenOk = readToken(tokenName);
+    if (!initialTokenOk)
+      break;
+    if (tokenName.type_ == tokenObjectEnd &&
+        (nameBegin == nameEnd ||
+         features_.allowTrailingCommas_)) // empty object or trailing comma
+      return checkHandler(handler_->onEndObject(), tokenName);
+    name.clear();
+    bool plainName = false;
+    if (tokenName.type_ == tokenString) {
+      plainName = isPlainString(tokenName);
+      if (!plainName && !decodeString(tokenName, name))
+        return false;
+    } else if (tokenName.type_ == tokenNumber && features_.allowNumericKeys_) {
+      Value numberName;
+      if (!decodeNumber(tokenName, numberName))
+        return false;
+      name = numberName.asString();
+    } else {
+      break;
+    }
+    nameBegin = plainName ? tokenName.start_ + 1 : name.data();
+    nameEnd = plainName ? tokenName.end_ - 1 : name.data() + name.length();
+    if (nameEnd - nameBegin >= (1 << 30))
+      throwRuntimeError("keylength >= 2^30");
+    if (features_.rejectDupKeys_ && !names.emplace(nameBegin, nameEnd).second)
+      return addError("Duplicate key: '" + String(nameBegin, nameEnd) + "'",
+                      tokenName);
+
+    Token colon;
+    if (!readToken(colon) || colon.type_ != tokenMemberSeparator)
+      return addError("Missing ':' after object member name", colon);
+    if (!checkHandler(handler_->onKey(nameBegin, nameEnd), tokenName))
+      return false;
+    Token value;
+    skipCommentTokens(value);
+    if (!emitValue(value, depth + 1))
+      return false;
+
+    Token comma;
+    if (!readToken(comma) ||
+        (comma.type_ != tokenObjectEnd && comma.type_ != tokenArraySeparator &&
+         comma.type_ != tokenComment)) {
+      return addError("Missing ',' or '}' in object declaration", comma);
+    }
+    bool finalizeTokenOk = true;
+    while (comma.type_ == tokenComment && finalizeTokenOk)
+      finalizeTokenOk = readToken(comma);
+    if (comma.type_ == tokenObjectEnd)
+      return checkHandler(handler_->onEndObject(), comma);
+  }
+  return addError("Missing '}' or object member name", tokenName);
+}
+
+bool OurReader::emitArray(Token& token, size_t depth) {
+  if (!checkHandler(handler_->onStartArray(), token))
+    return false;
+  bool empty = true;
+  for (;;) {
+    skipSpaces();
+    if (current_ != end_ && *current_ == ']' &&
+        (empty ||
+         (features_.allowTrailingCommas_ &&
+          !features_.allowDroppedNullPlaceholders_))) // empty array or trailing
+                                                      // comma
+    {
+      Token endArray;
+      readToken(endArray);
+      return checkHandler(handler_->onEndArray(), endArray);
+    }
+    empty = false;
+    Token value;
+    skipCommentTokens(value);
+    if (!emitValue(value, depth + 1))
+      return false;
+
+    Token currentToken;
+    // Accept Comment after last item in the array.
+    bool ok = readToken(currentToken);
+    while (currentToken.type_ == tokenComment && ok) {
+      ok = readToken(currentToken);
+    }
+    bool badTokenType = (currentToken.type_ != tokenArraySeparator &&
+                         currentToken.type_ != tokenArrayEnd);
+    if (!ok || badTokenType)
+      return addError("Missing ',' or ']' in array declaration", currentToken);
+    if (currentToken.type_ == tokenArrayEnd)
+      return checkHandler(handler_->onEndArray(), currentToken);
+  }
+}
+
+bool OurReader::emitString(Token& token) {
+  if (isPlainString(token))
+    return checkHandler(handler_->onString(token.start_ + 1, token.end_ - 1),
+                        token);
+  String decoded;
+  if (!decodeString(token, decoded))
+    return false;
+  return checkHandler(
+      handler_->onString(decoded.data(), decoded.data() + decoded.size()),
+      token);
+}
+
+bool OurReader::checkHandler(bool accepted, Token& token) {
+  return accepted || addError("Parsing stopped by the handler.", token);
+}
+
 bool OurReader::decodeNumber(Token& token) {
   Value decoded;
   if (!decodeNumber(token, decoded))
     return false;
   currentValue().swapPayload(decoded);
-  currentValue().setOffsetStart(token.start_ - begin_);
-  currentValue().setOffsetLimit(token.end_ - begin_);
+  setOffsetStart(token.start_);
+  setOffsetLimit(token.end_);
   return true;
 }
 
@@ -1638,13 +2310,17 @@ bool OurReader::decodeDouble(Token& token) {
   if (!decodeDouble(token, decoded))
     return false;
   currentValue().swapPayload(decoded);
-  currentValue().setOffsetStart(token.start_ - begin_);
-  currentValue().setOffsetLimit(token.end_ - begin_);
+  setOffsetStart(token.start_);
+  setOffsetLimit(token.end_);
   return true;
 }
 
 bool OurReader::decodeDouble(Token& token, Value& decoded) {
   double value = 0;
+  if (decodeDoubleFast(token.start_, token.end_, &value)) {
+    decoded = value;
+    return true;
+  }
   const String buffer(token.start_, token.end_);
   IStringStream is(buffer);
   if (!(is >> value)) {
@@ -1656,13 +2332,23 @@ bool OurReader::decodeDouble(Token& token, Value& decoded) {
 }
 
 bool OurReader::decodeString(Token& token) {
-  String decoded_string;
-  if (!decodeString(token, decoded_string))
-    return false;
-  Value decoded(decoded_string);
+  Value decoded;
+  if (canBorrow(token)) {
+    decoded = Value(token.start_ + 1, token.end_ - 1, true);
+  } else if (isPlainString(token)) {
+    decoded = arena_ ? Value(token.start_ + 1, token.end_ - 1, *arena_)
+                     : Value(token.start_ + 1, token.end_ - 1);
+  } else {
+    scratch_.clear();
+    if (!decodeString(token, scratch_))
+      return false;
+    char const* data = scratch_.data();
+    decoded = arena_ ? Value(data, data + scratch_.size(), *arena_)
+                     : Value(data, data + scratch_.size());
+  }
   currentValue().swapPayload(decoded);
-  currentValue().setOffsetStart(token.start_ - begin_);
-  currentValue().setOffsetLimit(token.end_ - begin_);
+  setOffsetStart(token.start_);
+  setOffsetLimit(token.end_);
   return true;
 }
 
@@ -1671,49 +2357,48 @@ bool OurReader::decodeString(Token& token, String& decoded) {
   Location current = token.start_ + 1; // skip '"'
   Location end = token.end_ - 1;       // do not include '"'
   while (current != end) {
+    // Copy everything up to the next escape sequence at once.
+    Location escape = findQuoteOrEscape(current, end, '"');
+    decoded.append(current, escape);
+    if (escape == end || *escape == '"')
+      break;
+    current = escape + 1;
+    if (current == end)
+      return addError("Empty escape sequence in string", token, current);
     Char c = *current++;
-    if (c == '"')
+    switch (c) {
+    case '"':
+      decoded += '"';
       break;
-    if (c == '\\') {
-      if (current == end)
-        return addError("Empty escape sequence in string", token, current);
-      Char escape = *current++;
-      switch (escape) {
-      case '"':
-        decoded += '"';
-        break;
-      case '/':
-        decoded += '/';
-        break;
-      case '\\':
-        decoded += '\\';
-        break;
-      case 'b':
-        decoded += '\b';
-        break;
-      case 'f':
-        decoded += '\f';
-        break;
-      case 'n':
-        decoded += '\n';
-        break;
-      case 'r':
-        decoded += '\r';
-        break;
-      case 't':
-        decoded += '\t';
-        break;
-      case 'u': {
-        unsigned int unicode;
-        if (!decodeUnicodeCodePoint(token, current, end, unicode))
-          return false;
-        decoded += codePointToUTF8(unicode);
-      } break;
-      default:
-        return addError("Bad escape sequence in string", token, current);
-      }
-    } else {
-      decoded += c;
+    case '/':
+      decoded += '/';
+      break;
+    case '\\':
+      decoded += '\\';
+      break;
+    case 'b':
+      decoded += '\b';
+      break;
+    case 'f':
+      decoded += '\f';
+      break;
+    case 'n':
+      decoded += '\n';
+      break;
+    case 'r':
+      decoded += '\r';
+      break;
+    case 't':
+      decoded += '\t';
+      break;
+    case 'u': {
+      unsigned int unicode;
+      if (!decodeUnicodeCodePoint(token, current, end, unicode))
+        return false;
+      decoded += codePointToUTF8(unicode);
+    } break;
+    default:
+      return addError("Bad escape sequence in string", token, current);
     }
   }
   return true;
@@ -1810,24 +2495,41 @@ void OurReader::getLocationLineAndColumn(Location location, int& line,
                                          int& column) const {
   Location current = begin_;
   Location lastLineStart = current;
-  line = 0;
+  ptrdiff_t lineStartColumn = discardedColumns_;
+  line = discardedLines_;
   while (current < location && current != end_) {
     Char c = *current++;
     if (c == '\r') {
       if (*current == '\n')
         ++current;
       lastLineStart = current;
+      lineStartColumn = 0;
       ++line;
     } else if (c == '\n') {
       lastLineStart = current;
+      lineStartColumn = 0;
       ++line;
     }
   }
   // column & line start at 1
-  column = int(location - lastLineStart) + 1;
+  column = int(location - lastLineStart + lineStartColumn) + 1;
   ++line;
 }
 
+ptrdiff_t OurReader::offsetOf(Location location) const {
+  return discarded_ + (location - begin_);
+}
+
+void OurReader::setOffsetStart(Location start) {
+  if (features_.collectOffsets_)
+    currentValue().setOffsetStart(offsetOf(start));
+}
+
+void OurReader::setOffsetLimit(Location limit) {
+  if (features_.collectOffsets_)
+    currentValue().setOffsetLimit(offsetOf(limit));
+}
+
 String OurReader::getLocationLineAndColumn(Location location) const {
   int line, column;
   getLocationLineAndColumn(location, line, column);
@@ -1853,8 +2555,8 @@ std::vector<OurReader::StructuredError> OurReader::getStructuredErrors() const {
   std::vector<OurReader::StructuredError> allErrors;
   for (const auto& error : errors_) {
     OurReader::StructuredError structured;
-    structured.offset_start = error.token_.start_ - begin_;
-    structured.offset_limit = error.token_.end_ - begin_;
+    structured.offset_start = offsetOf(error.token_.start_);
+    structured.offset_limit = offsetOf(error.token_.end_);
     structured.message = error.message_;
     allErrors.push_back(structured);
   }
@@ -1863,11 +2565,14 @@ std::vector<OurReader::StructuredError> OurReader::getStructuredErrors() const {
 
 class OurCharReader : public CharReader {
   bool const collectComments_;
+  bool const refersToDocument_;
   OurReader reader_;
 
 public:
   OurCharReader(bool collectComments, OurFeatures const& features)
-      : collectComments_(collectComments), reader_(features) {}
+      : collectComments_(collectComments),
+        refersToDocument_(features.borrowStrings_ || features.lazy_),
+        reader_(features) {}
   bool parse(char const* beginDoc, char const* endDoc, Value* root,
              String* errs) override {
     bool ok = reader_.parse(beginDoc, endDoc, *root, collectComments_);
@@ -1876,34 +2581,189 @@ public:
     }
     return ok;
   }
+  bool parseEvents(char const* beginDoc, char const* endDoc,
+                   ParseHandler* handler, String* errs) override {
+    bool ok = reader_.parse(beginDoc, endDoc, *handler);
+    if (errs) {
+      *errs = reader_.getFormattedErrorMessages();
+    }
+    return ok;
+  }
+  bool parseStream(IStream& sin, Value* root, String* errs) override {
+    bool ok = reader_.parse(sin, *root, collectComments_);
+    if (errs) {
+      *errs = reader_.getFormattedErrorMessages();
+    }
+    return ok;
+  }
+  bool parseInArena(char const* beginDoc, char const* endDoc, Arena* arena,
+                    Value* root, String* errs) override {
+    bool ok = reader_.parse(beginDoc, endDoc, *root, collectComments_, arena);
+    if (errs) {
+      *errs = reader_.getFormattedErrorMessages();
+    }
+    return ok;
+  }
+  bool refersToDocument() const override { return refersToDocument_; }
 };
 
+ParseHandler::~ParseHandler() = default;
+bool ParseHandler::onNull() { return true; }
+bool ParseHandler::onBool(bool /*value*/) { return true; }
+bool ParseHandler::onInt(LargestInt /*value*/) { return true; }
+bool ParseHandler::onUInt(LargestUInt /*value*/) { return true; }
+bool ParseHandler::onDouble(double /*value*/) { return true; }
+bool ParseHandler::onString(char const* /*begin*/, char const* /*end*/) {
+  return true;
+}
+bool ParseHandler::onStartObject() { return true; }
+bool ParseHandler::onKey(char const* /*begin*/, char const* /*end*/) {
+  return true;
+}
+bool ParseHandler::onEndObject() { return true; }
+bool ParseHandler::onStartArray() { return true; }
+bool ParseHandler::onEndArray() { return true; }
+
+// Reports value to handler as the events it would have been parsed from.
+static bool replayEvents(const Value& value, ParseHandler& handler) {
+  switch (value.type()) {
+  case nullValue:
+    return handler.onNull();
+  case intValue:
+    return handler.onInt(value.asLargestInt());
+  case uintValue:
+    return handler.onUInt(value.asLargestUInt());
+  case realValue:
+    return handler.onDouble(value.asDouble());
+  case stringValue: {
+    char const* begin = nullptr;
+    char const* end = nullptr;
+    value.getString(&begin, &end);
+    return handler.onString(begin, end);
+  }
+  case booleanValue:
+    return handler.onBool(value.asBool());
+  case arrayValue:
+    if (!handler.onStartArray())
+      return false;
+    for (const Value& element : value) {
+      if (!replayEvents(element, handler))
+        return false;
+    }
+    return handler.onEndArray();
+  case objectValue:
+    if (!handler.onStartObject())
+      return false;
+    for (auto it = value.begin(); it != value.end(); ++it) {
+      char const* end = nullptr;
+      char const* begin = it.memberName(&end);
+      if (!handler.onKey(begin, end) || !replayEvents(*it, handler))
+        return false;
+    }
+    return handler.onEndObject();
+  }
+  return true;
+}
+
+bool CharReader::parseStream(IStream& sin, Value* root, String* errs) {
+  OStringStream ssin;
+  ssin << sin.rdbuf();
+  String doc = ssin.str();
+  char const* begin = doc.data();
+  char const* end = begin + doc.size();
+  // Note that we do not actually need a null-terminator.
+  return parse(begin, end, root, errs);
+}
+
+bool CharReader::parseInArena(char const* beginDoc, char const* endDoc,
+                              Arena* /*arena*/, Value* root, String* errs) {
+  return parse(beginDoc, endDoc, root, errs);
+}
+
+bool CharReader::refersToDocument() const { return false; }
+
+bool CharReader::parseEvents(char const* beginDoc, char const* endDoc,
+                             ParseHandler* handler, String* errs) {
+  Value root;
+  if (!parse(beginDoc, endDoc, &root, errs))
+    return false;
+  if (!replayEvents(root, *handler)) {
+    if (errs)
+      *errs = "Parsing stopped by the handler.\n";
+    return false;
+  }
+  return true;
+}
+
 CharReaderBuilder::CharReaderBuilder() { setDefaults(&settings_); }
 CharReaderBuilder::~CharReaderBuilder() = default;
-CharReader* CharReaderBuilder::newCharReader() const {
-  bool collectComments = settings_["collectComments"].asBool();
+static OurFeatures featuresFromOptions(const CharReaderOptions& options) {
   OurFeatures features = OurFeatures::all();
-  features.allowComments_ = settings_["allowComments"].asBool();
-  features.allowTrailingCommas_ = settings_["allowTrailingCommas"].asBool();
-  features.strictRoot_ = settings_["strictRoot"].asBool();
+  features.allowComments_ = options.allowComments;
+  features.allowTrailingCommas_ = options.allowTrailingCommas;
+  features.strictRoot_ = options.strictRoot;
   features.allowDroppedNullPlaceholders_ =
-      settings_["allowDroppedNullPlaceholders"].asBool();
-  features.allowNumericKeys_ = settings_["allowNumericKeys"].asBool();
-  features.allowSingleQuotes_ = settings_["allowSingleQuotes"].asBool();
+      options.allowDroppedNullPlaceholders;
+  features.allowNumericKeys_ = options.allowNumericKeys;
+  features.allowSingleQuotes_ = options.allowSingleQuotes;
+  features.stackLimit_ = options.stackLimit;
+  features.failIfExtra_ = options.failIfExtra;
+  features.rejectDupKeys_ = options.rejectDupKeys;
+  features.allowSpecialFloats_ = options.allowSpecialFloats;
+  features.skipBom_ = options.skipBom;
+  features.hashObjectMembers_ = options.hashObjectMembers;
+  features.borrowStrings_ = options.borrowStrings;
+  features.collectOffsets_ = options.collectOffsets;
+  features.internKeys_ = options.internKeys;
+  features.internValues_ = options.internValues;
+  features.packNumbers_ = options.packNumbers;
+  features.lazy_ = options.lazy;
+  features.streamBlockSize_ = std::max<size_t>(options.streamBlockSize, 1);
+  return features;
+}
+
+static CharReaderOptions optionsFromSettings(const Value& settings) {
+  CharReaderOptions options;
+  options.collectComments = settings["collectComments"].asBool();
+  options.collectOffsets = settings["collectOffsets"].asBool();
+  options.allowComments = settings["allowComments"].asBool();
+  options.allowTrailingCommas = settings["allowTrailingCommas"].asBool();
+  options.strictRoot = settings["strictRoot"].asBool();
+  options.allowDroppedNullPlaceholders =
+      settings["allowDroppedNullPlaceholders"].asBool();
+  options.allowNumericKeys = settings["allowNumericKeys"].asBool();
+  options.allowSingleQuotes = settings["allowSingleQuotes"].asBool();
 
   // Stack limit is always a size_t, so we get this as an unsigned int
   // regardless of it we have 64-bit integer support enabled.
-  features.stackLimit_ = static_cast<size_t>(settings_["stackLimit"].asUInt());
-  features.failIfExtra_ = settings_["failIfExtra"].asBool();
-  features.rejectDupKeys_ = settings_["rejectDupKeys"].asBool();
-  features.allowSpecialFloats_ = settings_["allowSpecialFloats"].asBool();
-  features.skipBom_ = settings_["skipBom"].asBool();
-  return new OurCharReader(collectComments, features);
+  options.stackLimit = settings["stackLimit"].asUInt();
+  options.failIfExtra = settings["failIfExtra"].asBool();
+  options.rejectDupKeys = settings["rejectDupKeys"].asBool();
+  options.allowSpecialFloats = settings["allowSpecialFloats"].asBool();
+  options.skipBom = settings["skipBom"].asBool();
+  options.hashObjectMembers = settings["hashObjectMembers"].asBool();
+  options.borrowStrings = settings["borrowStrings"].asBool();
+  options.internKeys = settings["internKeys"].asBool();
+  options.internValues = settings["internValues"].asBool();
+  options.packNumbers = settings["packNumbers"].asBool();
+  options.lazy = settings["lazy"].asBool();
+  options.streamBlockSize = settings["streamBlockSize"].asUInt();
+  return options;
+}
+
+CharReader* newCharReader(CharReaderOptions const& options) {
+  return new OurCharReader(options.collectComments,
+                           featuresFromOptions(options));
+}
+
+CharReader* CharReaderBuilder::newCharReader() const {
+  return Json::newCharReader(optionsFromSettings(settings_));
 }
 
 bool CharReaderBuilder::validate(Json::Value* invalid) const {
   static const auto& valid_keys = *new std::set<String>{
       "collectComments",
+      "collectOffsets",
       "allowComments",
       "allowTrailingCommas",
       "strictRoot",
@@ -1915,6 +2775,13 @@ bool CharReaderBuilder::validate(Json::Value* invalid) const {
       "rejectDupKeys",
       "allowSpecialFloats",
       "skipBom",
+      "hashObjectMembers",
+      "borrowStrings",
+      "internKeys",
+      "internValues",
+      "packNumbers",
+      "lazy",
+      "streamBlockSize",
   };
   for (auto si = settings_.begin(); si != settings_.end(); ++si) {
     auto key = si.name();
@@ -1951,6 +2818,7 @@ void CharReaderBuilder::strictMode(Json::Value* settings) {
 void CharReaderBuilder::setDefaults(Json::Value* settings) {
   //! [CharReaderBuilderDefaults]
   (*settings)["collectComments"] = true;
+  (*settings)["collectOffsets"] = false;
   (*settings)["allowComments"] = true;
   (*settings)["allowTrailingCommas"] = true;
   (*settings)["strictRoot"] = false;
@@ -1962,6 +2830,13 @@ void CharReaderBuilder::setDefaults(Json::Value* settings) {
   (*settings)["rejectDupKeys"] = false;
   (*settings)["allowSpecialFloats"] = false;
   (*settings)["skipBom"] = true;
+  (*settings)["hashObjectMembers"] = false;
+  (*settings)["borrowStrings"] = false;
+  (*settings)["internKeys"] = false;
+  (*settings)["internValues"] = false;
+  (*settings)["packNumbers"] = false;
+  (*settings)["lazy"] = false;
+  (*settings)["streamBlockSize"] = 65536;
   //! [CharReaderBuilderDefaults]
 }
 
@@ -1970,14 +2845,242 @@ void CharReaderBuilder::setDefaults(Json::Value* settings) {
 
 bool parseFromStream(CharReader::Factory const& fact, IStream& sin, Value* root,
                      String* errs) {
-  OStringStream ssin;
-  ssin << sin.rdbuf();
-  String doc = ssin.str();
-  char const* begin = doc.data();
-  char const* end = begin + doc.size();
-  // Note that we do not actually need a null-terminator.
   CharReaderPtr const reader(fact.newCharReader());
-  return reader->parse(begin, end, root, errs);
+  return reader->parseStream(sin, root, errs);
+}
+
+CharReader& threadLocalCharReader(CharReaderBuilder const& builder) {
+  struct Cache {
+    Value settings;
+    CharReaderPtr reader;
+  };
+  static thread_local Cache cache;
+  if (!cache.reader || cache.settings != builder.settings_) {
+    cache.reader.reset(builder.newCharReader());
+    cache.settings = builder.settings_;
+  }
+  return *cache.reader;
+}
+
+MappedFile::~MappedFile() { close(); }
+
+bool MappedFile::open(const String& path, String* errs) {
+  close();
+#if defined(JSONCPP_HAS_MMAP)
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    if (errs)
+      *errs = "Cannot open '" + path + "': " + std::strerror(errno) + "\n";
+    return false;
+  }
+  struct stat status;
+  if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode) &&
+      status.st_size > 0) {
+    const auto size = static_cast<size_t>(status.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      ::close(fd);
+      // The parser reads the document front to back.
+      madvise(data, size, MADV_SEQUENTIAL);
+      begin_ = static_cast<char const*>(data);
+      size_ = size;
+      mapped_ = true;
+      return true;
+    }
+  }
+  // Pipes, FIFOs and devices are read from the descriptor already open: a
+  // FIFO opened again would wait for another writer.
+  char block[65536];
+  ssize_t count;
+  while ((count = ::read(fd, block, sizeof(block))) != 0) {
+    if (count < 0 && errno == EINTR)
+      continue;
+    if (count < 0) {
+      if (errs)
+        *errs = "Cannot read '" + path + "': " + std::strerror(errno) + "\n";
+      ::close(fd);
+      buffer_.clear();
+      return false;
+    }
+    buffer_.append(block, static_cast<size_t>(count));
+  }
+  ::close(fd);
+#else
+  std::ifstream in(path.c_str(), std::ios::binary);
+  if (!in) {
+    if (errs)
+      *errs = "Cannot open '" + path + "'.\n";
+    return false;
+  }
+  char block[65536];
+  while (in.read(block, sizeof(block)) || in.gcount() > 0)
+    buffer_.append(block, static_cast<size_t>(in.gcount()));
+  if (in.bad()) {
+    if (errs)
+      *errs = "Cannot read '" + path + "'.\n";
+    buffer_.clear();
+    return false;
+  }
+#endif
+  begin_ = buffer_.data();
+  size_ = buffer_.size();
+  return true;
+}
+
+void MappedFile::close() {
+#if defined(JSONCPP_HAS_MMAP)
+  if (mapped_)
+    munmap(const_cast<char*>(begin_), size_);
+#endif
+  String().swap(buffer_);
+  begin_ = nullptr;
+  size_ = 0;
+  mapped_ = false;
+}
+
+bool parseFromFile(CharReader::Factory const& fact, const String& path,
+                   Value* root, String* errs) {
+  CharReaderPtr const reader(fact.newCharReader());
+  // The file is closed before returning, so no value may refer to it.
+  if (reader->refersToDocument()) {
+    if (errs)
+      *errs = "Cannot read '" + path +
+              "' for values that refer to it; pass a MappedFile.\n";
+    return false;
+  }
+  MappedFile file;
+  if (!file.open(path, errs))
+    return false;
+  return reader->parse(file.begin(), file.end(), root, errs);
+}
+
+bool parseFromFile(CharReader::Factory const& fact, const String& path,
+                   MappedFile* file, Value* root, String* errs) {
+  if (!file->open(path, errs))
+    return false;
+  CharReaderPtr const reader(fact.newCharReader());
+  return reader->parse(file->begin(), file->end(), root, errs);
+}
+
+NdjsonReader::NdjsonReader(CharReaderBuilder const& builder, unsigned threads)
+    : settings_(builder.settings_),
+      threads_(threads ? threads
+                       : std::max(1U, std::thread::hardware_concurrency())) {}
+
+namespace {
+struct NdjsonLine {
+  char const* begin;
+  char const* end;
+  size_t line;
+};
+} // namespace
+
+// Splits [begin, end) into its non-blank lines.
+static std::vector<NdjsonLine> splitNdjsonLines(char const* begin,
+                                                char const* end) {
+  std::vector<NdjsonLine> lines;
+  size_t line = 0;
+  while (begin != end) {
+    ++line;
+    auto newline = static_cast<char const*>(
+        std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+    char const* lineEnd = newline ? newline : end;
+    char const* contentEnd = lineEnd;
+    if (contentEnd != begin && contentEnd[-1] == '\r')
+      --contentEnd;
+    if (std::any_of(begin, contentEnd, [](char c) {
+          return c != ' ' && c != '\t' && c != '\r';
+        }))
+      lines.push_back({begin, contentEnd, line});
+    begin = newline ? newline + 1 : end;
+  }
+  return lines;
+}
+
+// Reads lines on up to threads threads and passes every record to
+// deliver(index, record), where index is the position in lines. Returns
+// whether every record was read successfully.
+template <typename Deliver>
+static bool readNdjsonLines(const std::vector<NdjsonLine>& lines,
+                            const Value& settings, unsigned threads,
+                            Deliver deliver) {
+  // Lines are handed out in batches to keep the workers apart.
+  static const size_t batch = 64;
+  const CharReaderOptions options = optionsFromSettings(settings);
+  const OurFeatures features = featuresFromOptions(options);
+  const bool collectComments = options.collectComments;
+  std::atomic<size_t> next(0);
+  std::atomic<bool> allOk(true);
+  std::mutex failureMutex;
+  std::exception_ptr failure;
+
+  auto work = [&]() {
+    OurReader reader(features);
+    try {
+      for (;;) {
+        const size_t first = next.fetch_add(batch);
+        if (first >= lines.size())
+          return;
+        const size_t last = std::min(first + batch, lines.size());
+        for (size_t i = first; i < last; ++i) {
+          NdjsonReader::Record record;
+          record.line = lines[i].line;
+          try {
+            if (!reader.parse(lines[i].begin, lines[i].end, record.value,
+                              collectComments)) {
+              for (const auto& error : reader.getStructuredErrors())
+                record.errors.push_back(
+                    {error.offset_start, error.offset_limit, error.message});
+            }
+          } catch (const std::exception& e) {
+            record.errors.push_back(
+                {0, lines[i].end - lines[i].begin, e.what()});
+          }
+          if (!record.errors.empty())
+            allOk = false;
+          deliver(i, record);
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(failureMutex);
+      if (!failure)
+        failure = std::current_exception();
+      next = lines.size();
+    }
+  };
+
+  const size_t batches = (lines.size() + batch - 1) / batch;
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < std::min<size_t>(threads, batches); ++i)
+    workers.emplace_back(work);
+  work();
+  for (auto& worker : workers)
+    worker.join();
+  if (failure)
+    std::rethrow_exception(failure);
+  return allOk;
+}
+
+bool NdjsonReader::parse(char const* beginDoc, char const* endDoc,
+                         std::vector<Record>* records) const {
+  const std::vector<NdjsonLine> lines = splitNdjsonLines(beginDoc, endDoc);
+  records->clear();
+  records->resize(lines.size());
+  return readNdjsonLines(lines, settings_, threads_,
+                         [records](size_t index, Record& record) {
+                           (*records)[index] = std::move(record);
+                         });
+}
+
+bool NdjsonReader::parse(char const* beginDoc, char const* endDoc,
+                         Callback const& callback) const {
+  const std::vector<NdjsonLine> lines = splitNdjsonLines(beginDoc, endDoc);
+  std::mutex callbackMutex;
+  return readNdjsonLines(lines, settings_, threads_,
+                         [&](size_t /*index*/, Record& record) {
+                           std::lock_guard<std::mutex> lock(callbackMutex);
+                           callback(record);
+                         });
 }
 
 IStream& operator>>(IStream& sin, Value& root) {
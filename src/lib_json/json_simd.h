@@ -0,0 +1,283 @@
+// Copyright 2007-2010 Baptiste Lepilleur and The JsonCpp Authors
+// Distributed under MIT license, or public domain if desired and
+// recognized in your jurisdiction.
+// See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
+
+#ifndef LIB_JSONCPP_JSON_SIMD_H_INCLUDED
+#define LIB_JSONCPP_JSON_SIMD_H_INCLUDED
+
+#if !defined(JSON_IS_AMALGAMATION)
+#include <json/config.h>
+#endif
+
+/* This header provides scanners which classify 16 or 32 bytes of text at a
+ * time where the target supports it: SSE2, which every x86-64 CPU has, and
+ * AVX2, used when the running CPU supports it, with GCC and Clang. Elsewhere,
+ * or if JSONCPP_NO_SIMD is defined, they fall back to a byte at a time.
+ *
+ * Vector loads never read past the end of the range they are given.
+ *
+ * It is an internal header that must not be exposed.
+ */
+
+#if !defined(JSONCPP_NO_SIMD) &&                                               \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define JSONCPP_SIMD_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define JSONCPP_SIMD_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace Json {
+
+static inline bool isJsonSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+#if defined(JSONCPP_SIMD_SSE2)
+// Index of the lowest set bit of a non-zero mask.
+static inline unsigned lowestBit(unsigned mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// Bit i is set if p[i] is JSON whitespace.
+static inline unsigned spaceMask16(const char* p) {
+  const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  const __m128i spaces = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+                   _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+      _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')),
+                   _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'))));
+  return static_cast<unsigned>(_mm_movemask_epi8(spaces));
+}
+#endif // JSONCPP_SIMD_SSE2
+
+#if defined(JSONCPP_SIMD_AVX2)
+static inline bool cpuHasAvx2() {
+  static const bool hasAvx2 = __builtin_cpu_supports("avx2") != 0;
+  return hasAvx2;
+}
+
+__attribute__((target("avx2"))) static inline const char*
+skipSpacesAvx2(const char* p, const char* end) {
+  for (; end - p >= 32; p += 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i spaces = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')),
+                        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')),
+                        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'))));
+    const auto other = ~static_cast<unsigned>(_mm256_movemask_epi8(spaces));
+    if (other)
+      return p + lowestBit(other);
+  }
+  return p;
+}
+
+__attribute__((target("avx2"))) static inline const char*
+findQuoteOrEscapeAvx2(const char* p, const char* end, char quote) {
+  const __m256i quotes = _mm256_set1_epi8(quote);
+  const __m256i escapes = _mm256_set1_epi8('\\');
+  for (; end - p >= 32; p += 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const auto found = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quotes),
+                        _mm256_cmpeq_epi8(chunk, escapes))));
+    if (found)
+      return p + lowestBit(found);
+  }
+  return p;
+}
+
+__attribute__((target("avx2"))) static inline const char*
+findCharToEscapeAvx2(const char* p, const char* end, bool escapeNonAscii) {
+  const __m256i quotes = _mm256_set1_epi8('"');
+  const __m256i escapes = _mm256_set1_epi8('\\');
+  const __m256i lastControl = _mm256_set1_epi8(0x1F);
+  for (; end - p >= 32; p += 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    // Signed, bytes from 0x80 are negative, so below the first printable.
+    const __m256i special =
+        escapeNonAscii
+            ? _mm256_cmpgt_epi8(_mm256_set1_epi8(0x20), chunk)
+            : _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, lastControl),
+                                lastControl);
+    const auto found = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_or_si256(special,
+                        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quotes),
+                                        _mm256_cmpeq_epi8(chunk, escapes)))));
+    if (found)
+      return p + lowestBit(found);
+  }
+  return p;
+}
+
+__attribute__((target("avx2"))) static inline const char*
+findStructuralCharAvx2(const char* p, const char* end) {
+  const __m256i lowerCase = _mm256_set1_epi8(0x20);
+  for (; end - p >= 32; p += 32) {
+    const __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i folded = _mm256_or_si256(chunk, lowerCase);
+    const __m256i brackets =
+        _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                        _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}')));
+    const __m256i others = _mm256_or_si256(
+        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')),
+        _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\'')),
+                        _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('/'))));
+    const auto found = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_or_si256(brackets, others)));
+    if (found)
+      return p + lowestBit(found);
+  }
+  return p;
+}
+#endif // JSONCPP_SIMD_AVX2
+
+static inline bool isStructuralChar(char c) {
+  return c == '"' || c == '\'' || c == '/' || c == '[' || c == ']' ||
+         c == '{' || c == '}';
+}
+
+/** Return the first char of [p, end) which is not JSON whitespace, or end.
+ *
+ * That is where the next token starts, so in a document without comments it
+ * is the next structural char, or the first char of a scalar.
+ */
+static inline const char* skipJsonSpaces(const char* p, const char* end) {
+  // Compact documents have no whitespace, or one space after ':' or ','.
+  for (int i = 0; i < 2; ++i, ++p)
+    if (p == end || !isJsonSpace(*p))
+      return p;
+#if defined(JSONCPP_SIMD_AVX2)
+  if (cpuHasAvx2())
+    p = skipSpacesAvx2(p, end);
+#endif
+#if defined(JSONCPP_SIMD_SSE2)
+  for (; end - p >= 16; p += 16) {
+    const unsigned other = ~spaceMask16(p) & 0xFFFFU;
+    if (other)
+      return p + lowestBit(other);
+  }
+#endif
+  while (p != end && isJsonSpace(*p))
+    ++p;
+  return p;
+}
+
+/** Return the first char of [p, end) which is quote or a backslash, or end.
+ *
+ * Everything before it can be copied as is out of a string quoted by quote.
+ */
+static inline const char* findQuoteOrEscape(const char* p, const char* end,
+                                            char quote) {
+#if defined(JSONCPP_SIMD_AVX2)
+  if (end - p >= 32 && cpuHasAvx2())
+    p = findQuoteOrEscapeAvx2(p, end, quote);
+#endif
+#if defined(JSONCPP_SIMD_SSE2)
+  const __m128i quotes = _mm_set1_epi8(quote);
+  const __m128i escapes = _mm_set1_epi8('\\');
+  for (; end - p >= 16; p += 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const auto found = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quotes),
+                                       _mm_cmpeq_epi8(chunk, escapes))));
+    if (found)
+      return p + lowestBit(found);
+  }
+#endif
+  while (p != end && *p != quote && *p != '\\')
+    ++p;
+  return p;
+}
+
+/** Return the first char of [p, end) which cannot be written as is between
+ * double quotes, or end: a quote, a backslash, a control char, or if
+ * escapeNonAscii, the first byte of a UTF-8 sequence.
+ */
+static inline const char* findCharToEscape(const char* p, const char* end,
+                                           bool escapeNonAscii) {
+#if defined(JSONCPP_SIMD_AVX2)
+  if (end - p >= 32 && cpuHasAvx2())
+    p = findCharToEscapeAvx2(p, end, escapeNonAscii);
+#endif
+#if defined(JSONCPP_SIMD_SSE2)
+  const __m128i quotes = _mm_set1_epi8('"');
+  const __m128i escapes = _mm_set1_epi8('\\');
+  const __m128i lastControl = _mm_set1_epi8(0x1F);
+  for (; end - p >= 16; p += 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    // Signed, bytes from 0x80 are negative, so below the first printable.
+    const __m128i special =
+        escapeNonAscii
+            ? _mm_cmplt_epi8(chunk, _mm_set1_epi8(0x20))
+            : _mm_cmpeq_epi8(_mm_max_epu8(chunk, lastControl), lastControl);
+    const auto found = static_cast<unsigned>(_mm_movemask_epi8(
+        _mm_or_si128(special, _mm_or_si128(_mm_cmpeq_epi8(chunk, quotes),
+                                           _mm_cmpeq_epi8(chunk, escapes)))));
+    if (found)
+      return p + lowestBit(found);
+  }
+#endif
+  for (; p != end; ++p) {
+    const auto c = static_cast<unsigned char>(*p);
+    if (c == '"' || c == '\\' || c < 0x20 || (escapeNonAscii && c > 0x7F))
+      break;
+  }
+  return p;
+}
+
+/** Return the first char of [p, end) which may open or close an array, an
+ * object, a string or a comment, or end: one of "'/[]{}.
+ *
+ * Skipping a value only has to look at these.
+ */
+static inline const char* findStructuralChar(const char* p, const char* end) {
+#if defined(JSONCPP_SIMD_AVX2)
+  if (end - p >= 32 && cpuHasAvx2())
+    p = findStructuralCharAvx2(p, end);
+#endif
+#if defined(JSONCPP_SIMD_SSE2)
+  // '[' and ']' differ from '{' and '}' by the bit of lower case letters.
+  const __m128i lowerCase = _mm_set1_epi8(0x20);
+  for (; end - p >= 16; p += 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i folded = _mm_or_si128(chunk, lowerCase);
+    const __m128i brackets =
+        _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                     _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')));
+    const __m128i others = _mm_or_si128(
+        _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\'')),
+                     _mm_cmpeq_epi8(chunk, _mm_set1_epi8('/'))));
+    const auto found = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_or_si128(brackets, others)));
+    if (found)
+      return p + lowestBit(found);
+  }
+#endif
+  while (p != end && !isStructuralChar(*p))
+    ++p;
+  return p;
+}
+
+} // namespace Json
+
+#endif // LIB_JSONCPP_JSON_SIMD_H_INCLUDED
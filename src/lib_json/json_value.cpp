@@ -7,14 +7,17 @@
 #include <json/assertions.h>
 #include <json/value.h>
 #include <json/writer.h>
+#include "json_lazy.h"
 #endif // if !defined(JSON_IS_AMALGAMATION)
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
 #include <cstring>
 #include <iostream>
 #include <sstream>
+#include <unordered_set>
 #include <utility>
 
 // Provide implementation equivalent of std::snprintf for older _MSC compilers
@@ -183,6 +186,110 @@ static inline void releasePrefixedStringValue(char* value) { free(value); }
 static inline void releaseStringValue(char* value, unsigned) { free(value); }
 #endif // JSONCPP_USING_SECURE_MEMORY
 
+/* A name shared through a NamePool: its reference count, then its null
+ * terminated chars, which is what CZString points to.
+ */
+using SharedNameRefs = std::atomic<unsigned>;
+static char* newSharedName(const char* value, unsigned length) {
+  auto block =
+      static_cast<char*>(malloc(sizeof(SharedNameRefs) + length + 1U));
+  if (block == nullptr) {
+    throwRuntimeError("in Json::NamePool::intern(): "
+                      "Failed to allocate name buffer");
+  }
+  new (block) SharedNameRefs(1);
+  char* name = block + sizeof(SharedNameRefs);
+  memcpy(name, value, length);
+  name[length] = 0;
+  return name;
+}
+static inline SharedNameRefs& sharedNameRefs(const char* name) {
+  return *reinterpret_cast<SharedNameRefs*>(const_cast<char*>(name) -
+                                            sizeof(SharedNameRefs));
+}
+static inline void retainSharedName(const char* name) {
+  sharedNameRefs(name).fetch_add(1, std::memory_order_relaxed);
+}
+static inline void releaseSharedName(const char* name, unsigned length) {
+  SharedNameRefs& refs = sharedNameRefs(name);
+  if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    return;
+  refs.~SharedNameRefs();
+  releaseStringValue(reinterpret_cast<char*>(&refs),
+                     unsigned(sizeof(SharedNameRefs)) + length + 1U);
+}
+
+/* A string payload shared by Value::share(): its reference count, then the
+ * prefixed string that string_ points to.
+ */
+static char* newSharedString(const char* value, unsigned length) {
+  JSON_ASSERT_MESSAGE(length <= static_cast<unsigned>(Value::maxInt) -
+                                    sizeof(SharedNameRefs) - sizeof(unsigned) -
+                                    1U,
+                      "in Json::Value::share(): string too big to share");
+  auto block = static_cast<char*>(malloc(sizeof(SharedNameRefs) +
+                                         sizeof(unsigned) + length + 1U));
+  if (block == nullptr) {
+    throwRuntimeError("in Json::Value::share(): "
+                      "Failed to allocate string value buffer");
+  }
+  new (block) SharedNameRefs(1);
+  char* prefixed = block + sizeof(SharedNameRefs);
+  *reinterpret_cast<unsigned*>(prefixed) = length;
+  memcpy(prefixed + sizeof(unsigned), value, length);
+  prefixed[sizeof(unsigned) + length] = 0;
+  return prefixed;
+}
+static inline void releaseSharedString(char* prefixed) {
+  SharedNameRefs& refs = sharedNameRefs(prefixed);
+  if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+    return;
+  unsigned const length = *reinterpret_cast<unsigned const*>(prefixed);
+  refs.~SharedNameRefs();
+  releaseStringValue(reinterpret_cast<char*>(&refs),
+                     unsigned(sizeof(SharedNameRefs) + sizeof(unsigned)) +
+                         length + 1U);
+}
+
+/* The finalizer of MurmurHash3, which spreads every bit of k over the
+ * result.
+ */
+static inline uint64_t mixHash(uint64_t k) {
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+static inline uint64_t combineHash(uint64_t hash, uint64_t value) {
+  return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+/* Hash length bytes eight at a time.
+ */
+static uint64_t hashBytes(char const* bytes, size_t length, uint64_t seed) {
+  uint64_t hash = combineHash(seed, length);
+  for (; length >= 8; bytes += 8, length -= 8) {
+    uint64_t word;
+    memcpy(&word, bytes, 8);
+    hash = combineHash(hash, mixHash(word));
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, bytes, length);
+  return mixHash(combineHash(hash, tail));
+}
+
+/* 64-bit FNV-1a.
+ */
+static size_t hashName(char const* key, unsigned length) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned i = 0; i < length; ++i) {
+    hash ^= static_cast<unsigned char>(key[i]);
+    hash *= 1099511628211ULL;
+  }
+  return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
 } // namespace Json
 
 // //////////////////////////////////////////////////////////////////
@@ -222,6 +329,53 @@ JSONCPP_NORETURN void throwLogicError(String const& msg) {
 }
 #endif
 
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class Arena
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+Arena::Arena(size_t blockSize) : blockSize_(blockSize) {}
+
+Arena::~Arena() { release(); }
+
+void Arena::release() {
+  while (blocks_) {
+    Block* next = blocks_->next;
+    ::operator delete(blocks_);
+    blocks_ = next;
+  }
+  capacity_ = 0;
+  cursor_ = nullptr;
+  limit_ = nullptr;
+}
+
+void* Arena::allocateBlock(size_t size, size_t alignment) {
+  size_t const needed = sizeof(Block) + alignment - 1 + size;
+  JSON_ASSERT_MESSAGE(needed > size, "in Json::Arena::allocate(): too big");
+  // Requests too large to leave much of a shared block get a block of their
+  // own, and the current block stays in use.
+  bool const dedicated = size > blockSize_ / 4;
+  size_t const length = dedicated ? needed : std::max(needed, blockSize_);
+  auto block = static_cast<Block*>(::operator new(length));
+  capacity_ += length;
+  char* begin = reinterpret_cast<char*>(block + 1);
+  char* p =
+      begin + ((0 - reinterpret_cast<uintptr_t>(begin)) & (alignment - 1));
+  if (dedicated && blocks_) {
+    block->next = blocks_->next;
+    blocks_->next = block;
+    return p;
+  }
+  block->next = blocks_;
+  blocks_ = block;
+  cursor_ = p + size;
+  limit_ = reinterpret_cast<char*>(block) + length;
+  return p;
+}
+
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
@@ -231,41 +385,62 @@ JSONCPP_NORETURN void throwLogicError(String const& msg) {
 // //////////////////////////////////////////////////////////////////
 
 // Notes: policy_ indicates if the string was allocated when
-// a string is stored.
+// a string is stored. Duplicates shorter than chars_ are kept inline_, with
+// the duplicate policy. Names from a NamePool are shared_, and copies take a
+// reference instead of duplicating them.
 
-Value::CZString::CZString(ArrayIndex index) : cstr_(nullptr), index_(index) {}
+Value::CZString::CZString(ArrayIndex index)
+    : cstr_(nullptr), index_(index), inline_(false), shared_(false) {}
 
 Value::CZString::CZString(char const* str, unsigned length,
                           DuplicationPolicy allocate)
-    : cstr_(str) {
+    : cstr_(str), inline_(false), shared_(false) {
   // allocate != duplicate
   storage_.policy_ = allocate & 0x3;
   storage_.length_ = length & 0x3FFFFFFF;
 }
 
 Value::CZString::CZString(const CZString& other) {
-  cstr_ = (other.storage_.policy_ != noDuplication && other.cstr_ != nullptr
-               ? duplicateStringValue(other.cstr_, other.storage_.length_)
-               : other.cstr_);
-  storage_.policy_ =
-      static_cast<unsigned>(
-          other.cstr_
-              ? (static_cast<DuplicationPolicy>(other.storage_.policy_) ==
-                         noDuplication
-                     ? noDuplication
-                     : duplicate)
-              : static_cast<DuplicationPolicy>(other.storage_.policy_)) &
-      3U;
-  storage_.length_ = other.storage_.length_;
+  index_ = other.index_;
+  inline_ = other.inline_;
+  shared_ = other.shared_;
+  if (other.shared_) {
+    copyFrom(other);
+    retainSharedName(cstr_);
+    return;
+  }
+  if (other.isIndex() || other.inline_ ||
+      other.storage_.policy_ == noDuplication) {
+    copyFrom(other);
+    return;
+  }
+  storage_.policy_ = duplicate;
+  if (other.storage_.length_ < sizeof(chars_)) {
+    memset(chars_, 0, sizeof(chars_));
+    memcpy(chars_, other.cstr_, other.storage_.length_);
+    inline_ = true;
+  } else {
+    cstr_ = duplicateStringValue(other.cstr_, other.storage_.length_);
+  }
 }
 
 Value::CZString::CZString(CZString&& other) noexcept
-    : cstr_(other.cstr_), index_(other.index_) {
-  other.cstr_ = nullptr;
+    : index_(other.index_), inline_(other.inline_), shared_(other.shared_) {
+  copyFrom(other);
+  if (!other.inline_)
+    other.cstr_ = nullptr;
+}
+
+// Copy the pointer, or the characters if inline_, as is.
+void Value::CZString::copyFrom(const CZString& other) {
+  memcpy(chars_, other.chars_, sizeof(chars_));
 }
 
 Value::CZString::~CZString() {
-  if (cstr_ && storage_.policy_ == duplicate) {
+  if (shared_) {
+    if (cstr_)
+      releaseSharedName(cstr_, storage_.length_);
+  } else if (!inline_ && cstr_ && storage_.policy_ == duplicate) {
     releaseStringValue(const_cast<char*>(cstr_),
                        storage_.length_ + 1U); // +1 for null terminating
                                                // character for sake of
@@ -275,33 +450,48 @@ Value::CZString::~CZString() {
 }
 
 void Value::CZString::swap(CZString& other) {
-  std::swap(cstr_, other.cstr_);
+  std::swap(chars_, other.chars_);
   std::swap(index_, other.index_);
+  std::swap(inline_, other.inline_);
+  std::swap(shared_, other.shared_);
 }
 
 Value::CZString& Value::CZString::operator=(const CZString& other) {
-  cstr_ = other.cstr_;
+  if (other.shared_)
+    retainSharedName(other.cstr_);
+  if (shared_ && cstr_)
+    releaseSharedName(cstr_, storage_.length_);
+  copyFrom(other);
   index_ = other.index_;
+  inline_ = other.inline_;
+  shared_ = other.shared_;
   return *this;
 }
 
 Value::CZString& Value::CZString::operator=(CZString&& other) noexcept {
-  cstr_ = other.cstr_;
+  if (shared_ && cstr_ && this != &other)
+    releaseSharedName(cstr_, storage_.length_);
+  copyFrom(other);
   index_ = other.index_;
-  other.cstr_ = nullptr;
+  inline_ = other.inline_;
+  shared_ = other.shared_;
+  if (!other.inline_ && this != &other)
+    other.cstr_ = nullptr;
   return *this;
 }
 
 bool Value::CZString::operator<(const CZString& other) const {
-  if (!cstr_)
+  if (isIndex())
     return index_ < other.index_;
   // return strcmp(cstr_, other.cstr_) < 0;
   // Assume both are strings.
   unsigned this_len = this->storage_.length_;
   unsigned other_len = other.storage_.length_;
+  JSON_ASSERT(!other.isIndex());
+  if (data() == other.data()) // the same copy, such as a shared name
+    return this_len < other_len;
   unsigned min_len = std::min<unsigned>(this_len, other_len);
-  JSON_ASSERT(this->cstr_ && other.cstr_);
-  int comp = memcmp(this->cstr_, other.cstr_, min_len);
+  int comp = memcmp(data(), other.data(), min_len);
   if (comp < 0)
     return true;
   if (comp > 0)
@@ -310,7 +500,7 @@ bool Value::CZString::operator<(const CZString& other) const {
 }
 
 bool Value::CZString::operator==(const CZString& other) const {
-  if (!cstr_)
+  if (isIndex())
     return index_ == other.index_;
   // return strcmp(cstr_, other.cstr_) == 0;
   // Assume both are strings.
@@ -318,20 +508,689 @@ bool Value::CZString::operator==(const CZString& other) const {
   unsigned other_len = other.storage_.length_;
   if (this_len != other_len)
     return false;
-  JSON_ASSERT(this->cstr_ && other.cstr_);
-  int comp = memcmp(this->cstr_, other.cstr_, this_len);
+  JSON_ASSERT(!other.isIndex());
+  if (data() == other.data())
+    return true;
+  int comp = memcmp(data(), other.data(), this_len);
   return comp == 0;
 }
 
 ArrayIndex Value::CZString::index() const { return index_; }
 
 // const char* Value::CZString::c_str() const { return cstr_; }
-const char* Value::CZString::data() const { return cstr_; }
+const char* Value::CZString::data() const { return inline_ ? chars_ : cstr_; }
 unsigned Value::CZString::length() const { return storage_.length_; }
 bool Value::CZString::isStaticString() const {
   return storage_.policy_ == noDuplication;
 }
 
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class Value::LazyNode
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+/*! \internal The payload of a lazy array or object: where its text is, and
+ * what reads it. Copies of a lazy value share the source, and each reads
+ * the text again if it is accessed.
+ */
+class Value::LazyNode {
+public:
+  char const* begin_;
+  char const* end_;
+  std::shared_ptr<const LazySource> source_;
+};
+
+LazySource::~LazySource() = default;
+
+void LazySource::assign(Value& value, ValueType type, char const* begin,
+                        char const* end) const {
+  Value lazy;
+  lazy.value_.lazy_ = new Value::LazyNode{begin, end, shared_from_this()};
+  lazy.setType(type);
+  lazy.bits_.lazy_ = true;
+  value.swapPayload(lazy);
+}
+
+void Value::materializeLazy() const {
+  // Keep the source alive, as the node goes away with the lazy payload.
+  const LazyNode node = *payload().lazy_;
+  Value container;
+  node.source_->read(node.begin_, node.end_, container);
+  JSON_ASSERT(container.type() == type());
+  const_cast<Value&>(*this).swapPayload(container);
+}
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class Value::PackedNumbers
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+/*! \internal The payload of an array packed by Value::packNumbers(): its
+ * elements, all of type_, in reals_ or ints_.
+ */
+class Value::PackedNumbers {
+public:
+  explicit PackedNumbers(ValueType type) : type_(type) {}
+
+  size_t size() const {
+    return type_ == realValue ? reals_.size() : ints_.size();
+  }
+  Value at(size_t index) const {
+    return type_ == realValue ? Value(reals_[index]) : Value(ints_[index]);
+  }
+  // Insert element before index, unless it does not fit the buffer.
+  bool insert(size_t index, const Value& element) {
+    if (element.type() != type_ || element.bits_.hasMeta_)
+      return false;
+    if (type_ == realValue)
+      reals_.insert(reals_.begin() + index, element.payload().real_);
+    else
+      ints_.insert(ints_.begin() + index, element.payload().int_);
+    return true;
+  }
+  void erase(size_t index) {
+    if (type_ == realValue)
+      reals_.erase(reals_.begin() + index);
+    else
+      ints_.erase(ints_.begin() + index);
+  }
+  bool operator==(const PackedNumbers& other) const {
+    return type_ == other.type_ && reals_ == other.reals_ &&
+           ints_ == other.ints_;
+  }
+
+  ValueType type_;
+  std::vector<double> reals_;
+  std::vector<LargestInt> ints_;
+};
+
+bool Value::packNumbers() {
+  if (type() != arrayValue || bits_.packed_ || bits_.lazy_ || bits_.shared_ ||
+      bits_.arena_ || payload().array_->empty())
+    return false;
+  ArrayValues const& array = *payload().array_;
+  ValueType const elementType = array.front().type();
+  if (elementType != intValue && elementType != realValue)
+    return false;
+  for (const Value& element : array) {
+    if (element.type() != elementType || element.bits_.hasMeta_)
+      return false;
+  }
+  std::unique_ptr<PackedNumbers> numbers(new PackedNumbers(elementType));
+  if (elementType == realValue) {
+    numbers->reals_.reserve(array.size());
+    for (const Value& element : array)
+      numbers->reals_.push_back(element.payload().real_);
+  } else {
+    numbers->ints_.reserve(array.size());
+    for (const Value& element : array)
+      numbers->ints_.push_back(element.payload().int_);
+  }
+  Value packed;
+  packed.value_.packed_ = numbers.release();
+  packed.setType(arrayValue);
+  packed.bits_.packed_ = true;
+  swapPayload(packed);
+  return true;
+}
+
+void Value::unpack() const {
+  PackedNumbers const& numbers = *payload().packed_;
+  Value array(arrayValue);
+  array.payload().array_->reserve(numbers.size());
+  for (size_t index = 0; index < numbers.size(); ++index)
+    array.payload().array_->push_back(numbers.at(index));
+  const_cast<Value&>(*this).swapPayload(array);
+}
+
+bool Value::packedEquals(const Value& other) const {
+  if (!bits_.packed_)
+    return other.packedEquals(*this);
+  PackedNumbers const& numbers = *payload().packed_;
+  if (other.bits_.packed_)
+    return numbers == *other.payload().packed_;
+  ArrayValues const& array = *other.payload().array_;
+  if (array.size() != numbers.size())
+    return false;
+  for (size_t index = 0; index < numbers.size(); ++index) {
+    if (array[index] != numbers.at(index))
+      return false;
+  }
+  return true;
+}
+
+bool Value::getReals(double const** begin, double const** end) const {
+  if (bits_.lazy_)
+    materializeLazy();
+  if (!bits_.packed_ || payload().packed_->type_ != realValue)
+    return false;
+  *begin = payload().packed_->reals_.data();
+  *end = *begin + payload().packed_->reals_.size();
+  return true;
+}
+
+bool Value::getLargestInts(LargestInt const** begin,
+                           LargestInt const** end) const {
+  if (bits_.lazy_)
+    materializeLazy();
+  if (!bits_.packed_ || payload().packed_->type_ != intValue)
+    return false;
+  *begin = payload().packed_->ints_.data();
+  *end = *begin + payload().packed_->ints_.size();
+  return true;
+}
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class Value::HashedObjectValues
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+/*! \internal Members of an object created with hashed member lookup.
+ *
+ * The map still owns the members, so iterators, iteration order and
+ * comparisons are those of any other object. Once the object holds
+ * minIndexedSize members, an open-addressing (linear probing) table of
+ * pointers to the map nodes, each with its cached key hash, answers lookups
+ * without walking the tree. Map nodes never move, so the table only has to
+ * follow insertions and removals.
+ */
+class Value::HashedObjectValues : public ObjectValues {
+public:
+  HashedObjectValues() = default;
+  HashedObjectValues(const HashedObjectValues& other) : ObjectValues(other) {
+    rebuildIndex();
+  }
+  // The map keeps its nodes, so the index still points at them.
+  HashedObjectValues(HashedObjectValues&& other) = default;
+  HashedObjectValues& operator=(const HashedObjectValues& other) = delete;
+
+  Value* find(char const* key, unsigned length);
+  Value& resolve(char const* key, unsigned length,
+                 CZString::DuplicationPolicy policy,
+                 NamePool* pool = nullptr);
+  bool remove(char const* key, unsigned length, Value* removed);
+  void clearMembers();
+
+private:
+  struct Slot {
+    size_t hash;
+    value_type* entry; // null if the slot is free
+  };
+  static constexpr size_t minIndexedSize = 8;
+
+  static size_t hashKey(char const* key, unsigned length);
+  size_t findSlot(char const* key, unsigned length, size_t hash) const;
+  void placeSlot(size_t hash, value_type* entry);
+  void growIndex();
+  void rebuildIndex();
+
+  std::vector<Slot> slots_; // empty, or a power of two at most half full
+};
+
+size_t Value::HashedObjectValues::hashKey(char const* key, unsigned length) {
+  return hashName(key, length);
+}
+
+// Return the index of the slot holding key, or of the free slot ending its
+// probe sequence.
+size_t Value::HashedObjectValues::findSlot(char const* key, unsigned length,
+                                           size_t hash) const {
+  size_t mask = slots_.size() - 1;
+  size_t i = hash & mask;
+  for (; slots_[i].entry; i = (i + 1) & mask) {
+    const Slot& slot = slots_[i];
+    if (slot.hash == hash && slot.entry->first.length() == length &&
+        memcmp(slot.entry->first.data(), key, length) == 0)
+      break;
+  }
+  return i;
+}
+
+void Value::HashedObjectValues::placeSlot(size_t hash, value_type* entry) {
+  size_t mask = slots_.size() - 1;
+  size_t i = hash & mask;
+  while (slots_[i].entry)
+    i = (i + 1) & mask;
+  slots_[i] = Slot{hash, entry};
+}
+
+void Value::HashedObjectValues::growIndex() {
+  std::vector<Slot> old(slots_.size() * 2, Slot{0, nullptr});
+  old.swap(slots_);
+  for (const Slot& slot : old)
+    if (slot.entry)
+      placeSlot(slot.hash, slot.entry);
+}
+
+void Value::HashedObjectValues::rebuildIndex() {
+  slots_.clear();
+  if (size() < minIndexedSize)
+    return;
+  size_t capacity = 16;
+  while (capacity < size() * 4)
+    capacity *= 2;
+  slots_.assign(capacity, Slot{0, nullptr});
+  for (auto& entry : *this)
+    placeSlot(hashKey(entry.first.data(), entry.first.length()), &entry);
+}
+
+Value* Value::HashedObjectValues::find(char const* key, unsigned length) {
+  if (slots_.empty()) {
+    auto it =
+        ObjectValues::find(CZString(key, length, CZString::noDuplication));
+    return it == end() ? nullptr : &it->second;
+  }
+  const Slot& slot = slots_[findSlot(key, length, hashKey(key, length))];
+  return slot.entry ? &slot.entry->second : nullptr;
+}
+
+Value& Value::HashedObjectValues::resolve(char const* key, unsigned length,
+                                          CZString::DuplicationPolicy policy,
+                                          NamePool* pool) {
+  size_t hash = 0;
+  if (!slots_.empty()) {
+    hash = hashKey(key, length);
+    const Slot& slot = slots_[findSlot(key, length, hash)];
+    if (slot.entry)
+      return slot.entry->second;
+  }
+  CZString actualKey(key, length, policy);
+  auto it = lower_bound(actualKey);
+  if (slots_.empty() && it != end() && it->first == actualKey)
+    return it->second;
+
+  value_type& entry = pool
+                          ? *emplace_hint(it, pool->intern(key, length), Value())
+                          : *emplace_hint(it, actualKey, Value());
+  if (slots_.empty()) {
+    rebuildIndex();
+  } else {
+    if (size() * 2 > slots_.size())
+      growIndex();
+    placeSlot(hash, &entry);
+  }
+  return entry.second;
+}
+
+bool Value::HashedObjectValues::remove(char const* key, unsigned length,
+                                       Value* removed) {
+  auto it = ObjectValues::find(CZString(key, length, CZString::noDuplication));
+  if (it == end())
+    return false;
+  if (!slots_.empty()) {
+    // Backward-shift deletion: pull later members of the probe run into the
+    // hole unless that would move them before their home slot.
+    size_t mask = slots_.size() - 1;
+    size_t hole = findSlot(key, length, hashKey(key, length));
+    for (size_t i = (hole + 1) & mask; slots_[i].entry; i = (i + 1) & mask) {
+      size_t home = slots_[i].hash & mask;
+      if (((i - home) & mask) >= ((i - hole) & mask)) {
+        slots_[hole] = slots_[i];
+        hole = i;
+      }
+    }
+    slots_[hole].entry = nullptr;
+  }
+  if (removed)
+    *removed = std::move(it->second);
+  erase(it);
+  return true;
+}
+
+void Value::HashedObjectValues::clearMembers() {
+  clear();
+  slots_.clear();
+}
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class Value::SharedPayload
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+/*! \internal The reference count and cached hash of an array or object
+ * payload shared by Value::share().
+ *
+ * Copies of the Value take a reference rather than copying the members, and
+ * nothing changes the members while the payload is shared: a Value about to
+ * change them first takes them for itself (see unsharePayload()).
+ */
+class Value::SharedPayload {
+public:
+  void retain() { refs_.fetch_add(1, std::memory_order_relaxed); }
+  // Return true if this was the last reference.
+  bool release() { return refs_.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+  bool unique() const { return refs_.load(std::memory_order_acquire) == 1; }
+
+  // Value::hash() with the default seed, or 0 until it is known. The members
+  // never change while shared, so it stays right.
+  size_t knownHash() const { return hash_.load(std::memory_order_relaxed); }
+  void setKnownHash(size_t hash) const {
+    hash_.store(hash, std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<unsigned> refs_{1};
+  mutable std::atomic<size_t> hash_{0};
+};
+
+template <typename Values>
+class Value::Shared : public SharedPayload, public Values {
+public:
+  explicit Shared(Values&& values) : Values(std::move(values)) {}
+
+  // Move the members out if this is their last Value, else copy them.
+  Values* takeMembers() {
+    return unique() ? new Values(std::move(*this)) : new Values(*this);
+  }
+};
+
+Value::SharedPayload* Value::sharedPayload() const {
+  if (!bits_.shared_)
+    return nullptr;
+  switch (type()) {
+  case arrayValue:
+    return static_cast<Shared<ArrayValues>*>(payload().array_);
+  case objectValue:
+    if (bits_.hashed_)
+      return static_cast<Shared<HashedObjectValues>*>(hashedMap());
+    return static_cast<Shared<ObjectValues>*>(payload().map_);
+  default:
+    return nullptr;
+  }
+}
+
+void Value::releaseShared() {
+  if (type() == stringValue) {
+    releaseSharedString(payload().string_);
+    return;
+  }
+  if (!sharedPayload()->release())
+    return;
+  if (type() == arrayValue)
+    delete static_cast<Shared<ArrayValues>*>(payload().array_);
+  else if (bits_.hashed_)
+    delete static_cast<Shared<HashedObjectValues>*>(hashedMap());
+  else
+    delete static_cast<Shared<ObjectValues>*>(payload().map_);
+}
+
+void Value::share() {
+  if (bits_.shared_ || bits_.arena_)
+    return;
+  // Copies only read a shared payload, so nothing must be left for const
+  // access to change.
+  materialize();
+  switch (type()) {
+  case stringValue:
+    if (isAllocated()) {
+      unsigned len;
+      char const* str;
+      decodeStringPayload(&len, &str);
+      char* shared = newSharedString(str, len);
+      releasePrefixedStringValue(payload().string_);
+      payload().string_ = shared;
+      bits_.shared_ = true;
+    }
+    break;
+  case arrayValue: {
+    for (Value& element : *payload().array_)
+      element.share();
+    std::unique_ptr<ArrayValues> array(payload().array_);
+    payload().array_ = new Shared<ArrayValues>(std::move(*array));
+    bits_.shared_ = true;
+    break;
+  }
+  case objectValue:
+    for (auto& member : *payload().map_)
+      member.second.share();
+    if (hasHashedMembers()) {
+      std::unique_ptr<HashedObjectValues> map(hashedMap());
+      payload().map_ = new Shared<HashedObjectValues>(std::move(*map));
+    } else {
+      std::unique_ptr<ObjectValues> map(payload().map_);
+      payload().map_ = new Shared<ObjectValues>(std::move(*map));
+    }
+    bits_.shared_ = true;
+    break;
+  default:
+    break;
+  }
+}
+
+void Value::share(ValuePool& pool) {
+  if (bits_.shared_ || bits_.arena_)
+    return;
+  materialize();
+  switch (type()) {
+  case arrayValue:
+    for (Value& element : *payload().array_)
+      element.share(pool);
+    break;
+  case objectValue:
+    for (auto& member : *payload().map_)
+      member.second.share(pool);
+    break;
+  default:
+    break;
+  }
+  pool.intern(*this);
+}
+
+void Value::unsharePayload() {
+  Value own;
+  switch (type()) {
+  case arrayValue:
+    own.payload().array_ =
+        static_cast<Shared<ArrayValues>*>(payload().array_)->takeMembers();
+    break;
+  case objectValue:
+    if (bits_.hashed_)
+      own.payload().map_ =
+          static_cast<Shared<HashedObjectValues>*>(hashedMap())->takeMembers();
+    else
+      own.payload().map_ =
+          static_cast<Shared<ObjectValues>*>(payload().map_)->takeMembers();
+    own.bits_.hashed_ = bits_.hashed_;
+    break;
+  default:
+    // Strings never change in place.
+    return;
+  }
+  own.setType(type());
+  swapPayload(own);
+}
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class NamePool
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+/*! \internal The pool's shared names, each holding one reference.
+ */
+struct NamePool::Names {
+  struct Name {
+    char const* chars;
+    unsigned length;
+  };
+  struct Hash {
+    size_t operator()(const Name& name) const {
+      return hashName(name.chars, name.length);
+    }
+  };
+  struct Equal {
+    bool operator()(const Name& a, const Name& b) const {
+      return a.length == b.length && memcmp(a.chars, b.chars, a.length) == 0;
+    }
+  };
+  std::unordered_set<Name, Hash, Equal> set_;
+};
+
+NamePool::NamePool(size_t maxSize) : names_(new Names), maxSize_(maxSize) {}
+
+NamePool::~NamePool() { clear(); }
+
+size_t NamePool::size() const { return names_->set_.size(); }
+
+void NamePool::clear() {
+  for (const Names::Name& name : names_->set_)
+    releaseSharedName(name.chars, name.length);
+  names_->set_.clear();
+}
+
+// Return an owning name for [key, key + length): a new reference to the
+// pool's copy, or else a duplicate.
+Value::CZString NamePool::intern(char const* key, unsigned length) {
+  typedef Value::CZString CZString;
+  if (length >= sizeof(char const*)) {
+    auto& set = names_->set_;
+    auto it = set.find(Names::Name{key, length});
+    if (it == set.end() && set.size() < maxSize_)
+      it = set.insert(Names::Name{newSharedName(key, length), length}).first;
+    if (it != set.end()) {
+      CZString name(it->chars, length, CZString::duplicate);
+      name.shared_ = true;
+      retainSharedName(it->chars);
+      return name;
+    }
+  }
+  CZString borrowed(key, length, CZString::duplicateOnCopy);
+  return CZString(borrowed);
+}
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class ValuePool
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+/*! \internal The pool's values, each holding a reference to its payload.
+ */
+struct ValuePool::Values {
+  // operator==(), but -0.0 and 0.0 differ, so that no value takes a payload
+  // which is written differently.
+  struct Same {
+    bool operator()(const Value& a, const Value& b) const {
+      return a == b && sameSigns(a, b);
+    }
+  };
+  // Whether the reals of a and b, which compare equal, have the same signs.
+  static bool sameSigns(const Value& a, const Value& b) {
+    switch (a.type()) {
+    case realValue:
+      return std::signbit(a.asDouble()) == std::signbit(b.asDouble());
+    case arrayValue:
+      if (a.sharedPayload() && a.sharedPayload() == b.sharedPayload())
+        return true;
+      for (ArrayIndex index = 0; index < a.size(); ++index) {
+        if (!sameSigns(a[index], b[index]))
+          return false;
+      }
+      return true;
+    case objectValue:
+      if (a.sharedPayload() && a.sharedPayload() == b.sharedPayload())
+        return true;
+      for (auto it = a.begin(); it != a.end(); ++it) {
+        char const* end;
+        char const* name = it.memberName(&end);
+        if (!sameSigns(*it, *b.find(name, end)))
+          return false;
+      }
+      return true;
+    default:
+      return true;
+    }
+  }
+  std::unordered_set<Value, std::hash<Value>, Same> set_;
+};
+
+ValuePool::ValuePool(size_t maxSize)
+    : values_(new Values), maxSize_(maxSize) {}
+
+ValuePool::~ValuePool() = default;
+
+size_t ValuePool::size() const { return values_->set_.size(); }
+
+void ValuePool::clear() { values_->set_.clear(); }
+
+// Make value, whose parts are shared already, take the payload of an equal
+// value of the pool, or else share it and add it to the pool.
+void ValuePool::intern(Value& value) {
+  switch (value.type()) {
+  case stringValue:
+    // Not worth sharing, or not owned by the value.
+    if (!value.isAllocated())
+      return;
+    break;
+  case arrayValue:
+  case objectValue:
+    // Shared first, so that its hash is kept.
+    value.share();
+    break;
+  default:
+    return;
+  }
+  auto& set = values_->set_;
+  auto it = set.find(value);
+  if (it != set.end()) {
+    value.copyPayload(*it);
+    return;
+  }
+  value.share();
+  if (set.size() < maxSize_)
+    set.insert(value);
+}
+
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// class Value::Meta
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+// //////////////////////////////////////////////////////////////////
+
+Value::Meta* Value::findMeta() const {
+  return bits_.hasMeta_ ? value_.meta_ : nullptr;
+}
+
+Value::Meta& Value::demandMeta() {
+  if (!bits_.hasMeta_) {
+    auto meta = new Meta;
+    meta->payload_ = value_;
+    value_.meta_ = meta;
+    bits_.hasMeta_ = true;
+  }
+  return *value_.meta_;
+}
+
+void Value::releaseMeta() {
+  if (!bits_.hasMeta_)
+    return;
+  std::unique_ptr<Meta> meta(value_.meta_);
+  value_ = meta->payload_;
+  bits_.hasMeta_ = false;
+}
+
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
 // //////////////////////////////////////////////////////////////////
@@ -352,83 +1211,143 @@ Value::Value(ValueType type) {
     break;
   case intValue:
   case uintValue:
-    value_.int_ = 0;
+    payload().int_ = 0;
     break;
   case realValue:
-    value_.real_ = 0.0;
+    payload().real_ = 0.0;
     break;
   case stringValue:
     // allocated_ == false, so this is safe.
-    value_.string_ = const_cast<char*>(static_cast<char const*>(emptyString));
+    payload().string_ =
+        const_cast<char*>(static_cast<char const*>(emptyString));
     break;
   case arrayValue:
+    payload().array_ = new ArrayValues();
+    break;
   case objectValue:
-    value_.map_ = new ObjectValues();
+    payload().map_ = new ObjectValues();
     break;
   case booleanValue:
-    value_.bool_ = false;
+    payload().bool_ = false;
     break;
   default:
     JSON_ASSERT_UNREACHABLE;
   }
 }
 
+Value::Value(ValueType type, bool hashMembers) : Value(type) {
+  if (type == objectValue && hashMembers) {
+    delete payload().map_;
+    payload().map_ = new HashedObjectValues();
+    bits_.hashed_ = true;
+  }
+}
+
+Value::Value(ValueType type, Arena& arena) {
+  initBasic(type);
+  if (type == arrayValue) {
+    void* storage = arena.allocate(sizeof(ArrayValues), alignof(ArrayValues));
+    payload().array_ = new (storage) ArrayValues(ArenaAllocator<Value>(&arena));
+    bits_.arena_ = true;
+  } else if (type == objectValue) {
+    void* storage =
+        arena.allocate(sizeof(ObjectValues), alignof(ObjectValues));
+    payload().map_ = new (storage) ObjectValues(
+        std::less<CZString>(), ObjectValues::allocator_type(&arena));
+    bits_.arena_ = true;
+  } else {
+    // Scalars own nothing, so there is nothing to take from the arena.
+    payload() = Value(type).payload();
+  }
+}
+
 Value::Value(Int value) {
   initBasic(intValue);
-  value_.int_ = value;
+  payload().int_ = value;
 }
 
 Value::Value(UInt value) {
   initBasic(uintValue);
-  value_.uint_ = value;
+  payload().uint_ = value;
 }
 #if defined(JSON_HAS_INT64)
 Value::Value(Int64 value) {
   initBasic(intValue);
-  value_.int_ = value;
+  payload().int_ = value;
 }
 Value::Value(UInt64 value) {
   initBasic(uintValue);
-  value_.uint_ = value;
+  payload().uint_ = value;
 }
 #endif // defined(JSON_HAS_INT64)
 
 Value::Value(double value) {
   initBasic(realValue);
-  value_.real_ = value;
+  payload().real_ = value;
 }
 
 Value::Value(const char* value) {
-  initBasic(stringValue, true);
+  initBasic(stringValue);
   JSON_ASSERT_MESSAGE(value != nullptr,
                       "Null Value Passed to Value Constructor");
-  value_.string_ = duplicateAndPrefixStringValue(
-      value, static_cast<unsigned>(strlen(value)));
+  dupStringPayload(value, static_cast<unsigned>(strlen(value)));
 }
 
 Value::Value(const char* begin, const char* end) {
-  initBasic(stringValue, true);
-  value_.string_ =
-      duplicateAndPrefixStringValue(begin, static_cast<unsigned>(end - begin));
+  initBasic(stringValue);
+  dupStringPayload(begin, static_cast<unsigned>(end - begin));
+}
+
+Value::Value(const char* begin, const char* end, bool borrow) {
+  const auto length = static_cast<size_t>(end - begin);
+  initBasic(stringValue);
+  if (!borrow || length > Value::maxUInt) {
+    dupStringPayload(begin, static_cast<unsigned>(length));
+    return;
+  }
+  payload().string_ = const_cast<char*>(begin);
+  bits_.borrowed_ = true;
+  bits_.length_ = static_cast<unsigned>(length);
+}
+
+Value::Value(const char* begin, const char* end, Arena& arena) {
+  const auto length = static_cast<size_t>(end - begin);
+  JSON_ASSERT_MESSAGE(length <= static_cast<unsigned>(Value::maxInt) -
+                                    sizeof(unsigned) - 1U,
+                      "in Json::Value::Value(begin, end, arena): "
+                      "length too big for prefixing");
+  initBasic(stringValue);
+  if (length < sizeof(payload().chars_)) {
+    dupStringPayload(begin, static_cast<unsigned>(length));
+    return;
+  }
+  setIsAllocated(true);
+  auto prefixed = static_cast<char*>(
+      arena.allocate(sizeof(unsigned) + length + 1U, alignof(unsigned)));
+  *reinterpret_cast<unsigned*>(prefixed) = static_cast<unsigned>(length);
+  memcpy(prefixed + sizeof(unsigned), begin, length);
+  prefixed[sizeof(unsigned) + length] = 0;
+  payload().string_ = prefixed;
+  bits_.arena_ = true;
 }
 
 Value::Value(const String& value) {
-  initBasic(stringValue, true);
-  value_.string_ = duplicateAndPrefixStringValue(
-      value.data(), static_cast<unsigned>(value.length()));
+  initBasic(stringValue);
+  dupStringPayload(value.data(), static_cast<unsigned>(value.length()));
 }
 
 Value::Value(const StaticString& value) {
   initBasic(stringValue);
-  value_.string_ = const_cast<char*>(value.c_str());
+  payload().string_ = const_cast<char*>(value.c_str());
 }
 
 Value::Value(bool value) {
   initBasic(booleanValue);
-  value_.bool_ = value;
+  payload().bool_ = value;
 }
 
 Value::Value(const Value& other) {
+  bits_.hasMeta_ = false;
   dupPayload(other);
   dupMeta(other);
 }
@@ -440,7 +1359,9 @@ Value::Value(Value&& other) noexcept {
 
 Value::~Value() {
   releasePayload();
-  value_.uint_ = 0;
+  if (bits_.hasMeta_)
+    releaseMeta();
+  payload().uint_ = 0;
 }
 
 Value& Value::operator=(const Value& other) {
@@ -454,8 +1375,12 @@ Value& Value::operator=(Value&& other) noexcept {
 }
 
 void Value::swapPayload(Value& other) {
+  bool const hasMeta = bits_.hasMeta_;
+  bool const otherHasMeta = other.bits_.hasMeta_;
+  std::swap(payload(), other.payload());
   std::swap(bits_, other.bits_);
-  std::swap(value_, other.value_);
+  bits_.hasMeta_ = hasMeta;
+  other.bits_.hasMeta_ = otherHasMeta;
 }
 
 void Value::copyPayload(const Value& other) {
@@ -464,10 +1389,9 @@ void Value::copyPayload(const Value& other) {
 }
 
 void Value::swap(Value& other) {
-  swapPayload(other);
-  std::swap(comments_, other.comments_);
-  std::swap(start_, other.start_);
-  std::swap(limit_, other.limit_);
+  // The Meta, if any, goes along with the payload it holds.
+  std::swap(bits_, other.bits_);
+  std::swap(value_, other.value_);
 }
 
 void Value::copy(const Value& other) {
@@ -479,6 +1403,84 @@ ValueType Value::type() const {
   return static_cast<ValueType>(bits_.value_type_);
 }
 
+bool Value::hasHashedMembers() const {
+  return type() == objectValue && bits_.hashed_;
+}
+
+Value::HashedObjectValues* Value::hashedMap() const {
+  return static_cast<HashedObjectValues*>(payload().map_);
+}
+
+size_t Value::knownHash() const {
+  SharedPayload const* shared = sharedPayload();
+  return shared ? shared->knownHash() : 0;
+}
+
+size_t Value::hash(size_t seed) const {
+  if (bits_.lazy_)
+    materializeLazy();
+  SharedPayload const* const keep = seed == 0 ? sharedPayload() : nullptr;
+  if (keep) {
+    if (size_t known = keep->knownHash())
+      return known;
+  }
+  uint64_t hash = combineHash(seed, type());
+  switch (type()) {
+  case nullValue:
+    break;
+  case intValue:
+  case uintValue:
+    hash = combineHash(hash, mixHash(payload().uint_));
+    break;
+  case realValue: {
+    // -0.0 == 0.0, so both hash as 0.0.
+    double const real = payload().real_ == 0.0 ? 0.0 : payload().real_;
+    uint64_t bits;
+    memcpy(&bits, &real, sizeof(bits));
+    hash = combineHash(hash, mixHash(bits));
+    break;
+  }
+  case booleanValue:
+    hash = combineHash(hash, payload().bool_);
+    break;
+  case stringValue:
+    if (!isNullString()) {
+      unsigned length;
+      char const* str;
+      decodeStringPayload(&length, &str);
+      hash = combineHash(hash, hashBytes(str, length, seed));
+    }
+    break;
+  case arrayValue:
+    if (bits_.packed_) {
+      PackedNumbers const& numbers = *payload().packed_;
+      hash = combineHash(hash, numbers.size());
+      for (size_t index = 0; index < numbers.size(); ++index)
+        hash = combineHash(hash, numbers.at(index).hash(seed));
+      break;
+    }
+    hash = combineHash(hash, payload().array_->size());
+    for (const Value& element : *payload().array_)
+      hash = combineHash(hash, element.hash(seed));
+    break;
+  case objectValue:
+    hash = combineHash(hash, payload().map_->size());
+    for (const auto& member : *payload().map_) {
+      hash = combineHash(hash, hashBytes(member.first.data(),
+                                         member.first.length(), seed));
+      hash = combineHash(hash, member.second.hash(seed));
+    }
+    break;
+  default:
+    JSON_ASSERT_UNREACHABLE;
+  }
+  auto const result = static_cast<size_t>(mixHash(hash));
+  // 0 stands for an unknown hash, so such a hash is computed every time.
+  if (keep)
+    keep->setKnownHash(result);
+  return result;
+}
+
 int Value::compare(const Value& other) const {
   if (*this < other)
     return -1;
@@ -488,6 +1490,8 @@ int Value::compare(const Value& other) const {
 }
 
 bool Value::operator<(const Value& other) const {
+  materialize();
+  other.materialize();
   int typeDelta = type() - other.type();
   if (typeDelta)
     return typeDelta < 0;
@@ -495,25 +1499,23 @@ bool Value::operator<(const Value& other) const {
   case nullValue:
     return false;
   case intValue:
-    return value_.int_ < other.value_.int_;
+    return payload().int_ < other.payload().int_;
   case uintValue:
-    return value_.uint_ < other.value_.uint_;
+    return payload().uint_ < other.payload().uint_;
   case realValue:
-    return value_.real_ < other.value_.real_;
+    return payload().real_ < other.payload().real_;
   case booleanValue:
-    return value_.bool_ < other.value_.bool_;
+    return payload().bool_ < other.payload().bool_;
   case stringValue: {
-    if ((value_.string_ == nullptr) || (other.value_.string_ == nullptr)) {
-      return other.value_.string_ != nullptr;
+    if (isNullString() || other.isNullString()) {
+      return !other.isNullString();
     }
     unsigned this_len;
     unsigned other_len;
     char const* this_str;
     char const* other_str;
-    decodePrefixedString(this->isAllocated(), this->value_.string_, &this_len,
-                         &this_str);
-    decodePrefixedString(other.isAllocated(), other.value_.string_, &other_len,
-                         &other_str);
+    decodeStringPayload(&this_len, &this_str);
+    other.decodeStringPayload(&other_len, &other_str);
     unsigned min_len = std::min<unsigned>(this_len, other_len);
     JSON_ASSERT(this_str && other_str);
     int comp = memcmp(this_str, other_str, min_len);
@@ -523,13 +1525,19 @@ bool Value::operator<(const Value& other) const {
       return false;
     return (this_len < other_len);
   }
-  case arrayValue:
+  case arrayValue: {
+    auto thisSize = payload().array_->size();
+    auto otherSize = other.payload().array_->size();
+    if (thisSize != otherSize)
+      return thisSize < otherSize;
+    return (*payload().array_) < (*other.payload().array_);
+  }
   case objectValue: {
-    auto thisSize = value_.map_->size();
-    auto otherSize = other.value_.map_->size();
+    auto thisSize = payload().map_->size();
+    auto otherSize = other.payload().map_->size();
     if (thisSize != otherSize)
       return thisSize < otherSize;
-    return (*value_.map_) < (*other.value_.map_);
+    return (*payload().map_) < (*other.payload().map_);
   }
   default:
     JSON_ASSERT_UNREACHABLE;
@@ -544,31 +1552,41 @@ bool Value::operator>=(const Value& other) const { return !(*this < other); }
 bool Value::operator>(const Value& other) const { return other < *this; }
 
 bool Value::operator==(const Value& other) const {
+  if (bits_.lazy_)
+    materializeLazy();
+  if (other.bits_.lazy_)
+    other.materializeLazy();
   if (type() != other.type())
     return false;
+  if (bits_.packed_ || other.bits_.packed_)
+    return packedEquals(other);
+  if (bits_.shared_ && other.bits_.shared_) {
+    size_t const hash = knownHash();
+    size_t const otherHash = other.knownHash();
+    if (hash && otherHash && hash != otherHash)
+      return false;
+  }
   switch (type()) {
   case nullValue:
     return true;
   case intValue:
-    return value_.int_ == other.value_.int_;
+    return payload().int_ == other.payload().int_;
   case uintValue:
-    return value_.uint_ == other.value_.uint_;
+    return payload().uint_ == other.payload().uint_;
   case realValue:
-    return value_.real_ == other.value_.real_;
+    return payload().real_ == other.payload().real_;
   case booleanValue:
-    return value_.bool_ == other.value_.bool_;
+    return payload().bool_ == other.payload().bool_;
   case stringValue: {
-    if ((value_.string_ == nullptr) || (other.value_.string_ == nullptr)) {
-      return (value_.string_ == other.value_.string_);
+    if (isNullString() || other.isNullString()) {
+      return isNullString() == other.isNullString();
     }
     unsigned this_len;
     unsigned other_len;
     char const* this_str;
     char const* other_str;
-    decodePrefixedString(this->isAllocated(), this->value_.string_, &this_len,
-                         &this_str);
-    decodePrefixedString(other.isAllocated(), other.value_.string_, &other_len,
-                         &other_str);
+    decodeStringPayload(&this_len, &this_str);
+    other.decodeStringPayload(&other_len, &other_str);
     if (this_len != other_len)
       return false;
     JSON_ASSERT(this_str && other_str);
@@ -576,9 +1594,11 @@ bool Value::operator==(const Value& other) const {
     return comp == 0;
   }
   case arrayValue:
+    return payload().array_->size() == other.payload().array_->size() &&
+           (*payload().array_) == (*other.payload().array_);
   case objectValue:
-    return value_.map_->size() == other.value_.map_->size() &&
-           (*value_.map_) == (*other.value_.map_);
+    return payload().map_->size() == other.payload().map_->size() &&
+           (*payload().map_) == (*other.payload().map_);
   default:
     JSON_ASSERT_UNREACHABLE;
   }
@@ -590,12 +1610,14 @@ bool Value::operator!=(const Value& other) const { return !(*this == other); }
 const char* Value::asCString() const {
   JSON_ASSERT_MESSAGE(type() == stringValue,
                       "in Json::Value::asCString(): requires stringValue");
-  if (value_.string_ == nullptr)
+  JSON_ASSERT_MESSAGE(!bits_.borrowed_,
+                      "in Json::Value::asCString(): requires a string that "
+                      "is not borrowed");
+  if (isNullString())
     return nullptr;
   unsigned this_len;
   char const* this_str;
-  decodePrefixedString(this->isAllocated(), this->value_.string_, &this_len,
-                       &this_str);
+  decodeStringPayload(&this_len, &this_str);
   return this_str;
 }
 
@@ -603,12 +1625,11 @@ const char* Value::asCString() const {
 unsigned Value::getCStringLength() const {
   JSON_ASSERT_MESSAGE(type() == stringValue,
                       "in Json::Value::asCString(): requires stringValue");
-  if (value_.string_ == 0)
+  if (isNullString())
     return 0;
   unsigned this_len;
   char const* this_str;
-  decodePrefixedString(this->isAllocated(), this->value_.string_, &this_len,
-                       &this_str);
+  decodeStringPayload(&this_len, &this_str);
   return this_len;
 }
 #endif
@@ -616,11 +1637,10 @@ unsigned Value::getCStringLength() const {
 bool Value::getString(char const** begin, char const** end) const {
   if (type() != stringValue)
     return false;
-  if (value_.string_ == nullptr)
+  if (isNullString())
     return false;
   unsigned length;
-  decodePrefixedString(this->isAllocated(), this->value_.string_, &length,
-                       begin);
+  decodeStringPayload(&length, begin);
   *end = *begin + length;
   return true;
 }
@@ -630,22 +1650,21 @@ String Value::asString() const {
   case nullValue:
     return "";
   case stringValue: {
-    if (value_.string_ == nullptr)
+    if (isNullString())
       return "";
     unsigned this_len;
     char const* this_str;
-    decodePrefixedString(this->isAllocated(), this->value_.string_, &this_len,
-                         &this_str);
+    decodeStringPayload(&this_len, &this_str);
     return String(this_str, this_len);
   }
   case booleanValue:
-    return value_.bool_ ? "true" : "false";
+    return payload().bool_ ? "true" : "false";
   case intValue:
-    return valueToString(value_.int_);
+    return valueToString(payload().int_);
   case uintValue:
-    return valueToString(value_.uint_);
+    return valueToString(payload().uint_);
   case realValue:
-    return valueToString(value_.real_);
+    return valueToString(payload().real_);
   default:
     JSON_FAIL_MESSAGE("Type is not convertible to string");
   }
@@ -655,18 +1674,18 @@ Value::Int Value::asInt() const {
   switch (type()) {
   case intValue:
     JSON_ASSERT_MESSAGE(isInt(), "LargestInt out of Int range");
-    return Int(value_.int_);
+    return Int(payload().int_);
   case uintValue:
     JSON_ASSERT_MESSAGE(isInt(), "LargestUInt out of Int range");
-    return Int(value_.uint_);
+    return Int(payload().uint_);
   case realValue:
-    JSON_ASSERT_MESSAGE(InRange(value_.real_, minInt, maxInt),
+    JSON_ASSERT_MESSAGE(InRange(payload().real_, minInt, maxInt),
                         "double out of Int range");
-    return Int(value_.real_);
+    return Int(payload().real_);
   case nullValue:
     return 0;
   case booleanValue:
-    return value_.bool_ ? 1 : 0;
+    return payload().bool_ ? 1 : 0;
   default:
     break;
   }
@@ -677,18 +1696,18 @@ Value::UInt Value::asUInt() const {
   switch (type()) {
   case intValue:
     JSON_ASSERT_MESSAGE(isUInt(), "LargestInt out of UInt range");
-    return UInt(value_.int_);
+    return UInt(payload().int_);
   case uintValue:
     JSON_ASSERT_MESSAGE(isUInt(), "LargestUInt out of UInt range");
-    return UInt(value_.uint_);
+    return UInt(payload().uint_);
   case realValue:
-    JSON_ASSERT_MESSAGE(InRange(value_.real_, 0, maxUInt),
+    JSON_ASSERT_MESSAGE(InRange(payload().real_, 0, maxUInt),
                         "double out of UInt range");
-    return UInt(value_.real_);
+    return UInt(payload().real_);
   case nullValue:
     return 0;
   case booleanValue:
-    return value_.bool_ ? 1 : 0;
+    return payload().bool_ ? 1 : 0;
   default:
     break;
   }
@@ -700,18 +1719,18 @@ Value::UInt Value::asUInt() const {
 Value::Int64 Value::asInt64() const {
   switch (type()) {
   case intValue:
-    return Int64(value_.int_);
+    return Int64(payload().int_);
   case uintValue:
     JSON_ASSERT_MESSAGE(isInt64(), "LargestUInt out of Int64 range");
-    return Int64(value_.uint_);
+    return Int64(payload().uint_);
   case realValue:
-    JSON_ASSERT_MESSAGE(InRange(value_.real_, minInt64, maxInt64),
+    JSON_ASSERT_MESSAGE(InRange(payload().real_, minInt64, maxInt64),
                         "double out of Int64 range");
-    return Int64(value_.real_);
+    return Int64(payload().real_);
   case nullValue:
     return 0;
   case booleanValue:
-    return value_.bool_ ? 1 : 0;
+    return payload().bool_ ? 1 : 0;
   default:
     break;
   }
@@ -722,17 +1741,17 @@ Value::UInt64 Value::asUInt64() const {
   switch (type()) {
   case intValue:
     JSON_ASSERT_MESSAGE(isUInt64(), "LargestInt out of UInt64 range");
-    return UInt64(value_.int_);
+    return UInt64(payload().int_);
   case uintValue:
-    return UInt64(value_.uint_);
+    return UInt64(payload().uint_);
   case realValue:
-    JSON_ASSERT_MESSAGE(InRange(value_.real_, 0, maxUInt64),
+    JSON_ASSERT_MESSAGE(InRange(payload().real_, 0, maxUInt64),
                         "double out of UInt64 range");
-    return UInt64(value_.real_);
+    return UInt64(payload().real_);
   case nullValue:
     return 0;
   case booleanValue:
-    return value_.bool_ ? 1 : 0;
+    return payload().bool_ ? 1 : 0;
   default:
     break;
   }
@@ -759,19 +1778,19 @@ LargestUInt Value::asLargestUInt() const {
 double Value::asDouble() const {
   switch (type()) {
   case intValue:
-    return static_cast<double>(value_.int_);
+    return static_cast<double>(payload().int_);
   case uintValue:
 #if !defined(JSON_USE_INT64_DOUBLE_CONVERSION)
-    return static_cast<double>(value_.uint_);
+    return static_cast<double>(payload().uint_);
 #else  // if !defined(JSON_USE_INT64_DOUBLE_CONVERSION)
-    return integerToDouble(value_.uint_);
+    return integerToDouble(payload().uint_);
 #endif // if !defined(JSON_USE_INT64_DOUBLE_CONVERSION)
   case realValue:
-    return value_.real_;
+    return payload().real_;
   case nullValue:
     return 0.0;
   case booleanValue:
-    return value_.bool_ ? 1.0 : 0.0;
+    return payload().bool_ ? 1.0 : 0.0;
   default:
     break;
   }
@@ -781,20 +1800,20 @@ double Value::asDouble() const {
 float Value::asFloat() const {
   switch (type()) {
   case intValue:
-    return static_cast<float>(value_.int_);
+    return static_cast<float>(payload().int_);
   case uintValue:
 #if !defined(JSON_USE_INT64_DOUBLE_CONVERSION)
-    return static_cast<float>(value_.uint_);
+    return static_cast<float>(payload().uint_);
 #else  // if !defined(JSON_USE_INT64_DOUBLE_CONVERSION)
     // This can fail (silently?) if the value is bigger than MAX_FLOAT.
-    return static_cast<float>(integerToDouble(value_.uint_));
+    return static_cast<float>(integerToDouble(payload().uint_));
 #endif // if !defined(JSON_USE_INT64_DOUBLE_CONVERSION)
   case realValue:
-    return static_cast<float>(value_.real_);
+    return static_cast<float>(payload().real_);
   case nullValue:
     return 0.0;
   case booleanValue:
-    return value_.bool_ ? 1.0F : 0.0F;
+    return payload().bool_ ? 1.0F : 0.0F;
   default:
     break;
   }
@@ -804,16 +1823,16 @@ float Value::asFloat() const {
 bool Value::asBool() const {
   switch (type()) {
   case booleanValue:
-    return value_.bool_;
+    return payload().bool_;
   case nullValue:
     return false;
   case intValue:
-    return value_.int_ != 0;
+    return payload().int_ != 0;
   case uintValue:
-    return value_.uint_ != 0;
+    return payload().uint_ != 0;
   case realValue: {
     // According to JavaScript language zero or NaN is regarded as false
-    const auto value_classification = std::fpclassify(value_.real_);
+    const auto value_classification = std::fpclassify(payload().real_);
     return value_classification != FP_ZERO && value_classification != FP_NAN;
   }
   default:
@@ -823,21 +1842,22 @@ bool Value::asBool() const {
 }
 
 bool Value::isConvertibleTo(ValueType other) const {
+  materialize();
   switch (other) {
   case nullValue:
     return (isNumeric() && asDouble() == 0.0) ||
-           (type() == booleanValue && !value_.bool_) ||
+           (type() == booleanValue && !payload().bool_) ||
            (type() == stringValue && asString().empty()) ||
-           (type() == arrayValue && value_.map_->empty()) ||
-           (type() == objectValue && value_.map_->empty()) ||
+           (type() == arrayValue && payload().array_->empty()) ||
+           (type() == objectValue && payload().map_->empty()) ||
            type() == nullValue;
   case intValue:
     return isInt() ||
-           (type() == realValue && InRange(value_.real_, minInt, maxInt)) ||
+           (type() == realValue && InRange(payload().real_, minInt, maxInt)) ||
            type() == booleanValue || type() == nullValue;
   case uintValue:
     return isUInt() ||
-           (type() == realValue && InRange(value_.real_, 0, maxUInt)) ||
+           (type() == realValue && InRange(payload().real_, 0, maxUInt)) ||
            type() == booleanValue || type() == nullValue;
   case realValue:
     return isNumeric() || type() == booleanValue || type() == nullValue;
@@ -857,6 +1877,12 @@ bool Value::isConvertibleTo(ValueType other) const {
 
 /// Number of values in array or object
 ArrayIndex Value::size() const {
+  // A lazy array may turn out to be packed.
+  if (bits_.lazy_)
+    materializeLazy();
+  if (bits_.packed_)
+    return ArrayIndex(payload().packed_->size());
+  materialize();
   switch (type()) {
   case nullValue:
   case intValue:
@@ -865,15 +1891,10 @@ ArrayIndex Value::size() const {
   case booleanValue:
   case stringValue:
     return 0;
-  case arrayValue: // size of the array is highest index + 1
-    if (!value_.map_->empty()) {
-      ObjectValues::const_iterator itLast = value_.map_->end();
-      --itLast;
-      return (*itLast).first.index() + 1;
-    }
-    return 0;
+  case arrayValue:
+    return ArrayIndex(payload().array_->size());
   case objectValue:
-    return ArrayIndex(value_.map_->size());
+    return ArrayIndex(payload().map_->size());
   }
   JSON_ASSERT_UNREACHABLE;
   return 0; // unreachable;
@@ -891,12 +1912,27 @@ void Value::clear() {
   JSON_ASSERT_MESSAGE(type() == nullValue || type() == arrayValue ||
                           type() == objectValue,
                       "in Json::Value::clear(): requires complex value");
-  start_ = 0;
-  limit_ = 0;
+  if (Meta* meta = findMeta()) {
+    meta->start_ = 0;
+    meta->limit_ = 0;
+  }
+  if (bits_.lazy_ || bits_.shared_ || bits_.packed_) {
+    // No need to read, copy or unpack what is thrown away, but an object
+    // keeps the way it looks up members.
+    const bool hashed = bits_.lazy_ ? payload().lazy_->source_->hashesMembers()
+                                    : bits_.hashed_;
+    Value empty(type(), hashed);
+    swapPayload(empty);
+  }
   switch (type()) {
   case arrayValue:
+    payload().array_->clear();
+    break;
   case objectValue:
-    value_.map_->clear();
+    if (hasHashedMembers())
+      hashedMap()->clearMembers();
+    else
+      payload().map_->clear();
     break;
   default:
     break;
@@ -904,38 +1940,50 @@ void Value::clear() {
 }
 
 void Value::resize(ArrayIndex newSize) {
+  materialize();
+  unshare();
   JSON_ASSERT_MESSAGE(type() == nullValue || type() == arrayValue,
                       "in Json::Value::resize(): requires arrayValue");
+  JSON_ASSERT_MESSAGE(newSize <= size() || newSize - size() <= maxArrayGap,
+                      "in Json::Value::resize(): newSize is too far past the "
+                      "end of the array");
   if (type() == nullValue)
     *this = Value(arrayValue);
-  ArrayIndex oldSize = size();
   if (newSize == 0)
     clear();
-  else if (newSize > oldSize)
-    for (ArrayIndex i = oldSize; i < newSize; ++i)
-      (*this)[i];
-  else {
-    for (ArrayIndex index = newSize; index < oldSize; ++index) {
-      value_.map_->erase(index);
-    }
-    JSON_ASSERT(size() == newSize);
-  }
+  else
+    payload().array_->resize(newSize);
+}
+
+void Value::reserve(ArrayIndex newCapacity) {
+  materialize();
+  unshare();
+  JSON_ASSERT_MESSAGE(type() == nullValue || type() == arrayValue,
+                      "in Json::Value::reserve(): requires arrayValue");
+  JSON_ASSERT_MESSAGE(newCapacity <= size() || newCapacity - size() <= maxArrayGap,
+                      "in Json::Value::reserve(): newCapacity is too far past the "
+                      "end of the array");
+  if (type() == nullValue)
+    *this = Value(arrayValue);
+  payload().array_->reserve(newCapacity);
 }
 
 Value& Value::operator[](ArrayIndex index) {
+  materialize();
+  unshare();
   JSON_ASSERT_MESSAGE(
       type() == nullValue || type() == arrayValue,
       "in Json::Value::operator[](ArrayIndex): requires arrayValue");
   if (type() == nullValue)
     *this = Value(arrayValue);
-  CZString key(index);
-  auto it = value_.map_->lower_bound(key);
-  if (it != value_.map_->end() && (*it).first == key)
-    return (*it).second;
-
-  ObjectValues::value_type defaultValue(key, nullSingleton());
-  it = value_.map_->insert(it, defaultValue);
-  return (*it).second;
+  ArrayValues& array = *payload().array_;
+  if (index >= array.size()) {
+    JSON_ASSERT_MESSAGE(index - array.size() <= maxArrayGap,
+                        "in Json::Value::operator[](ArrayIndex): index is "
+                        "too far past the end of the array");
+    array.resize(size_t(index) + 1);
+  }
+  return array[index];
 }
 
 Value& Value::operator[](int index) {
@@ -946,16 +1994,13 @@ Value& Value::operator[](int index) {
 }
 
 const Value& Value::operator[](ArrayIndex index) const {
+  materialize();
   JSON_ASSERT_MESSAGE(
       type() == nullValue || type() == arrayValue,
       "in Json::Value::operator[](ArrayIndex)const: requires arrayValue");
-  if (type() == nullValue)
+  if (type() == nullValue || index >= payload().array_->size())
     return nullSingleton();
-  CZString key(index);
-  ObjectValues::const_iterator it = value_.map_->find(key);
-  if (it == value_.map_->end())
-    return nullSingleton();
-  return (*it).second;
+  return (*payload().array_)[index];
 }
 
 const Value& Value::operator[](int index) const {
@@ -968,37 +2013,76 @@ const Value& Value::operator[](int index) const {
 void Value::initBasic(ValueType type, bool allocated) {
   setType(type);
   setIsAllocated(allocated);
-  comments_ = Comments{};
-  start_ = 0;
-  limit_ = 0;
+  bits_.hashed_ = false;
+  bits_.borrowed_ = false;
+  bits_.inline_ = false;
+  bits_.length_ = 0;
+  bits_.arena_ = false;
+  bits_.hasMeta_ = false;
+  bits_.lazy_ = false;
+  bits_.shared_ = false;
+  bits_.packed_ = false;
 }
 
 void Value::dupPayload(const Value& other) {
   setType(other.type());
   setIsAllocated(false);
+  bits_.hashed_ = other.bits_.hashed_;
+  bits_.borrowed_ = other.bits_.borrowed_;
+  bits_.inline_ = other.bits_.inline_;
+  bits_.length_ = other.bits_.length_;
+  bits_.arena_ = false;
+  bits_.lazy_ = other.bits_.lazy_;
+  bits_.shared_ = other.bits_.shared_;
+  bits_.packed_ = other.bits_.packed_;
+  if (bits_.lazy_) {
+    payload().lazy_ = new LazyNode(*other.payload().lazy_);
+    return;
+  }
+  if (bits_.packed_) {
+    payload().packed_ = new PackedNumbers(*other.payload().packed_);
+    return;
+  }
+  if (bits_.shared_) {
+    switch (type()) {
+    case stringValue:
+      setIsAllocated(true);
+      payload().string_ = other.payload().string_;
+      retainSharedName(payload().string_);
+      break;
+    default:
+      payload() = other.payload();
+      other.sharedPayload()->retain();
+      break;
+    }
+    return;
+  }
   switch (type()) {
   case nullValue:
   case intValue:
   case uintValue:
   case realValue:
   case booleanValue:
-    value_ = other.value_;
+    payload() = other.payload();
     break;
   case stringValue:
-    if (other.value_.string_ && other.isAllocated()) {
+    if (other.isAllocated()) {
       unsigned len;
       char const* str;
-      decodePrefixedString(other.isAllocated(), other.value_.string_, &len,
-                           &str);
-      value_.string_ = duplicateAndPrefixStringValue(str, len);
-      setIsAllocated(true);
+      other.decodeStringPayload(&len, &str);
+      dupStringPayload(str, len);
     } else {
-      value_.string_ = other.value_.string_;
+      payload() = other.payload();
     }
     break;
   case arrayValue:
+    payload().array_ = new ArrayValues(*other.payload().array_);
+    break;
   case objectValue:
-    value_.map_ = new ObjectValues(*other.value_.map_);
+    if (other.hasHashedMembers())
+      payload().map_ = new HashedObjectValues(*other.hashedMap());
+    else
+      payload().map_ = new ObjectValues(*other.payload().map_);
     break;
   default:
     JSON_ASSERT_UNREACHABLE;
@@ -1006,6 +2090,18 @@ void Value::dupPayload(const Value& other) {
 }
 
 void Value::releasePayload() {
+  if (bits_.lazy_) {
+    delete payload().lazy_;
+    return;
+  }
+  if (bits_.packed_) {
+    delete payload().packed_;
+    return;
+  }
+  if (bits_.shared_) {
+    releaseShared();
+    return;
+  }
   switch (type()) {
   case nullValue:
   case intValue:
@@ -1014,65 +2110,142 @@ void Value::releasePayload() {
   case booleanValue:
     break;
   case stringValue:
-    if (isAllocated())
-      releasePrefixedStringValue(value_.string_);
+    if (isAllocated() && !bits_.arena_)
+      releasePrefixedStringValue(payload().string_);
     break;
   case arrayValue:
+    if (bits_.arena_)
+      payload().array_->~ArrayValues();
+    else
+      delete payload().array_;
+    break;
   case objectValue:
-    delete value_.map_;
+    if (bits_.arena_)
+      payload().map_->~ObjectValues();
+    else if (hasHashedMembers())
+      delete hashedMap();
+    else
+      delete payload().map_;
     break;
   default:
     JSON_ASSERT_UNREACHABLE;
   }
 }
 
+// Store a copy of [str, str + length) as the string payload, in chars_ if it
+// fits with its null terminator.
+void Value::dupStringPayload(char const* str, unsigned length) {
+  if (length < sizeof(payload().chars_)) {
+    payload().uint_ = 0;
+    memcpy(payload().chars_, str, length);
+    bits_.inline_ = true;
+    bits_.length_ = length;
+    setIsAllocated(false);
+  } else {
+    payload().string_ = duplicateAndPrefixStringValue(str, length);
+    setIsAllocated(true);
+  }
+}
+
+bool Value::isNullString() const {
+  return !bits_.inline_ && payload().string_ == nullptr;
+}
+
+void Value::decodeStringPayload(unsigned* length, char const** value) const {
+  if (bits_.borrowed_ || bits_.inline_) {
+    *length = bits_.length_;
+    *value = bits_.inline_ ? payload().chars_ : payload().string_;
+  } else {
+    decodePrefixedString(isAllocated(), payload().string_, length, value);
+  }
+}
+
 void Value::dupMeta(const Value& other) {
-  comments_ = other.comments_;
-  start_ = other.start_;
-  limit_ = other.limit_;
+  if (this == &other)
+    return;
+  if (!other.bits_.hasMeta_) {
+    releaseMeta();
+    return;
+  }
+  Meta const& from = *other.findMeta();
+  Meta& meta = demandMeta();
+  meta.comments_ = from.comments_;
+  meta.start_ = from.start_;
+  meta.limit_ = from.limit_;
 }
 
 // Access an object value by name, create a null member if it does not exist.
 // @pre Type of '*this' is object or null.
 // @param key is null-terminated.
 Value& Value::resolveReference(const char* key) {
+  materialize();
+  unshare();
   JSON_ASSERT_MESSAGE(
       type() == nullValue || type() == objectValue,
       "in Json::Value::resolveReference(): requires objectValue");
   if (type() == nullValue)
     *this = Value(objectValue);
+  if (hasHashedMembers())
+    return hashedMap()->resolve(key, static_cast<unsigned>(strlen(key)),
+                                CZString::noDuplication);
   CZString actualKey(key, static_cast<unsigned>(strlen(key)),
                      CZString::noDuplication); // NOTE!
-  auto it = value_.map_->lower_bound(actualKey);
-  if (it != value_.map_->end() && (*it).first == actualKey)
+  auto it = payload().map_->lower_bound(actualKey);
+  if (it != payload().map_->end() && (*it).first == actualKey)
     return (*it).second;
 
   ObjectValues::value_type defaultValue(actualKey, nullSingleton());
-  it = value_.map_->insert(it, defaultValue);
+  it = payload().map_->insert(it, defaultValue);
   Value& value = (*it).second;
   return value;
 }
 
 // @param key is not null-terminated.
-Value& Value::resolveReference(char const* key, char const* end) {
+Value& Value::resolveReference(char const* key, char const* end,
+                               CZString::DuplicationPolicy policy,
+                               NamePool* pool) {
+  materialize();
+  unshare();
   JSON_ASSERT_MESSAGE(
       type() == nullValue || type() == objectValue,
       "in Json::Value::resolveReference(key, end): requires objectValue");
   if (type() == nullValue)
     *this = Value(objectValue);
-  CZString actualKey(key, static_cast<unsigned>(end - key),
-                     CZString::duplicateOnCopy);
-  auto it = value_.map_->lower_bound(actualKey);
-  if (it != value_.map_->end() && (*it).first == actualKey)
+  if (hasHashedMembers())
+    return hashedMap()->resolve(key, static_cast<unsigned>(end - key), policy,
+                                pool);
+  const auto length = static_cast<unsigned>(end - key);
+  CZString actualKey(key, length, policy);
+  auto it = payload().map_->lower_bound(actualKey);
+  if (it != payload().map_->end() && (*it).first == actualKey)
     return (*it).second;
 
-  ObjectValues::value_type defaultValue(actualKey, nullSingleton());
-  it = value_.map_->insert(it, defaultValue);
-  Value& value = (*it).second;
-  return value;
+  if (pool) {
+    it = payload().map_->emplace_hint(it, pool->intern(key, length), Value());
+    return (*it).second;
+  }
+  Arena* arena = payload().map_->get_allocator().arena();
+  if (arena && policy != CZString::noDuplication) {
+    // Keep the name with the members rather than duplicating it on insertion.
+    auto name = static_cast<char*>(arena->allocate(length + 1U, 1));
+    memcpy(name, key, length);
+    name[length] = 0;
+    it = payload().map_->emplace_hint(
+        it, CZString(name, length, CZString::arenaCopy), Value());
+    return (*it).second;
+  }
+  // Copy the name only once, into the new member.
+  it = payload().map_->emplace_hint(it, actualKey, Value());
+  return (*it).second;
 }
 
 Value Value::get(ArrayIndex index, const Value& defaultValue) const {
+  if (bits_.lazy_)
+    materializeLazy();
+  if (bits_.packed_) {
+    PackedNumbers const& numbers = *payload().packed_;
+    return index < numbers.size() ? numbers.at(index) : defaultValue;
+  }
   const Value* value = &((*this)[index]);
   return value == &nullSingleton() ? defaultValue : *value;
 }
@@ -1080,15 +2253,18 @@ Value Value::get(ArrayIndex index, const Value& defaultValue) const {
 bool Value::isValidIndex(ArrayIndex index) const { return index < size(); }
 
 Value const* Value::find(char const* begin, char const* end) const {
+  materialize();
   JSON_ASSERT_MESSAGE(type() == nullValue || type() == objectValue,
                       "in Json::Value::find(begin, end): requires "
                       "objectValue or nullValue");
   if (type() == nullValue)
     return nullptr;
+  if (hasHashedMembers())
+    return hashedMap()->find(begin, static_cast<unsigned>(end - begin));
   CZString actualKey(begin, static_cast<unsigned>(end - begin),
                      CZString::noDuplication);
-  ObjectValues::const_iterator it = value_.map_->find(actualKey);
-  if (it == value_.map_->end())
+  ObjectValues::const_iterator it = payload().map_->find(actualKey);
+  if (it == payload().map_->end())
     return nullptr;
   return &(*it).second;
 }
@@ -1096,7 +2272,21 @@ Value* Value::demand(char const* begin, char const* end) {
   JSON_ASSERT_MESSAGE(type() == nullValue || type() == objectValue,
                       "in Json::Value::demand(begin, end): requires "
                       "objectValue or nullValue");
-  return &resolveReference(begin, end);
+  return &resolveReference(begin, end, CZString::duplicateOnCopy);
+}
+Value* Value::demand(char const* begin, char const* end, bool borrowKey) {
+  JSON_ASSERT_MESSAGE(type() == nullValue || type() == objectValue,
+                      "in Json::Value::demand(begin, end, borrowKey): requires "
+                      "objectValue or nullValue");
+  return &resolveReference(begin, end,
+                           borrowKey ? CZString::noDuplication
+                                     : CZString::duplicateOnCopy);
+}
+Value* Value::demand(char const* begin, char const* end, NamePool& pool) {
+  JSON_ASSERT_MESSAGE(type() == nullValue || type() == objectValue,
+                      "in Json::Value::demand(begin, end, pool): requires "
+                      "objectValue or nullValue");
+  return &resolveReference(begin, end, CZString::duplicateOnCopy, &pool);
 }
 const Value& Value::operator[](const char* key) const {
   Value const* found = find(key, key + strlen(key));
@@ -1112,11 +2302,12 @@ Value const& Value::operator[](const String& key) const {
 }
 
 Value& Value::operator[](const char* key) {
-  return resolveReference(key, key + strlen(key));
+  return resolveReference(key, key + strlen(key), CZString::duplicateOnCopy);
 }
 
 Value& Value::operator[](const String& key) {
-  return resolveReference(key.data(), key.data() + key.length());
+  return resolveReference(key.data(), key.data() + key.length(),
+                          CZString::duplicateOnCopy);
 }
 
 Value& Value::operator[](const StaticString& key) {
@@ -1126,12 +2317,15 @@ Value& Value::operator[](const StaticString& key) {
 Value& Value::append(const Value& value) { return append(Value(value)); }
 
 Value& Value::append(Value&& value) {
+  materialize();
+  unshare();
   JSON_ASSERT_MESSAGE(type() == nullValue || type() == arrayValue,
                       "in Json::Value::append: requires arrayValue");
   if (type() == nullValue) {
     *this = Value(arrayValue);
   }
-  return this->value_.map_->emplace(size(), std::move(value)).first->second;
+  payload().array_->push_back(std::move(value));
+  return payload().array_->back();
 }
 
 bool Value::insert(ArrayIndex index, const Value& newValue) {
@@ -1139,16 +2333,21 @@ bool Value::insert(ArrayIndex index, const Value& newValue) {
 }
 
 bool Value::insert(ArrayIndex index, Value&& newValue) {
+  if (bits_.lazy_)
+    materializeLazy();
+  if (bits_.packed_ && index <= payload().packed_->size() &&
+      payload().packed_->insert(index, newValue))
+    return true;
+  materialize();
+  unshare();
   JSON_ASSERT_MESSAGE(type() == nullValue || type() == arrayValue,
                       "in Json::Value::insert: requires arrayValue");
-  ArrayIndex length = size();
-  if (index > length) {
+  if (index > size()) {
     return false;
   }
-  for (ArrayIndex i = length; i > index; i--) {
-    (*this)[i] = std::move((*this)[i - 1]);
-  }
-  (*this)[index] = std::move(newValue);
+  if (type() == nullValue)
+    *this = Value(arrayValue);
+  payload().array_->insert(index, std::move(newValue));
   return true;
 }
 
@@ -1165,17 +2364,22 @@ Value Value::get(String const& key, Value const& defaultValue) const {
 }
 
 bool Value::removeMember(const char* begin, const char* end, Value* removed) {
+  materialize();
+  unshare();
   if (type() != objectValue) {
     return false;
   }
+  if (hasHashedMembers())
+    return hashedMap()->remove(begin, static_cast<unsigned>(end - begin),
+                               removed);
   CZString actualKey(begin, static_cast<unsigned>(end - begin),
                      CZString::noDuplication);
-  auto it = value_.map_->find(actualKey);
-  if (it == value_.map_->end())
+  auto it = payload().map_->find(actualKey);
+  if (it == payload().map_->end())
     return false;
   if (removed)
     *removed = std::move(it->second);
-  value_.map_->erase(it);
+  payload().map_->erase(it);
   return true;
 }
 bool Value::removeMember(const char* key, Value* removed) {
@@ -1185,37 +2389,46 @@ bool Value::removeMember(String const& key, Value* removed) {
   return removeMember(key.data(), key.data() + key.length(), removed);
 }
 void Value::removeMember(const char* key) {
+  materialize();
+  unshare();
   JSON_ASSERT_MESSAGE(type() == nullValue || type() == objectValue,
                       "in Json::Value::removeMember(): requires objectValue");
   if (type() == nullValue)
     return;
+  if (hasHashedMembers()) {
+    hashedMap()->remove(key, unsigned(strlen(key)), nullptr);
+    return;
+  }
 
   CZString actualKey(key, unsigned(strlen(key)), CZString::noDuplication);
-  value_.map_->erase(actualKey);
+  payload().map_->erase(actualKey);
 }
 void Value::removeMember(const String& key) { removeMember(key.c_str()); }
 
 bool Value::removeIndex(ArrayIndex index, Value* removed) {
+  if (bits_.lazy_)
+    materializeLazy();
+  if (bits_.packed_) {
+    PackedNumbers& numbers = *payload().packed_;
+    if (index >= numbers.size())
+      return false;
+    if (removed)
+      *removed = numbers.at(index);
+    numbers.erase(index);
+    return true;
+  }
+  materialize();
+  unshare();
   if (type() != arrayValue) {
     return false;
   }
-  CZString key(index);
-  auto it = value_.map_->find(key);
-  if (it == value_.map_->end()) {
+  if (index >= payload().array_->size()) {
     return false;
   }
   if (removed)
-    *removed = it->second;
-  ArrayIndex oldSize = size();
+    *removed = std::move((*payload().array_)[index]);
   // shift left all items left, into the place of the "removed"
-  for (ArrayIndex i = index; i < (oldSize - 1); ++i) {
-    CZString keey(i);
-    (*value_.map_)[keey] = (*this)[i + 1];
-  }
-  // erase the last one ("leftover")
-  CZString keyLast(oldSize - 1);
-  auto itLast = value_.map_->find(keyLast);
-  value_.map_->erase(itLast);
+  payload().array_->erase(index);
   return true;
 }
 
@@ -1231,15 +2444,16 @@ bool Value::isMember(String const& key) const {
 }
 
 Value::Members Value::getMemberNames() const {
+  materialize();
   JSON_ASSERT_MESSAGE(
       type() == nullValue || type() == objectValue,
       "in Json::Value::getMemberNames(), value must be objectValue");
   if (type() == nullValue)
     return Value::Members();
   Members members;
-  members.reserve(value_.map_->size());
-  ObjectValues::const_iterator it = value_.map_->begin();
-  ObjectValues::const_iterator itEnd = value_.map_->end();
+  members.reserve(payload().map_->size());
+  ObjectValues::const_iterator it = payload().map_->begin();
+  ObjectValues::const_iterator itEnd = payload().map_->end();
   for (; it != itEnd; ++it) {
     members.push_back(String((*it).first.data(), (*it).first.length()));
   }
@@ -1259,15 +2473,15 @@ bool Value::isInt() const {
   switch (type()) {
   case intValue:
 #if defined(JSON_HAS_INT64)
-    return value_.int_ >= minInt && value_.int_ <= maxInt;
+    return payload().int_ >= minInt && payload().int_ <= maxInt;
 #else
     return true;
 #endif
   case uintValue:
-    return value_.uint_ <= UInt(maxInt);
+    return payload().uint_ <= UInt(maxInt);
   case realValue:
-    return value_.real_ >= minInt && value_.real_ <= maxInt &&
-           IsIntegral(value_.real_);
+    return payload().real_ >= minInt && payload().real_ <= maxInt &&
+           IsIntegral(payload().real_);
   default:
     break;
   }
@@ -1278,19 +2492,20 @@ bool Value::isUInt() const {
   switch (type()) {
   case intValue:
 #if defined(JSON_HAS_INT64)
-    return value_.int_ >= 0 && LargestUInt(value_.int_) <= LargestUInt(maxUInt);
+    return payload().int_ >= 0 &&
+           LargestUInt(payload().int_) <= LargestUInt(maxUInt);
 #else
-    return value_.int_ >= 0;
+    return payload().int_ >= 0;
 #endif
   case uintValue:
 #if defined(JSON_HAS_INT64)
-    return value_.uint_ <= maxUInt;
+    return payload().uint_ <= maxUInt;
 #else
     return true;
 #endif
   case realValue:
-    return value_.real_ >= 0 && value_.real_ <= maxUInt &&
-           IsIntegral(value_.real_);
+    return payload().real_ >= 0 && payload().real_ <= maxUInt &&
+           IsIntegral(payload().real_);
   default:
     break;
   }
@@ -1303,13 +2518,13 @@ bool Value::isInt64() const {
   case intValue:
     return true;
   case uintValue:
-    return value_.uint_ <= UInt64(maxInt64);
+    return payload().uint_ <= UInt64(maxInt64);
   case realValue:
     // Note that maxInt64 (= 2^63 - 1) is not exactly representable as a
     // double, so double(maxInt64) will be rounded up to 2^63. Therefore we
     // require the value to be strictly less than the limit.
-    return value_.real_ >= double(minInt64) &&
-           value_.real_ < double(maxInt64) && IsIntegral(value_.real_);
+    return payload().real_ >= double(minInt64) &&
+           payload().real_ < double(maxInt64) && IsIntegral(payload().real_);
   default:
     break;
   }
@@ -1321,15 +2536,15 @@ bool Value::isUInt64() const {
 #if defined(JSON_HAS_INT64)
   switch (type()) {
   case intValue:
-    return value_.int_ >= 0;
+    return payload().int_ >= 0;
   case uintValue:
     return true;
   case realValue:
     // Note that maxUInt64 (= 2^64 - 1) is not exactly representable as a
     // double, so double(maxUInt64) will be rounded up to 2^64. Therefore we
     // require the value to be strictly less than the limit.
-    return value_.real_ >= 0 && value_.real_ < maxUInt64AsDouble &&
-           IsIntegral(value_.real_);
+    return payload().real_ >= 0 && payload().real_ < maxUInt64AsDouble &&
+           IsIntegral(payload().real_);
   default:
     break;
   }
@@ -1347,11 +2562,11 @@ bool Value::isIntegral() const {
     // Note that maxUInt64 (= 2^64 - 1) is not exactly representable as a
     // double, so double(maxUInt64) will be rounded up to 2^64. Therefore we
     // require the value to be strictly less than the limit.
-    return value_.real_ >= double(minInt64) &&
-           value_.real_ < maxUInt64AsDouble && IsIntegral(value_.real_);
+    return payload().real_ >= double(minInt64) &&
+           payload().real_ < maxUInt64AsDouble && IsIntegral(payload().real_);
 #else
-    return value_.real_ >= minInt && value_.real_ <= maxUInt &&
-           IsIntegral(value_.real_);
+    return payload().real_ >= minInt && payload().real_ <= maxUInt &&
+           IsIntegral(payload().real_);
 #endif // JSON_HAS_INT64
   default:
     break;
@@ -1414,24 +2629,38 @@ void Value::setComment(String comment, CommentPlacement placement) {
   JSON_ASSERT_MESSAGE(
       comment[0] == '\0' || comment[0] == '/',
       "in Json::Value::setComment(): Comments must start with /");
-  comments_.set(placement, std::move(comment));
+  demandMeta().comments_.set(placement, std::move(comment));
 }
 
 bool Value::hasComment(CommentPlacement placement) const {
-  return comments_.has(placement);
+  Meta const* meta = findMeta();
+  return meta && meta->comments_.has(placement);
 }
 
 String Value::getComment(CommentPlacement placement) const {
-  return comments_.get(placement);
+  Meta const* meta = findMeta();
+  return meta ? meta->comments_.get(placement) : String();
 }
 
-void Value::setOffsetStart(ptrdiff_t start) { start_ = start; }
+void Value::setOffsetStart(ptrdiff_t start) {
+  if (start != 0 || bits_.hasMeta_)
+    demandMeta().start_ = start;
+}
 
-void Value::setOffsetLimit(ptrdiff_t limit) { limit_ = limit; }
+void Value::setOffsetLimit(ptrdiff_t limit) {
+  if (limit != 0 || bits_.hasMeta_)
+    demandMeta().limit_ = limit;
+}
 
-ptrdiff_t Value::getOffsetStart() const { return start_; }
+ptrdiff_t Value::getOffsetStart() const {
+  Meta const* meta = findMeta();
+  return meta ? meta->start_ : 0;
+}
 
-ptrdiff_t Value::getOffsetLimit() const { return limit_; }
+ptrdiff_t Value::getOffsetLimit() const {
+  Meta const* meta = findMeta();
+  return meta ? meta->limit_ : 0;
+}
 
 String Value::toStyledString() const {
   StreamWriterBuilder builder;
@@ -1444,11 +2673,13 @@ String Value::toStyledString() const {
 }
 
 Value::const_iterator Value::begin() const {
+  materialize();
   switch (type()) {
   case arrayValue:
+    return const_iterator(payload().array_, 0);
   case objectValue:
-    if (value_.map_)
-      return const_iterator(value_.map_->begin());
+    if (payload().map_)
+      return const_iterator(payload().map_->begin());
     break;
   default:
     break;
@@ -1457,11 +2688,13 @@ Value::const_iterator Value::begin() const {
 }
 
 Value::const_iterator Value::end() const {
+  materialize();
   switch (type()) {
   case arrayValue:
+    return const_iterator(payload().array_, size());
   case objectValue:
-    if (value_.map_)
-      return const_iterator(value_.map_->end());
+    if (payload().map_)
+      return const_iterator(payload().map_->end());
     break;
   default:
     break;
@@ -1470,11 +2703,14 @@ Value::const_iterator Value::end() const {
 }
 
 Value::iterator Value::begin() {
+  materialize();
+  unshare();
   switch (type()) {
   case arrayValue:
+    return iterator(payload().array_, 0);
   case objectValue:
-    if (value_.map_)
-      return iterator(value_.map_->begin());
+    if (payload().map_)
+      return iterator(payload().map_->begin());
     break;
   default:
     break;
@@ -1483,11 +2719,14 @@ Value::iterator Value::begin() {
 }
 
 Value::iterator Value::end() {
+  materialize();
+  unshare();
   switch (type()) {
   case arrayValue:
+    return iterator(payload().array_, size());
   case objectValue:
-    if (value_.map_)
-      return iterator(value_.map_->end());
+    if (payload().map_)
+      return iterator(payload().map_->end());
     break;
   default:
     break;
@@ -21,12 +21,34 @@ ValueIteratorBase::ValueIteratorBase(
     const Value::ObjectValues::iterator& current)
     : current_(current), isNull_(false) {}
 
-Value& ValueIteratorBase::deref() { return current_->second; }
-const Value& ValueIteratorBase::deref() const { return current_->second; }
+ValueIteratorBase::ValueIteratorBase(Value::ArrayValues* array,
+                                     ArrayIndex index)
+    : current_(), array_(array), index_(index), isNull_(false) {}
+
+Value& ValueIteratorBase::deref() {
+  if (array_)
+    return (*array_)[index_];
+  return current_->second;
+}
+const Value& ValueIteratorBase::deref() const {
+  if (array_)
+    return (*array_)[index_];
+  return current_->second;
+}
 
-void ValueIteratorBase::increment() { ++current_; }
+void ValueIteratorBase::increment() {
+  if (array_)
+    ++index_;
+  else
+    ++current_;
+}
 
-void ValueIteratorBase::decrement() { --current_; }
+void ValueIteratorBase::decrement() {
+  if (array_)
+    --index_;
+  else
+    --current_;
+}
 
 ValueIteratorBase::difference_type
 ValueIteratorBase::computeDistance(const SelfType& other) const {
@@ -39,6 +61,9 @@ ValueIteratorBase::computeDistance(const SelfType& other) const {
     return 0;
   }
 
+  if (array_)
+    return difference_type(other.index_) - difference_type(index_);
+
   // Usage of std::distance is not portable (does not compile with Sun Studio 12
   // RogueWave STL,
   // which is the one used by default).
@@ -56,25 +81,32 @@ bool ValueIteratorBase::isEqual(const SelfType& other) const {
   if (isNull_) {
     return other.isNull_;
   }
+  if (array_ || other.array_)
+    return array_ == other.array_ && index_ == other.index_;
   return current_ == other.current_;
 }
 
 void ValueIteratorBase::copy(const SelfType& other) {
   current_ = other.current_;
+  array_ = other.array_;
+  index_ = other.index_;
   isNull_ = other.isNull_;
 }
 
 Value ValueIteratorBase::key() const {
-  const Value::CZString czstring = (*current_).first;
-  if (czstring.data()) {
-    if (czstring.isStaticString())
-      return Value(StaticString(czstring.data()));
+  if (array_)
+    return Value(index_);
+  const Value::CZString& czstring = (*current_).first;
+  // Not StaticString(data()) for names that are not duplicated: those
+  // borrowed from the parsed text are not null-terminated.
+  if (czstring.data())
     return Value(czstring.data(), czstring.data() + czstring.length());
-  }
   return Value(czstring.index());
 }
 
 UInt ValueIteratorBase::index() const {
+  if (array_)
+    return index_;
   const Value::CZString czstring = (*current_).first;
   if (!czstring.data())
     return czstring.index();
@@ -91,11 +123,17 @@ String ValueIteratorBase::name() const {
 }
 
 char const* ValueIteratorBase::memberName() const {
+  if (array_)
+    return "";
   const char* cname = (*current_).first.data();
   return cname ? cname : "";
 }
 
 char const* ValueIteratorBase::memberName(char const** end) const {
+  if (array_) {
+    *end = nullptr;
+    return nullptr;
+  }
   const char* cname = (*current_).first.data();
   if (!cname) {
     *end = nullptr;
@@ -119,6 +157,10 @@ ValueConstIterator::ValueConstIterator(
     const Value::ObjectValues::iterator& current)
     : ValueIteratorBase(current) {}
 
+ValueConstIterator::ValueConstIterator(Value::ArrayValues* array,
+                                       ArrayIndex index)
+    : ValueIteratorBase(array, index) {}
+
 ValueConstIterator::ValueConstIterator(ValueIterator const& other)
     : ValueIteratorBase(other) {}
 
@@ -141,6 +183,9 @@ ValueIterator::ValueIterator() = default;
 ValueIterator::ValueIterator(const Value::ObjectValues::iterator& current)
     : ValueIteratorBase(current) {}
 
+ValueIterator::ValueIterator(Value::ArrayValues* array, ArrayIndex index)
+    : ValueIteratorBase(array, index) {}
+
 ValueIterator::ValueIterator(const ValueConstIterator& other)
     : ValueIteratorBase(other) {
   throwRuntimeError("ConstIterator to Iterator should never be allowed.");
@@ -4,6 +4,8 @@
 // See file LICENSE for detail or copy at http://jsoncpp.sourceforge.net/LICENSE
 
 #if !defined(JSON_IS_AMALGAMATION)
+#include "json_double.h"
+#include "json_simd.h"
 #include "json_tool.h"
 #include <json/writer.h>
 #endif // if !defined(JSON_IS_AMALGAMATION)
@@ -91,8 +93,10 @@ using StreamWriterPtr = std::unique_ptr<StreamWriter>;
 using StreamWriterPtr = std::auto_ptr<StreamWriter>;
 #endif
 
-String valueToString(LargestInt value) {
+// Append the decimal text of value to out, without a temporary String.
+static void appendInteger(String& out, LargestInt value) {
   UIntToStringBuffer buffer;
+  char* const end = buffer + sizeof(buffer) - 1; // before the null
   char* current = buffer + sizeof(buffer);
   if (value == Value::minLargestInt) {
     uintToString(LargestUInt(Value::maxLargestInt) + 1, current);
@@ -104,15 +108,28 @@ String valueToString(LargestInt value) {
     uintToString(LargestUInt(value), current);
   }
   assert(current >= buffer);
-  return current;
+  out.append(current, end);
 }
 
-String valueToString(LargestUInt value) {
+static void appendInteger(String& out, LargestUInt value) {
   UIntToStringBuffer buffer;
+  char* const end = buffer + sizeof(buffer) - 1; // before the null
   char* current = buffer + sizeof(buffer);
   uintToString(value, current);
   assert(current >= buffer);
-  return current;
+  out.append(current, end);
+}
+
+String valueToString(LargestInt value) {
+  String result;
+  appendInteger(result, value);
+  return result;
+}
+
+String valueToString(LargestUInt value) {
+  String result;
+  appendInteger(result, value);
+  return result;
 }
 
 #if defined(JSON_HAS_INT64)
@@ -124,49 +141,64 @@ String valueToString(UInt value) { return valueToString(LargestUInt(value)); }
 #endif // # if defined(JSON_HAS_INT64)
 
 namespace {
-String valueToString(double value, bool useSpecialFloats,
-                     unsigned int precision, PrecisionType precisionType) {
+// Append the text of value to out, formatted in place.
+void appendDouble(String& out, double value, bool useSpecialFloats,
+                  unsigned int precision, PrecisionType precisionType) {
   // Print into the buffer. We need not request the alternative representation
   // that always has a decimal point because JSON doesn't distinguish the
   // concepts of reals and integers.
   if (!isfinite(value)) {
     static const char* const reps[2][3] = {{"NaN", "-Infinity", "Infinity"},
                                            {"null", "-1e+9999", "1e+9999"}};
-    return reps[useSpecialFloats ? 0 : 1]
+    out += reps[useSpecialFloats ? 0 : 1]
                [isnan(value) ? 0 : (value < 0) ? 1 : 2];
+    return;
   }
 
-  String buffer(size_t(36), '\0');
+  if (precisionType == PrecisionType::shortestRoundTrip) {
+    char buffer[32];
+    out.append(buffer, formatShortestDouble(value, buffer));
+    return;
+  }
+
+  const size_t start = out.size();
+  out.resize(start + 36);
   while (true) {
     int len = jsoncpp_snprintf(
-        &*buffer.begin(), buffer.size(),
+        &out[start], out.size() - start,
         (precisionType == PrecisionType::significantDigits) ? "%.*g" : "%.*f",
         precision, value);
     assert(len >= 0);
     auto wouldPrint = static_cast<size_t>(len);
-    if (wouldPrint >= buffer.size()) {
-      buffer.resize(wouldPrint + 1);
+    if (wouldPrint >= out.size() - start) {
+      out.resize(start + wouldPrint + 1);
       continue;
     }
-    buffer.resize(wouldPrint);
+    out.resize(start + wouldPrint);
     break;
   }
 
-  buffer.erase(fixNumericLocale(buffer.begin(), buffer.end()), buffer.end());
+  fixNumericLocale(out.begin() + static_cast<ptrdiff_t>(start), out.end());
 
   // try to ensure we preserve the fact that this was given to us as a double on
   // input
-  if (buffer.find('.') == buffer.npos && buffer.find('e') == buffer.npos) {
-    buffer += ".0";
+  if (out.find('.', start) == out.npos && out.find('e', start) == out.npos) {
+    out += ".0";
   }
 
   // strip the zero padding from the right
   if (precisionType == PrecisionType::decimalPlaces) {
-    buffer.erase(fixZerosInTheEnd(buffer.begin(), buffer.end(), precision),
-                 buffer.end());
+    out.erase(fixZerosInTheEnd(out.begin() + static_cast<ptrdiff_t>(start),
+                               out.end(), precision),
+              out.end());
   }
+}
 
-  return buffer;
+String valueToString(double value, bool useSpecialFloats,
+                     unsigned int precision, PrecisionType precisionType) {
+  String result;
+  appendDouble(result, value, useSpecialFloats, precision, precisionType);
+  return result;
 }
 } // namespace
 
@@ -177,14 +209,6 @@ String valueToString(double value, unsigned int precision,
 
 String valueToString(bool value) { return value ? "true" : "false"; }
 
-static bool doesAnyCharRequireEscaping(char const* s, size_t n) {
-  assert(s || !n);
-
-  return std::any_of(s, s + n, [](unsigned char c) {
-    return c == '\\' || c == '"' || c < 0x20 || c > 0x7F;
-  });
-}
-
 static unsigned int utf8ToCodepoint(const char*& s, const char* e) {
   const unsigned int REPLACEMENT_CHARACTER = 0xFFFD;
 
@@ -253,41 +277,32 @@ static const char hex2[] = "000102030405060708090a0b0c0d0e0f"
                            "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
                            "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
 
-static String toHex16Bit(unsigned int x) {
-  const unsigned int hi = (x >> 8) & 0xff;
-  const unsigned int lo = x & 0xff;
-  String result(4, ' ');
-  result[0] = hex2[2 * hi];
-  result[1] = hex2[2 * hi + 1];
-  result[2] = hex2[2 * lo];
-  result[3] = hex2[2 * lo + 1];
-  return result;
-}
-
 static void appendRaw(String& result, unsigned ch) {
   result += static_cast<char>(ch);
 }
 
 static void appendHex(String& result, unsigned ch) {
-  result.append("\\u").append(toHex16Bit(ch));
+  const unsigned int hi = (ch >> 8) & 0xff;
+  const unsigned int lo = ch & 0xff;
+  char escape[6] = {'\\', 'u'};
+  memcpy(escape + 2, hex2 + 2 * hi, 2);
+  memcpy(escape + 4, hex2 + 2 * lo, 2);
+  result.append(escape, sizeof(escape));
 }
 
-static String valueToQuotedStringN(const char* value, size_t length,
-                                   bool emitUTF8 = false) {
-  if (value == nullptr)
-    return "";
-
-  if (!doesAnyCharRequireEscaping(value, length))
-    return String("\"") + value + "\"";
-  // We have to walk value and escape any special characters.
-  // Appending to String is not efficient, but this should be rare.
+// Append value to result between double quotes, escaped as needed.
+static void appendQuotedString(String& result, const char* value,
+                               size_t length, bool emitUTF8) {
+  char const* end = value + length;
+  // Runs of chars which need no escaping are copied at once.
   // (Note: forward slashes are *not* rare, but I am not escaping them.)
-  String::size_type maxsize = length * 2 + 3; // allescaped+quotes+NULL
-  String result;
-  result.reserve(maxsize); // to avoid lots of mallocs
+  char const* run = findCharToEscape(value, end, !emitUTF8);
   result += "\"";
-  char const* end = value + length;
   for (const char* c = value; c != end; ++c) {
+    result.append(c, run);
+    if (run == end)
+      break;
+    c = run;
     switch (*c) {
     case '\"':
       result += "\\\"";
@@ -344,8 +359,18 @@ static String valueToQuotedStringN(const char* value, size_t length,
       }
     } break;
     }
+    run = findCharToEscape(c + 1, end, !emitUTF8);
   }
   result += "\"";
+}
+
+static String valueToQuotedStringN(const char* value, size_t length,
+                                   bool emitUTF8 = false) {
+  if (value == nullptr)
+    return "";
+  String result;
+  result.reserve(length + 2);
+  appendQuotedString(result, value, length, emitUTF8);
   return result;
 }
 
@@ -370,6 +395,10 @@ void FastWriter::dropNullPlaceholders() { dropNullPlaceholders_ = true; }
 
 void FastWriter::omitEndingLineFeed() { omitEndingLineFeed_ = true; }
 
+void FastWriter::useShortestRoundTripReals() {
+  precisionType_ = PrecisionType::shortestRoundTrip;
+}
+
 String FastWriter::write(const Value& root) {
   document_.clear();
   writeValue(root);
@@ -391,7 +420,8 @@ void FastWriter::writeValue(const Value& value) {
     document_ += valueToString(value.asLargestUInt());
     break;
   case realValue:
-    document_ += valueToString(value.asDouble());
+    document_ += valueToString(value.asDouble(), Value::defaultRealPrecision,
+                               precisionType_);
     break;
   case stringValue: {
     // Is NULL possible for value.string_? No.
@@ -436,6 +466,10 @@ void FastWriter::writeValue(const Value& value) {
 
 StyledWriter::StyledWriter() = default;
 
+void StyledWriter::useShortestRoundTripReals() {
+  precisionType_ = PrecisionType::shortestRoundTrip;
+}
+
 String StyledWriter::write(const Value& root) {
   document_.clear();
   addChildValues_ = false;
@@ -459,7 +493,8 @@ void StyledWriter::writeValue(const Value& value) {
     pushValue(valueToString(value.asLargestUInt()));
     break;
   case realValue:
-    pushValue(valueToString(value.asDouble()));
+    pushValue(valueToString(value.asDouble(), Value::defaultRealPrecision,
+                            precisionType_));
     break;
   case stringValue: {
     // Is NULL possible for value.string_? No.
@@ -882,24 +917,38 @@ struct BuiltStyledStreamWriter : public StreamWriter {
                           bool emitUTF8, unsigned int precision,
                           PrecisionType precisionType);
   int write(Value const& root, OStream* sout) override;
+  int append(Value const& root, String* document) override;
 
 private:
+  // When writing to a stream, buffer_ is passed on once it holds this much.
+  static constexpr size_t flushSize = 64 * 1024;
+
+  void writeDocument(Value const& root);
   void writeValue(Value const& value);
   void writeArrayValue(Value const& value);
   bool isMultilineArray(Value const& value);
+  static Value const& element(Value const& array, ArrayIndex index,
+                              Value& scratch);
+  String& valueTarget();
   void pushValue(String const& value);
   void writeIndent();
   void writeWithIndent(String const& value);
+  void writeNameWithIndent(char const* name, char const* end);
   void indent();
   void unindent();
   void writeCommentBeforeValue(Value const& root);
   void writeCommentAfterValueOnSameLine(Value const& root);
+  void flushIfFull();
   static bool hasCommentForValue(const Value& value);
 
   using ChildValues = std::vector<String>;
 
   ChildValues childValues_;
   String indentString_;
+  // The text is formatted at the end of *out_: the caller's document, or
+  // buffer_ on its way to sout_.
+  String* out_ = nullptr;
+  String buffer_;
   unsigned int rightMargin_;
   String indentation_;
   CommentStyle::Enum cs_;
@@ -925,6 +974,22 @@ BuiltStyledStreamWriter::BuiltStyledStreamWriter(
       precision_(precision), precisionType_(precisionType) {}
 int BuiltStyledStreamWriter::write(Value const& root, OStream* sout) {
   sout_ = sout;
+  buffer_.clear();
+  out_ = &buffer_;
+  writeDocument(root);
+  sout_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+  buffer_.clear();
+  out_ = nullptr;
+  sout_ = nullptr;
+  return 0;
+}
+int BuiltStyledStreamWriter::append(Value const& root, String* document) {
+  out_ = document;
+  writeDocument(root);
+  out_ = nullptr;
+  return 0;
+}
+void BuiltStyledStreamWriter::writeDocument(Value const& root) {
   addChildValues_ = false;
   indented_ = true;
   indentString_.clear();
@@ -934,9 +999,7 @@ int BuiltStyledStreamWriter::write(Value const& root, OStream* sout) {
   indented_ = true;
   writeValue(root);
   writeCommentAfterValueOnSameLine(root);
-  *sout_ << endingLineFeedSymbol_;
-  sout_ = nullptr;
-  return 0;
+  *out_ += endingLineFeedSymbol_;
 }
 void BuiltStyledStreamWriter::writeValue(Value const& value) {
   switch (value.type()) {
@@ -944,14 +1007,14 @@ void BuiltStyledStreamWriter::writeValue(Value const& value) {
     pushValue(nullSymbol_);
     break;
   case intValue:
-    pushValue(valueToString(value.asLargestInt()));
+    appendInteger(valueTarget(), value.asLargestInt());
     break;
   case uintValue:
-    pushValue(valueToString(value.asLargestUInt()));
+    appendInteger(valueTarget(), value.asLargestUInt());
     break;
   case realValue:
-    pushValue(valueToString(value.asDouble(), useSpecialFloats_, precision_,
-                            precisionType_));
+    appendDouble(valueTarget(), value.asDouble(), useSpecialFloats_,
+                 precision_, precisionType_);
     break;
   case stringValue: {
     // Is NULL is possible for value.string_? No.
@@ -959,40 +1022,42 @@ void BuiltStyledStreamWriter::writeValue(Value const& value) {
     char const* end;
     bool ok = value.getString(&str, &end);
     if (ok)
-      pushValue(
-          valueToQuotedStringN(str, static_cast<size_t>(end - str), emitUTF8_));
+      appendQuotedString(valueTarget(), str, static_cast<size_t>(end - str),
+                         emitUTF8_);
     else
       pushValue("");
     break;
   }
   case booleanValue:
-    pushValue(valueToString(value.asBool()));
+    pushValue(value.asBool() ? "true" : "false");
     break;
   case arrayValue:
     writeArrayValue(value);
     break;
   case objectValue: {
-    Value::Members members(value.getMemberNames());
-    if (members.empty())
+    if (value.empty())
       pushValue("{}");
     else {
       writeWithIndent("{");
       indent();
-      auto it = members.begin();
+      // Members are visited in the order of getMemberNames(), without
+      // copying their names.
+      auto it = value.begin();
       for (;;) {
-        String const& name = *it;
-        Value const& childValue = value[name];
+        char const* nameEnd;
+        char const* name = it.memberName(&nameEnd);
+        Value const& childValue = *it;
         writeCommentBeforeValue(childValue);
-        writeWithIndent(
-            valueToQuotedStringN(name.data(), name.length(), emitUTF8_));
-        *sout_ << colonSymbol_;
+        writeNameWithIndent(name, nameEnd);
+        *out_ += colonSymbol_;
         writeValue(childValue);
-        if (++it == members.end()) {
+        if (++it == value.end()) {
           writeCommentAfterValueOnSameLine(childValue);
           break;
         }
-        *sout_ << ",";
+        *out_ += ',';
         writeCommentAfterValueOnSameLine(childValue);
+        flushIfFull();
       }
       unindent();
       writeWithIndent("}");
@@ -1012,8 +1077,9 @@ void BuiltStyledStreamWriter::writeArrayValue(Value const& value) {
       indent();
       bool hasChildValue = !childValues_.empty();
       unsigned index = 0;
+      Value scratch;
       for (;;) {
-        Value const& childValue = value[index];
+        Value const& childValue = element(value, index, scratch);
         writeCommentBeforeValue(childValue);
         if (hasChildValue)
           writeWithIndent(childValues_[index]);
@@ -1028,25 +1094,26 @@ void BuiltStyledStreamWriter::writeArrayValue(Value const& value) {
           writeCommentAfterValueOnSameLine(childValue);
           break;
         }
-        *sout_ << ",";
+        *out_ += ',';
         writeCommentAfterValueOnSameLine(childValue);
+        flushIfFull();
       }
       unindent();
       writeWithIndent("]");
     } else // output on a single line
     {
       assert(childValues_.size() == size);
-      *sout_ << "[";
+      *out_ += '[';
       if (!indentation_.empty())
-        *sout_ << " ";
+        *out_ += ' ';
       for (unsigned index = 0; index < size; ++index) {
         if (index > 0)
-          *sout_ << ((!indentation_.empty()) ? ", " : ",");
-        *sout_ << childValues_[index];
+          *out_ += (!indentation_.empty()) ? ", " : ",";
+        *out_ += childValues_[index];
       }
       if (!indentation_.empty())
-        *sout_ << " ";
-      *sout_ << "]";
+        *out_ += ' ';
+      *out_ += ']';
     }
   }
 }
@@ -1055,8 +1122,9 @@ bool BuiltStyledStreamWriter::isMultilineArray(Value const& value) {
   ArrayIndex const size = value.size();
   bool isMultiLine = size * 3 >= rightMargin_;
   childValues_.clear();
+  Value scratch;
   for (ArrayIndex index = 0; index < size && !isMultiLine; ++index) {
-    Value const& childValue = value[index];
+    Value const& childValue = element(value, index, scratch);
     isMultiLine = ((childValue.isArray() || childValue.isObject()) &&
                    !childValue.empty());
   }
@@ -1066,10 +1134,11 @@ bool BuiltStyledStreamWriter::isMultilineArray(Value const& value) {
     addChildValues_ = true;
     ArrayIndex lineLength = 4 + (size - 1) * 2; // '[ ' + ', '*n + ' ]'
     for (ArrayIndex index = 0; index < size; ++index) {
-      if (hasCommentForValue(value[index])) {
+      Value const& childValue = element(value, index, scratch);
+      if (hasCommentForValue(childValue)) {
         isMultiLine = true;
       }
-      writeValue(value[index]);
+      writeValue(childValue);
       lineLength += static_cast<ArrayIndex>(childValues_[index].length());
     }
     addChildValues_ = false;
@@ -1078,11 +1147,17 @@ bool BuiltStyledStreamWriter::isMultilineArray(Value const& value) {
   return isMultiLine;
 }
 
+// Where to format the next scalar: a new child value while measuring an
+// array, or else the document.
+String& BuiltStyledStreamWriter::valueTarget() {
+  if (!addChildValues_)
+    return *out_;
+  childValues_.emplace_back();
+  return childValues_.back();
+}
+
 void BuiltStyledStreamWriter::pushValue(String const& value) {
-  if (addChildValues_)
-    childValues_.push_back(value);
-  else
-    *sout_ << value;
+  valueTarget() += value;
 }
 
 void BuiltStyledStreamWriter::writeIndent() {
@@ -1093,14 +1168,23 @@ void BuiltStyledStreamWriter::writeIndent() {
 
   if (!indentation_.empty()) {
     // In this case, drop newlines too.
-    *sout_ << '\n' << indentString_;
+    *out_ += '\n';
+    *out_ += indentString_;
   }
 }
 
 void BuiltStyledStreamWriter::writeWithIndent(String const& value) {
   if (!indented_)
     writeIndent();
-  *sout_ << value;
+  *out_ += value;
+  indented_ = false;
+}
+
+void BuiltStyledStreamWriter::writeNameWithIndent(char const* name,
+                                                  char const* end) {
+  if (!indented_)
+    writeIndent();
+  appendQuotedString(*out_, name, static_cast<size_t>(end - name), emitUTF8_);
   indented_ = false;
 }
 
@@ -1122,10 +1206,10 @@ void BuiltStyledStreamWriter::writeCommentBeforeValue(Value const& root) {
   const String& comment = root.getComment(commentBefore);
   String::const_iterator iter = comment.begin();
   while (iter != comment.end()) {
-    *sout_ << *iter;
+    *out_ += *iter;
     if (*iter == '\n' && ((iter + 1) != comment.end() && *(iter + 1) == '/'))
       // writeIndent();  // would write extra newline
-      *sout_ << indentString_;
+      *out_ += indentString_;
     ++iter;
   }
   indented_ = false;
@@ -1135,15 +1219,45 @@ void BuiltStyledStreamWriter::writeCommentAfterValueOnSameLine(
     Value const& root) {
   if (cs_ == CommentStyle::None)
     return;
-  if (root.hasComment(commentAfterOnSameLine))
-    *sout_ << " " + root.getComment(commentAfterOnSameLine);
+  if (root.hasComment(commentAfterOnSameLine)) {
+    *out_ += ' ';
+    *out_ += root.getComment(commentAfterOnSameLine);
+  }
 
   if (root.hasComment(commentAfter)) {
     writeIndent();
-    *sout_ << root.getComment(commentAfter);
+    *out_ += root.getComment(commentAfter);
   }
 }
 
+// Pass what is buffered on to the stream, between members and elements.
+void BuiltStyledStreamWriter::flushIfFull() {
+  if (sout_ && buffer_.size() >= flushSize) {
+    sout_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+  }
+}
+
+// The element at index of array, or for a packed array (see
+// Value::packNumbers()) a copy of it in scratch, so that writing the array
+// leaves it packed.
+// static
+Value const& BuiltStyledStreamWriter::element(Value const& array,
+                                              ArrayIndex index,
+                                              Value& scratch) {
+  double const* reals;
+  double const* realsEnd;
+  LargestInt const* ints;
+  LargestInt const* intsEnd;
+  if (array.getReals(&reals, &realsEnd))
+    scratch = reals[index];
+  else if (array.getLargestInts(&ints, &intsEnd))
+    scratch = ints[index];
+  else
+    return array[index];
+  return scratch;
+}
+
 // static
 bool BuiltStyledStreamWriter::hasCommentForValue(const Value& value) {
   return value.hasComment(commentBefore) ||
@@ -1156,50 +1270,70 @@ bool BuiltStyledStreamWriter::hasCommentForValue(const Value& value) {
 
 StreamWriter::StreamWriter() : sout_(nullptr) {}
 StreamWriter::~StreamWriter() = default;
+int StreamWriter::append(Value const& root, String* document) {
+  OStringStream sout;
+  const int result = write(root, &sout);
+  *document += sout.str();
+  return result;
+}
 StreamWriter::Factory::~Factory() = default;
 StreamWriterBuilder::StreamWriterBuilder() { setDefaults(&settings_); }
 StreamWriterBuilder::~StreamWriterBuilder() = default;
+static StreamWriter* newBuiltStreamWriter(String indentation,
+                                          StreamWriterOptions const& options) {
+  const CommentStyle::Enum cs =
+      options.writeComments ? CommentStyle::All : CommentStyle::None;
+  String colonSymbol = " : ";
+  if (options.enableYAMLCompatibility) {
+    colonSymbol = ": ";
+  } else if (indentation.empty()) {
+    colonSymbol = ":";
+  }
+  String nullSymbol = "null";
+  if (options.dropNullPlaceholders) {
+    nullSymbol.clear();
+  }
+  const unsigned int pre = std::min(options.precision, 17U);
+  String endingLineFeedSymbol;
+  return new BuiltStyledStreamWriter(
+      std::move(indentation), cs, colonSymbol, nullSymbol,
+      endingLineFeedSymbol, options.useSpecialFloats, options.emitUTF8, pre,
+      options.precisionType);
+}
+
+StreamWriter* newStreamWriter(StreamWriterOptions const& options) {
+  return newBuiltStreamWriter(options.indentation, options);
+}
+
 StreamWriter* StreamWriterBuilder::newStreamWriter() const {
-  const String indentation = settings_["indentation"].asString();
   const String cs_str = settings_["commentStyle"].asString();
   const String pt_str = settings_["precisionType"].asString();
-  const bool eyc = settings_["enableYAMLCompatibility"].asBool();
-  const bool dnp = settings_["dropNullPlaceholders"].asBool();
-  const bool usf = settings_["useSpecialFloats"].asBool();
-  const bool emitUTF8 = settings_["emitUTF8"].asBool();
-  unsigned int pre = settings_["precision"].asUInt();
-  CommentStyle::Enum cs = CommentStyle::All;
+  StreamWriterOptions options;
   if (cs_str == "All") {
-    cs = CommentStyle::All;
+    options.writeComments = true;
   } else if (cs_str == "None") {
-    cs = CommentStyle::None;
+    options.writeComments = false;
   } else {
     throwRuntimeError("commentStyle must be 'All' or 'None'");
   }
-  PrecisionType precisionType(significantDigits);
   if (pt_str == "significant") {
-    precisionType = PrecisionType::significantDigits;
+    options.precisionType = PrecisionType::significantDigits;
   } else if (pt_str == "decimal") {
-    precisionType = PrecisionType::decimalPlaces;
+    options.precisionType = PrecisionType::decimalPlaces;
+  } else if (pt_str == "shortest") {
+    options.precisionType = PrecisionType::shortestRoundTrip;
   } else {
-    throwRuntimeError("precisionType must be 'significant' or 'decimal'");
+    throwRuntimeError(
+        "precisionType must be 'significant', 'decimal' or 'shortest'");
   }
-  String colonSymbol = " : ";
-  if (eyc) {
-    colonSymbol = ": ";
-  } else if (indentation.empty()) {
-    colonSymbol = ":";
-  }
-  String nullSymbol = "null";
-  if (dnp) {
-    nullSymbol.clear();
-  }
-  if (pre > 17)
-    pre = 17;
-  String endingLineFeedSymbol;
-  return new BuiltStyledStreamWriter(indentation, cs, colonSymbol, nullSymbol,
-                                     endingLineFeedSymbol, usf, emitUTF8, pre,
-                                     precisionType);
+  options.enableYAMLCompatibility =
+      settings_["enableYAMLCompatibility"].asBool();
+  options.dropNullPlaceholders = settings_["dropNullPlaceholders"].asBool();
+  options.useSpecialFloats = settings_["useSpecialFloats"].asBool();
+  options.emitUTF8 = settings_["emitUTF8"].asBool();
+  options.precision = settings_["precision"].asUInt();
+  // The indentation may hold any char, including '\0'.
+  return newBuiltStreamWriter(settings_["indentation"].asString(), options);
 }
 
 bool StreamWriterBuilder::validate(Json::Value* invalid) const {
@@ -1243,10 +1377,23 @@ void StreamWriterBuilder::setDefaults(Json::Value* settings) {
 }
 
 String writeString(StreamWriter::Factory const& factory, Value const& root) {
-  OStringStream sout;
+  String document;
   StreamWriterPtr const writer(factory.newStreamWriter());
-  writer->write(root, &sout);
-  return sout.str();
+  writer->append(root, &document);
+  return document;
+}
+
+StreamWriter& threadLocalStreamWriter(StreamWriterBuilder const& builder) {
+  struct Cache {
+    Value settings;
+    StreamWriterPtr writer;
+  };
+  static thread_local Cache cache;
+  if (!cache.writer || cache.settings != builder.settings_) {
+    cache.writer.reset(builder.newStreamWriter());
+    cache.settings = builder.settings_;
+  }
+  return *cache.writer;
 }
 
 OStream& operator<<(OStream& sout, Value const& root) {
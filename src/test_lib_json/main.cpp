@@ -12,9 +12,12 @@
 
 #include "fuzz.h"
 #include "jsontest.h"
+#include <JsonSerializer.h>
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
+#include <fstream>
 #include <functional>
 #include <iomanip>
 #include <iostream>
@@ -25,8 +28,14 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#endif
+
 using CharReaderPtr = std::unique_ptr<Json::CharReader>;
 
 // Make numeric limits more convenient to talk about.
@@ -360,6 +369,374 @@ JSONTEST_FIXTURE_LOCAL(ValueTest, resizePopulatesAllMissingElements) {
     JSONTEST_ASSERT_EQUAL(e, Json::Value{});
 }
 
+JSONTEST_FIXTURE_LOCAL(ValueTest, hashedMembers) {
+  Json::Value object(Json::objectValue, true);
+  JSONTEST_ASSERT(object.hasHashedMembers());
+  JSONTEST_ASSERT(!Json::Value(Json::objectValue).hasHashedMembers());
+  JSONTEST_ASSERT(!Json::Value(Json::arrayValue, true).hasHashedMembers());
+
+  const int count = 200;
+  for (int i = 0; i < count; ++i)
+    object["key" + std::to_string(i)] = i;
+  JSONTEST_ASSERT_EQUAL(count, object.size());
+  for (int i = 0; i < count; ++i) {
+    const Json::String key = "key" + std::to_string(i);
+    const Json::Value* found =
+        object.find(key.data(), key.data() + key.size());
+    JSONTEST_ASSERT(found != nullptr);
+    JSONTEST_ASSERT_EQUAL(i, found->asInt());
+  }
+  JSONTEST_ASSERT(!object.isMember("key200"));
+
+  // Iteration order and member names are those of a plain object.
+  Json::Value plain(Json::objectValue);
+  for (int i = count - 1; i >= 0; --i)
+    plain["key" + std::to_string(i)] = i;
+  JSONTEST_ASSERT(object.getMemberNames() == plain.getMemberNames());
+  JSONTEST_ASSERT_EQUAL(plain, object);
+  JSONTEST_ASSERT_EQUAL(plain.begin().name(), object.begin().name());
+
+  Json::Value copy(object);
+  JSONTEST_ASSERT(copy.hasHashedMembers());
+  for (int i = 0; i < count; i += 2)
+    copy.removeMember("key" + std::to_string(i));
+  Json::Value removed;
+  JSONTEST_ASSERT(copy.removeMember("key1", &removed));
+  JSONTEST_ASSERT_EQUAL(1, removed.asInt());
+  JSONTEST_ASSERT(!copy.removeMember("key1", &removed));
+  JSONTEST_ASSERT_EQUAL(count / 2 - 1, copy.size());
+  for (int i = 2; i < count; ++i)
+    JSONTEST_ASSERT_EQUAL(i % 2 == 1,
+                          copy.isMember("key" + std::to_string(i)));
+  JSONTEST_ASSERT_EQUAL(count, object.size());
+
+  copy.clear();
+  JSONTEST_ASSERT(copy.hasHashedMembers());
+  JSONTEST_ASSERT(!copy.isMember("key3"));
+  copy["again"] = true;
+  JSONTEST_ASSERT_EQUAL(true, copy["again"].asBool());
+}
+
+JSONTEST_FIXTURE_LOCAL(ValueTest, borrowedStrings) {
+  const char text[] = "borrowed\0text";
+  const char* const end = text + sizeof(text) - 1;
+  Json::Value borrowed(text, end, true);
+  char const* begin = nullptr;
+  char const* stop = nullptr;
+  JSONTEST_ASSERT(borrowed.getString(&begin, &stop));
+  JSONTEST_ASSERT(begin == text);
+  JSONTEST_ASSERT(stop == end);
+  JSONTEST_ASSERT_STRING_EQUAL(Json::String(text, end), borrowed.asString());
+  JSONTEST_ASSERT_THROWS(borrowed.asCString());
+
+  Json::Value copy(borrowed);
+  JSONTEST_ASSERT_EQUAL(Json::Value(text, end), copy);
+  JSONTEST_ASSERT(copy.getString(&begin, &stop));
+  JSONTEST_ASSERT(begin == text);
+
+  Json::Value owned(text, end, false);
+  JSONTEST_ASSERT(owned.getString(&begin, &stop));
+  JSONTEST_ASSERT(begin != text);
+  JSONTEST_ASSERT_EQUAL(borrowed, owned);
+
+  Json::Value object(Json::objectValue);
+  *object.demand(text, text + 8, true) = 1;
+  *object.demand(text, text + 8, false) = 2;
+  JSONTEST_ASSERT_EQUAL(1, object.size());
+  JSONTEST_ASSERT(object.begin().memberName(&stop) == text);
+  JSONTEST_ASSERT_EQUAL(2, object["borrowed"].asInt());
+}
+
+JSONTEST_FIXTURE_LOCAL(ValueTest, shortStrings) {
+  auto isInline = [](const Json::Value& value) {
+    char const* begin = nullptr;
+    char const* end = nullptr;
+    value.getString(&begin, &end);
+    auto self = reinterpret_cast<char const*>(&value);
+    return begin >= self && end < self + sizeof(value);
+  };
+  const char text[] = "ok\0k";
+  Json::Value embedded(text, text + 4);
+  JSONTEST_ASSERT(isInline(embedded));
+  JSONTEST_ASSERT_EQUAL(4, embedded.asString().size());
+  JSONTEST_ASSERT_STRING_EQUAL("ok", embedded.asCString());
+  JSONTEST_ASSERT(isInline(Json::Value("")));
+  JSONTEST_ASSERT(isInline(Json::Value("1234567")));
+  JSONTEST_ASSERT(!isInline(Json::Value("12345678")));
+  JSONTEST_ASSERT(!isInline(Json::Value(Json::StaticString("GET"))));
+  JSONTEST_ASSERT(!isInline(Json::Value(text, text + 2, true)));
+
+  Json::Value get("GET");
+  Json::Value copy(get);
+  JSONTEST_ASSERT(isInline(copy));
+  JSONTEST_ASSERT_EQUAL(get, copy);
+  JSONTEST_ASSERT(Json::Value("GET") < Json::Value("GET /path"));
+  JSONTEST_ASSERT(Json::Value("GET /path") > get);
+  JSONTEST_ASSERT_EQUAL(0, get.compare(Json::Value("GET", "GET" + 3, true)));
+  Json::Value post("POST /longer/path");
+  get.swap(post);
+  JSONTEST_ASSERT_STRING_EQUAL("POST /longer/path", get.asString());
+  JSONTEST_ASSERT_STRING_EQUAL("GET", post.asCString());
+
+  Json::Value object;
+  object["id"] = 1;
+  object["a much longer member name"] = 2;
+  object[Json::String("i\0d", 3)] = 3;
+  Json::Value copied(object);
+  JSONTEST_ASSERT_EQUAL(object, copied);
+  JSONTEST_ASSERT_EQUAL(1, copied["id"].asInt());
+  JSONTEST_ASSERT_EQUAL(3, copied[Json::String("i\0d", 3)].asInt());
+  Json::Value::Members names = copied.getMemberNames();
+  JSONTEST_ASSERT_EQUAL(3, names.size());
+  JSONTEST_ASSERT_STRING_EQUAL("a much longer member name", names[0]);
+  JSONTEST_ASSERT_STRING_EQUAL("id", names[2]);
+  copied.removeMember("id");
+  JSONTEST_ASSERT(!copied.isMember("id"));
+  JSONTEST_ASSERT(copied.isMember("a much longer member name"));
+}
+
+JSONTEST_FIXTURE_LOCAL(ValueTest, namePool) {
+  auto firstName = [](const Json::Value& object) {
+    char const* end = nullptr;
+    return object.begin().memberName(&end);
+  };
+  const Json::String key = "a shared member name";
+  const char* const keyEnd = key.data() + key.size();
+  Json::Value records(Json::arrayValue);
+  {
+    Json::NamePool pool;
+    for (int i = 0; i < 3; ++i)
+      *records.append(Json::objectValue).demand(key.data(), keyEnd, pool) = i;
+    records[0].demand(key.data(), keyEnd, pool);
+    const char shortKey[] = "short";
+    records[0].demand(shortKey, shortKey + 5, pool);
+    JSONTEST_ASSERT_EQUAL(1, pool.size());
+    JSONTEST_ASSERT_EQUAL(2, records[0].size());
+    JSONTEST_ASSERT(firstName(records[0]) == firstName(records[2]));
+    JSONTEST_ASSERT(firstName(records[0]) != key.data());
+
+    Json::NamePool tiny(0);
+    Json::Value other;
+    *other.demand(key.data(), keyEnd, tiny) = 0;
+    JSONTEST_ASSERT_EQUAL(0, tiny.size());
+    JSONTEST_ASSERT(firstName(other) != firstName(records[0]));
+    JSONTEST_ASSERT_EQUAL(records[0][key], other[key]);
+    pool.clear();
+    JSONTEST_ASSERT_EQUAL(0, pool.size());
+  }
+  // The names outlive the pool, and copies share them.
+  Json::Value copy(records[1]);
+  JSONTEST_ASSERT(firstName(copy) == firstName(records[1]));
+  records.clear();
+  JSONTEST_ASSERT_EQUAL(1, copy[key].asInt());
+  JSONTEST_ASSERT_STRING_EQUAL(key, copy.getMemberNames()[0]);
+  Json::Value moved(std::move(copy));
+  JSONTEST_ASSERT(moved.isMember(key));
+}
+
+JSONTEST_FIXTURE_LOCAL(ValueTest, arenaValues) {
+  Json::Value copy;
+  {
+    Json::Arena arena(256);
+    JSONTEST_ASSERT_EQUAL(0, arena.capacity());
+    void* small = arena.allocate(3, 1);
+    void* aligned = arena.allocate(8, 8);
+    JSONTEST_ASSERT_EQUAL(0, reinterpret_cast<uintptr_t>(aligned) % 8);
+    JSONTEST_ASSERT(static_cast<char*>(aligned) > static_cast<char*>(small));
+    size_t const capacity = arena.capacity();
+    JSONTEST_ASSERT(capacity >= 256);
+    arena.allocate(1000, 1);
+    JSONTEST_ASSERT(arena.capacity() > capacity + 1000);
+    void* next = arena.allocate(8, 8);
+    JSONTEST_ASSERT_EQUAL(static_cast<char*>(aligned) + 8,
+                          static_cast<char*>(next));
+
+    {
+      Json::Value object(Json::objectValue, arena);
+      Json::Value array(Json::arrayValue, arena);
+      for (int i = 0; i < 100; ++i)
+        array.append(Json::Value(i));
+      array[3] = Json::Value("in the arena", "in the arena" + 12, arena);
+      array[4] = "on the heap";
+      Json::String const name = "a member name long enough to be allocated";
+      object[name] = std::move(array);
+      object["other"] = Json::Value("x\0y", "x\0y" + 3, arena);
+      JSONTEST_ASSERT_EQUAL(3, object["other"].asString().size());
+      object.removeMember("other");
+      JSONTEST_ASSERT_EQUAL(1, object.size());
+      JSONTEST_ASSERT_EQUAL(100, object[name].size());
+      JSONTEST_ASSERT_STRING_EQUAL("in the arena", object[name][3].asString());
+      JSONTEST_ASSERT_EQUAL(99, object[name][99].asInt());
+      copy = object;
+      JSONTEST_ASSERT_EQUAL(object, copy);
+    }
+    arena.release();
+    JSONTEST_ASSERT_EQUAL(0, arena.capacity());
+    Json::Value reused(Json::objectValue, arena);
+    reused["k"] = Json::Value("v", "v" + 1, arena);
+    JSONTEST_ASSERT(arena.capacity() > 0);
+
+    // Scalars take nothing from the arena, and start out as Value(type) does.
+    for (Json::ValueType type :
+         {Json::nullValue, Json::intValue, Json::uintValue, Json::realValue,
+          Json::stringValue, Json::booleanValue}) {
+      Json::Value scalar(type, arena);
+      JSONTEST_ASSERT_EQUAL(type, scalar.type());
+      JSONTEST_ASSERT_EQUAL(Json::Value(type), scalar);
+    }
+  }
+  Json::String const name = "a member name long enough to be allocated";
+  JSONTEST_ASSERT_EQUAL(1, copy.size());
+  JSONTEST_ASSERT_STRING_EQUAL("in the arena", copy[name][3].asString());
+  JSONTEST_ASSERT_STRING_EQUAL("on the heap", copy[name][4].asString());
+  copy[name].resize(1000);
+  JSONTEST_ASSERT_EQUAL(0, copy[name][0].asInt());
+}
+
+JSONTEST_FIXTURE_LOCAL(ValueTest, sharedPayloads) {
+  const Json::String text = "a string long enough to be allocated";
+  Json::Value root(Json::objectValue);
+  root["list"].append(1);
+  root["list"].append(text);
+  root["inner"]["name"] = text;
+  root.share();
+  root.share();
+
+  // Copies share the strings, arrays and objects.
+  Json::Value copy(root);
+  const Json::Value& constRoot = root;
+  const Json::Value& constCopy = copy;
+  JSONTEST_ASSERT(copy == root);
+  JSONTEST_ASSERT(&constCopy["list"][0] == &constRoot["list"][0]);
+  Json::Value name(constRoot["inner"]["name"]);
+  JSONTEST_ASSERT(name.asCString() == constRoot["inner"]["name"].asCString());
+
+  // A change goes to the copy alone, and still shares what it does not touch.
+  Json::Value const& before = root["list"];
+  copy["list"][0] = 2;
+  JSONTEST_ASSERT(constCopy["list"][1].asCString() == before[1].asCString());
+  copy["inner"]["other"] = true;
+  copy["list"].append(3);
+  JSONTEST_ASSERT_EQUAL(2, copy["list"][0].asInt());
+  JSONTEST_ASSERT_EQUAL(3, copy["list"].size());
+  JSONTEST_ASSERT_EQUAL(1, before[0].asInt());
+  JSONTEST_ASSERT_EQUAL(2, root["list"].size());
+  JSONTEST_ASSERT(!root["inner"].isMember("other"));
+  JSONTEST_ASSERT_STRING_EQUAL(text, root["inner"]["name"].asString());
+  JSONTEST_ASSERT(copy != root);
+
+  // The last owner takes the members over without copying them.
+  Json::Value last(root["inner"]);
+  root.clear();
+  JSONTEST_ASSERT(root.empty());
+  Json::Value::iterator it = last.begin();
+  *it = "changed";
+  JSONTEST_ASSERT_STRING_EQUAL("changed", last["name"].asString());
+  JSONTEST_ASSERT(last.removeMember("name", nullptr));
+  JSONTEST_ASSERT(last.empty());
+  JSONTEST_ASSERT_STRING_EQUAL(text, copy["inner"]["name"].asString());
+
+  // Clearing a shared object keeps its member lookup.
+  Json::Value hashed(Json::objectValue, true);
+  hashed["name"] = text;
+  hashed.share();
+  Json::Value cleared(hashed);
+  cleared.clear();
+  JSONTEST_ASSERT(cleared.empty());
+  JSONTEST_ASSERT(cleared.hasHashedMembers());
+  JSONTEST_ASSERT_EQUAL(1, hashed.size());
+
+  // Comparing a copy does not tell whether it shares its elements.
+  Json::Value withNan(Json::arrayValue);
+  withNan.append(std::numeric_limits<double>::quiet_NaN());
+  Json::Value deep(withNan);
+  withNan.share();
+  Json::Value shallow(withNan);
+  JSONTEST_ASSERT(!(withNan == withNan));
+  JSONTEST_ASSERT(!(withNan == deep));
+  JSONTEST_ASSERT(!(withNan == shallow));
+
+  // Copies may go to other threads.
+  Json::Value threaded(Json::arrayValue);
+  for (int i = 0; i < 100; ++i)
+    threaded.append(text);
+  threaded.share();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&threaded, t] {
+      Json::Value own(threaded);
+      for (int i = 0; i < 100; ++i) {
+        Json::Value element = own[i];
+        own[i] = t;
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  JSONTEST_ASSERT_EQUAL(100, threaded.size());
+  JSONTEST_ASSERT_STRING_EQUAL(text, threaded[99].asString());
+}
+
+JSONTEST_FIXTURE_LOCAL(ValueTest, hashValues) {
+  // Equal values hash the same, however they are stored.
+  const Json::String text = "a string long enough to be allocated";
+  const char borrowed[] = "short";
+  JSONTEST_ASSERT_EQUAL(Json::Value("short").hash(),
+                        Json::Value(Json::StaticString(borrowed)).hash());
+  JSONTEST_ASSERT_EQUAL(Json::Value(text).hash(),
+                        Json::Value(text.data(), text.data() + text.size())
+                            .hash());
+  JSONTEST_ASSERT_EQUAL(Json::Value(0.0).hash(), Json::Value(-0.0).hash());
+  JSONTEST_ASSERT(Json::Value(1).hash() != Json::Value(1U).hash());
+  JSONTEST_ASSERT(Json::Value(1).hash() != Json::Value(2).hash());
+  JSONTEST_ASSERT(Json::Value("ab").hash() != Json::Value("ba").hash());
+
+  Json::Value object(Json::objectValue);
+  object["b"] = text;
+  object["a"].append(1);
+  object["a"].append(true);
+  Json::Value reordered(Json::objectValue);
+  reordered["a"].append(1);
+  reordered["a"].append(true);
+  reordered["b"] = text;
+  reordered.setComment(Json::String("// not hashed"), Json::commentBefore);
+  JSONTEST_ASSERT_EQUAL(object.hash(), reordered.hash());
+  JSONTEST_ASSERT(object.hash() != object.hash(1));
+  JSONTEST_ASSERT_EQUAL(object.hash(1), reordered.hash(1));
+  Json::Value swapped(object);
+  swapped["a"][0] = true;
+  swapped["a"][1] = 1;
+  JSONTEST_ASSERT(swapped.hash() != object.hash());
+
+  // Shared values keep their hash until changed.
+  Json::Value shared(object);
+  shared.share();
+  const Json::Value& constShared = shared;
+  JSONTEST_ASSERT_EQUAL(object.hash(), shared.hash());
+  JSONTEST_ASSERT_EQUAL(object.hash(), constShared.hash());
+  Json::Value copy(shared);
+  copy["b"] = 2;
+  JSONTEST_ASSERT(copy.hash() != shared.hash());
+  copy["b"] = text;
+  JSONTEST_ASSERT_EQUAL(shared.hash(), copy.hash());
+
+  // Known hashes that differ tell shared values apart, and equal values still
+  // compare equal.
+  Json::Value other(swapped);
+  other.share();
+  shared.hash();
+  other.hash();
+  JSONTEST_ASSERT(shared != other);
+  Json::Value same(object);
+  same.share();
+  same.hash();
+  JSONTEST_ASSERT(shared == same);
+
+  std::unordered_set<Json::Value> values{object, reordered, swapped, shared};
+  JSONTEST_ASSERT_EQUAL(2, values.size());
+  JSONTEST_ASSERT(values.count(Json::Value(copy)) == 1);
+}
+
 JSONTEST_FIXTURE_LOCAL(ValueTest, getArrayValue) {
   Json::Value array;
   for (Json::ArrayIndex i = 0; i < 5; i++)
@@ -447,6 +824,85 @@ JSONTEST_FIXTURE_LOCAL(ValueTest, arrayInsertAtRandomIndex) {
   JSONTEST_ASSERT(!array.insert(10, "index10"));
 }
 
+JSONTEST_FIXTURE_LOCAL(ValueTest, arrayElementAddresses) {
+  // Elements stay where they are as the array grows, each holding the value
+  // now at its index.
+  Json::Value array;
+  std::vector<Json::Value*> vec; // storage value address for checking
+  for (int i = 0; i < 1000; i++)
+    vec.push_back(&array.append(i));
+  array.resize(5000);
+  JSONTEST_ASSERT(array.insert(0, "first"));
+  array[9999] = "last";
+  JSONTEST_ASSERT_EQUAL(10000u, array.size());
+  for (Json::ArrayIndex i = 0; i < 1000; i++)
+    JSONTEST_ASSERT_EQUAL(vec[i], &array[i]);
+  JSONTEST_ASSERT_EQUAL(Json::Value("first"), *vec[0]);
+  JSONTEST_ASSERT_EQUAL(Json::Value(998), *vec[999]);
+  JSONTEST_ASSERT_EQUAL(Json::Value(999), array[1000]);
+  JSONTEST_ASSERT(array[1001].isNull());
+
+  // An index far past the end throws rather than allocate every element up
+  // to it.
+  JSONTEST_ASSERT_THROWS(array[4000000000U] = 1);
+  JSONTEST_ASSERT_EQUAL(10000u, array.size());
+  array[10000 + Json::Value::maxArrayGap] = 1;
+  JSONTEST_ASSERT_EQUAL(10001 + Json::Value::maxArrayGap, array.size());
+
+  // So does resizing or reserving that far.
+  Json::Value sized;
+  JSONTEST_ASSERT_THROWS(sized.resize(4000000000U));
+  JSONTEST_ASSERT_THROWS(sized.reserve(4000000000U));
+  JSONTEST_ASSERT(sized.isNull());
+  sized.resize(Json::Value::maxArrayGap);
+  JSONTEST_ASSERT_EQUAL(Json::Value::maxArrayGap, sized.size());
+  JSONTEST_ASSERT_THROWS(sized.resize(2 * Json::Value::maxArrayGap + 1));
+  JSONTEST_ASSERT_EQUAL(Json::Value::maxArrayGap, sized.size());
+  sized.resize(2 * Json::Value::maxArrayGap);
+  JSONTEST_ASSERT_EQUAL(2 * Json::Value::maxArrayGap, sized.size());
+}
+
+JSONTEST_FIXTURE_LOCAL(ValueTest, reserveArray) {
+  Json::Value array;
+  array.reserve(8);
+  JSONTEST_ASSERT_EQUAL(Json::arrayValue, array.type());
+  JSONTEST_ASSERT_EQUAL(0, array.size());
+
+  Json::Value* first = &array.append(0);
+  for (int i = 1; i < 8; i++)
+    array.append(i);
+  JSONTEST_ASSERT_EQUAL(first, &array[0]);
+  JSONTEST_ASSERT_EQUAL(8, array.size());
+
+  Json::Value removed;
+  JSONTEST_ASSERT(array.removeIndex(0, &removed));
+  JSONTEST_ASSERT_EQUAL(Json::Value(0), removed);
+  JSONTEST_ASSERT_EQUAL(Json::Value(1), array[0]);
+  JSONTEST_ASSERT_EQUAL(7, array.size());
+
+  Json::Value nullArray;
+  JSONTEST_ASSERT(nullArray.insert(0, "first"));
+  JSONTEST_ASSERT_EQUAL(Json::arrayValue, nullArray.type());
+  JSONTEST_ASSERT_EQUAL(Json::Value("first"), nullArray[0]);
+}
+
+JSONTEST_FIXTURE_LOCAL(ValueTest, arrayIteratorKeys) {
+  Json::Value array;
+  for (Json::ArrayIndex i = 0; i < 4; i++)
+    array.append(i * 10);
+  Json::ArrayIndex expected = 0;
+  for (auto it = array.begin(); it != array.end(); ++it, ++expected) {
+    JSONTEST_ASSERT_EQUAL(expected, it.index());
+    JSONTEST_ASSERT_EQUAL(Json::Value(expected), it.key());
+    JSONTEST_ASSERT_EQUAL(Json::Value(expected * 10), *it);
+  }
+  JSONTEST_ASSERT_EQUAL(4, expected);
+  JSONTEST_ASSERT_EQUAL(4, array.end() - array.begin());
+  Json::Value::const_iterator last = array.end();
+  --last;
+  JSONTEST_ASSERT_EQUAL(30, last->asInt());
+}
+
 JSONTEST_FIXTURE_LOCAL(ValueTest, null) {
   JSONTEST_ASSERT_EQUAL(Json::nullValue, null_.type());
 
@@ -1805,6 +2261,52 @@ JSONTEST_FIXTURE_LOCAL(ValueTest, offsetAccessors) {
   JSONTEST_ASSERT(y.getOffsetLimit() == 0);
 }
 
+JSONTEST_FIXTURE_LOCAL(ValueTest, metadataOutOfLine) {
+  JSONTEST_ASSERT_EQUAL(16, sizeof(Json::Value));
+
+  Json::Value array(Json::arrayValue);
+  for (int i = 0; i < 100; ++i) {
+    array.append(i);
+    if (i % 10 == 0) {
+      array[i].setComment("// element " + std::to_string(i),
+                          Json::commentBefore);
+      array[i].setOffsetStart(i);
+      array[i].setOffsetLimit(i + 1);
+    }
+  }
+  // Growing the array moved the elements along with their comments.
+  for (int i = 0; i < 100; ++i) {
+    JSONTEST_ASSERT_EQUAL(i % 10 == 0,
+                          array[i].hasComment(Json::commentBefore));
+    JSONTEST_ASSERT_EQUAL(i % 10 == 0 ? i + 1 : 0, array[i].getOffsetLimit());
+  }
+  JSONTEST_ASSERT_STRING_EQUAL("// element 30",
+                               array[30].getComment(Json::commentBefore));
+
+  Json::Value other("other");
+  array[20].swapPayload(other);
+  JSONTEST_ASSERT_STRING_EQUAL("other", array[20].asString());
+  JSONTEST_ASSERT(array[20].hasComment(Json::commentBefore));
+  JSONTEST_ASSERT(!other.hasComment(Json::commentBefore));
+
+  Json::Value moved(std::move(array[40]));
+  JSONTEST_ASSERT_EQUAL(40, moved.getOffsetStart());
+  JSONTEST_ASSERT(!array[40].hasComment(Json::commentBefore));
+  other = moved;
+  JSONTEST_ASSERT_STRING_EQUAL("// element 40",
+                               other.getComment(Json::commentBefore));
+  other = Json::Value(7);
+  JSONTEST_ASSERT(!other.hasComment(Json::commentBefore));
+  JSONTEST_ASSERT_EQUAL(0, other.getOffsetStart());
+  moved.copy(other);
+  JSONTEST_ASSERT_EQUAL(0, moved.getOffsetLimit());
+
+  Json::Value copy(array);
+  array.clear();
+  JSONTEST_ASSERT_EQUAL(50, copy[50].getOffsetStart());
+  JSONTEST_ASSERT(copy[60].hasComment(Json::commentBefore));
+}
+
 JSONTEST_FIXTURE_LOCAL(ValueTest, StaticString) {
   char mutant[] = "hello";
   Json::StaticString ss(mutant);
@@ -2052,6 +2554,37 @@ JSONTEST_FIXTURE_LOCAL(ValueTest, precision) {
   expected = "0.233";
   result = Json::writeString(b, v);
   JSONTEST_ASSERT_STRING_EQUAL(expected, result);
+
+  // "precision" is ignored by "shortest".
+  b.settings_["precision"] = 3;
+  b.settings_["precisionType"] = "shortest";
+  struct TestData {
+    double value;
+    char const* expected;
+  };
+  const TestData testData[] = {
+      {0.1, "0.1"},
+      {1.0 / 3.0, "0.3333333333333333"},
+      {0.30000000000000004, "0.30000000000000004"},
+      {123.0, "123.0"},
+      {-0.0, "-0.0"},
+      {1e16, "10000000000000000.0"},
+      {1e17, "1e+17"},
+      {0.0001, "0.0001"},
+      {0.00001, "1e-05"},
+      {-2.5e-7, "-2.5e-07"},
+      {1e100, "1e+100"},
+      {5e-324, "5e-324"},
+      {1.7976931348623157e308, "1.7976931348623157e+308"},
+      // Grisu2 alone writes these with 16 or 17 digits.
+      {0.09094, "0.09094"},
+      {0.0605663, "0.0605663"},
+      {1e23, "1e+23"},
+  };
+  for (const auto& td : testData) {
+    result = Json::writeString(b, td.value);
+    JSONTEST_ASSERT_STRING_EQUAL(td.expected, result);
+  }
 }
 JSONTEST_FIXTURE_LOCAL(ValueTest, searchValueByPath) {
   Json::Value root, subroot;
@@ -2190,6 +2723,17 @@ JSONTEST_FIXTURE_LOCAL(FastWriterTest, writeNumericValue) {
   JSONTEST_ASSERT_STRING_EQUAL(expected, result);
 }
 
+JSONTEST_FIXTURE_LOCAL(FastWriterTest, useShortestRoundTripReals) {
+  Json::FastWriter writer;
+  writer.useShortestRoundTripReals();
+  Json::Value root;
+  root.append(0.1);
+  root.append(-6.2e+15);
+  root.append(1e-7);
+  JSONTEST_ASSERT_STRING_EQUAL("[0.1,-6200000000000000.0,1e-07]\n",
+                               writer.write(root));
+}
+
 JSONTEST_FIXTURE_LOCAL(FastWriterTest, writeArrays) {
   Json::FastWriter writer;
   const Json::String expected("{"
@@ -2248,6 +2792,14 @@ JSONTEST_FIXTURE_LOCAL(StyledWriterTest, writeNumericValue) {
   JSONTEST_ASSERT_STRING_EQUAL(expected, result);
 }
 
+JSONTEST_FIXTURE_LOCAL(StyledWriterTest, useShortestRoundTripReals) {
+  Json::StyledWriter writer;
+  writer.useShortestRoundTripReals();
+  Json::Value root;
+  root["real"] = 0.1;
+  JSONTEST_ASSERT_STRING_EQUAL("{\n   \"real\" : 0.1\n}\n", writer.write(root));
+}
+
 JSONTEST_FIXTURE_LOCAL(StyledWriterTest, writeArrays) {
   Json::StyledWriter writer;
   const Json::String expected("{\n"
@@ -2743,6 +3295,156 @@ JSONTEST_FIXTURE_LOCAL(StreamWriterTest, escapeControlCharacters) {
   }
 }
 
+JSONTEST_FIXTURE_LOCAL(StreamWriterTest, appendToString) {
+  Json::Value root;
+  root["name"] = "a \"quoted\" name";
+  root["numbers"] = Json::arrayValue;
+  root["numbers"].append(-12);
+  root["numbers"].append(Json::UInt64(18446744073709551615ULL));
+  root["numbers"].append(0.5);
+  root["flags"]["on"] = true;
+  root["flags"]["off"] = Json::Value();
+  root["numbers"].setComment("// numbers", Json::commentBefore);
+
+  Json::StreamWriterBuilder b;
+  for (const char* indentation : {"", "\t"}) {
+    b.settings_["indentation"] = indentation;
+    Json::OStringStream sout;
+    std::unique_ptr<Json::StreamWriter> writer(b.newStreamWriter());
+    writer->write(root, &sout);
+    Json::String document = "prefix ";
+    JSONTEST_ASSERT_EQUAL(0, writer->append(root, &document));
+    JSONTEST_ASSERT_STRING_EQUAL("prefix " + sout.str(), document);
+    writer->append(root, &document);
+    JSONTEST_ASSERT_STRING_EQUAL("prefix " + sout.str() + sout.str(),
+                                 document);
+    JSONTEST_ASSERT_STRING_EQUAL(sout.str(), Json::writeString(b, root));
+  }
+
+  // Large documents reach the stream in several writes.
+  Json::Value big(Json::arrayValue);
+  for (int i = 0; i < 20000; ++i)
+    big.append(root);
+  Json::OStringStream sout;
+  std::unique_ptr<Json::StreamWriter> writer(b.newStreamWriter());
+  writer->write(big, &sout);
+  JSONTEST_ASSERT(sout.str().size() > 64 * 1024);
+  JSONTEST_ASSERT_STRING_EQUAL(Json::writeString(b, big), sout.str());
+
+  // Other writers append what they write to a stream.
+  struct StreamOnlyWriter : Json::StreamWriter {
+    int write(Json::Value const& value, Json::OStream* out) override {
+      *out << value.size();
+      return 0;
+    }
+  } streamOnly;
+  Json::String document = "size ";
+  streamOnly.append(root, &document);
+  JSONTEST_ASSERT_STRING_EQUAL("size 3", document);
+}
+
+JSONTEST_FIXTURE_LOCAL(StreamWriterTest, writeWithOptions) {
+  static_assert(Json::StreamWriterOptions().precision == 17,
+                "options are constants");
+  Json::Value root;
+  root["real"] = 0.1;
+  root["null"] = Json::Value();
+  root["text"] = "\xC3\xA9";
+  root["real"].setComment("// real", Json::commentBefore);
+
+  Json::StreamWriterBuilder b;
+  Json::StreamWriterOptions options;
+  auto write = [&root](Json::StreamWriter* writer) {
+    std::unique_ptr<Json::StreamWriter> owner(writer);
+    Json::String document;
+    owner->append(root, &document);
+    return document;
+  };
+  JSONTEST_ASSERT_STRING_EQUAL(write(b.newStreamWriter()),
+                               write(Json::newStreamWriter(options)));
+
+  b["commentStyle"] = "None";
+  b["indentation"] = "";
+  b["dropNullPlaceholders"] = true;
+  b["emitUTF8"] = true;
+  b["precision"] = 3;
+  b["precisionType"] = "decimal";
+  options.writeComments = false;
+  options.indentation = "";
+  options.dropNullPlaceholders = true;
+  options.emitUTF8 = true;
+  options.precision = 3;
+  options.precisionType = Json::decimalPlaces;
+  JSONTEST_ASSERT_STRING_EQUAL("{\"null\":,\"real\":0.1,\"text\":\"\xC3\xA9\"}",
+                               write(Json::newStreamWriter(options)));
+  JSONTEST_ASSERT_STRING_EQUAL(write(b.newStreamWriter()),
+                               write(Json::newStreamWriter(options)));
+}
+
+JSONTEST_FIXTURE_LOCAL(StreamWriterTest, reuseWriter) {
+  Json::Value big(Json::arrayValue);
+  for (int i = 0; i < 100; ++i)
+    big[i]["values"].append(i);
+  Json::Value small;
+  small["key"] = "value";
+
+  Json::StreamWriterBuilder b;
+  Json::StreamWriter& writer = Json::threadLocalStreamWriter(b);
+  JSONTEST_ASSERT(&writer == &Json::threadLocalStreamWriter(b));
+  // Nothing of a previous document leaks into the next one.
+  Json::String document;
+  writer.append(big, &document);
+  JSONTEST_ASSERT_STRING_EQUAL(Json::writeString(b, big), document);
+  document.clear();
+  writer.append(small, &document);
+  JSONTEST_ASSERT_STRING_EQUAL("{\n\t\"key\" : \"value\"\n}", document);
+  Json::OStringStream sout;
+  writer.write(small, &sout);
+  JSONTEST_ASSERT_STRING_EQUAL(document, sout.str());
+
+  // Other settings make another writer.
+  b.settings_["indentation"] = "";
+  document.clear();
+  Json::threadLocalStreamWriter(b).append(small, &document);
+  JSONTEST_ASSERT_STRING_EQUAL("{\"key\":\"value\"}", document);
+}
+
+// Chars to escape at every offset of a few vector widths.
+JSONTEST_FIXTURE_LOCAL(StreamWriterTest, escapeLongStrings) {
+  struct Special {
+    const char* raw;
+    const char* escaped;
+    const char* escapedUTF8;
+  };
+  const Special specials[] = {
+      {"\"", "\\\"", "\\\""},
+      {"\\", "\\\\", "\\\\"},
+      {"\n", "\\n", "\\n"},
+      {"\x01", "\\u0001", "\\u0001"},
+      {"\x7F", "\x7F", "\x7F"},
+      {"\xC3\xA9", "\\u00e9", "\xC3\xA9"},
+      {"\xF0\x9F\x98\x80", "\\ud83d\\ude00", "\xF0\x9F\x98\x80"},
+  };
+  Json::StreamWriterBuilder b;
+  b.settings_["indentation"] = "";
+  for (bool emitUTF8 : {false, true}) {
+    b.settings_["emitUTF8"] = emitUTF8;
+    for (const Special& special : specials) {
+      for (size_t offset = 0; offset < 70; ++offset) {
+        const std::string before(offset, 'a');
+        const std::string after(70 - offset, '/');
+        const Json::Value value(before + special.raw + after);
+        JSONTEST_ASSERT_STRING_EQUAL(
+            "\"" + before +
+                (emitUTF8 ? special.escapedUTF8 : special.escaped) + after +
+                "\"",
+            Json::writeString(b, value))
+            << ", emit=" << emitUTF8 << ", offset=" << offset;
+      }
+    }
+  }
+}
+
 #ifdef _WIN32
 JSONTEST_FIXTURE_LOCAL(StreamWriterTest, escapeTabCharacterWindows) {
   // Get the current locale before changing it
@@ -2845,6 +3547,26 @@ JSONTEST_FIXTURE_LOCAL(ReaderTest, parseArray) {
       "* Line 1, Column 12\n  Missing ',' or ']' in array declaration\n");
 }
 
+JSONTEST_FIXTURE_LOCAL(ReaderTest, commentsAfterGrowingArrayElements) {
+  checkParse("[\n"
+             "  1, // one\n"
+             "  2, // two\n"
+             "  3, // three\n"
+             "  4, // four\n"
+             "  5, // five\n"
+             "  6 // six\n"
+             "]");
+  JSONTEST_ASSERT_EQUAL(6, root.size());
+  JSONTEST_ASSERT_STRING_EQUAL(
+      "// one", root[0].getComment(Json::commentAfterOnSameLine));
+  JSONTEST_ASSERT_STRING_EQUAL(
+      "// two", root[1].getComment(Json::commentAfterOnSameLine));
+  JSONTEST_ASSERT_STRING_EQUAL(
+      "// five", root[4].getComment(Json::commentAfterOnSameLine));
+  JSONTEST_ASSERT_STRING_EQUAL(
+      "// six", root[5].getComment(Json::commentAfterOnSameLine));
+}
+
 JSONTEST_FIXTURE_LOCAL(ReaderTest, parseString) {
   checkParse(R"([ "\u8a2a" ])");
   checkParse(
@@ -3032,6 +3754,46 @@ JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseNumber) {
   }
 }
 
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseReal) {
+  Json::CharReaderBuilder b;
+  CharReaderPtr reader(b.newCharReader());
+  struct TestData {
+    char const* text;
+    double expected;
+  };
+  const TestData testData[] = {
+      {"0.1", 0.1},
+      {"-122.4194155", -122.4194155},
+      {"0.12345678e7", 1234567.8},
+      {"0.30000000000000004", 0.30000000000000004},
+      {"1e23", 1e23},
+      {"9007199254740993.0", 9007199254740992.0},
+      {"9007199254740993e0", 9007199254740992.0},
+      {"1.7976931348623157e308", 1.7976931348623157e308},
+      {"2.2250738585072014e-308", 2.2250738585072014e-308},
+      {"4.9e-324", 4.9e-324},
+      {"123456789012345678901234", 1.2345678901234568e23},
+      {"0.000000000000000000000000000000000000001", 1e-39},
+  };
+  for (const auto& td : testData) {
+    Json::String errs;
+    Json::Value root;
+    bool ok = reader->parse(td.text, td.text + std::strlen(td.text), &root,
+                            &errs);
+    JSONTEST_ASSERT(ok) << td.text;
+    JSONTEST_ASSERT(errs.empty());
+    JSONTEST_ASSERT_EQUAL(Json::realValue, root.type()) << td.text;
+    JSONTEST_ASSERT_EQUAL(td.expected, root.asDouble()) << td.text;
+  }
+  {
+    char const doc[] = "-0.0";
+    Json::Value root;
+    Json::String errs;
+    JSONTEST_ASSERT(reader->parse(doc, doc + std::strlen(doc), &root, &errs));
+    JSONTEST_ASSERT(std::signbit(root.asDouble()));
+  }
+}
+
 JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseString) {
   Json::CharReaderBuilder b;
   CharReaderPtr reader(b.newCharReader());
@@ -3237,6 +3999,1018 @@ JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseWithStackLimit) {
     JSONTEST_ASSERT_THROWS(
         reader->parse(doc, doc + std::strlen(doc), &root, &errs));
   }
+  {
+    // Lazy arrays and objects are skipped within the same limit.
+    b.settings_["lazy"] = true;
+    b.settings_["stackLimit"] = 3;
+    CharReaderPtr reader(b.newCharReader());
+    char const deep[] = "[[[ ]], {}, [1]]";
+    char const deeper[] = "[[[1]], {}]";
+    JSONTEST_ASSERT(
+        reader->parse(deep, deep + std::strlen(deep), &root, nullptr));
+    JSONTEST_ASSERT(root[0][0][0].isNull());
+    JSONTEST_ASSERT_EQUAL(1, root[2][0].asInt());
+    JSONTEST_ASSERT_THROWS(
+        reader->parse(deeper, deeper + std::strlen(deeper), &root, nullptr));
+    b.settings_["lazy"] = false;
+    reader.reset(b.newCharReader());
+    JSONTEST_ASSERT(
+        reader->parse(deep, deep + std::strlen(deep), &root, nullptr));
+    JSONTEST_ASSERT_THROWS(
+        reader->parse(deeper, deeper + std::strlen(deeper), &root, nullptr));
+    b.settings_["lazy"] = true;
+    Json::String nested(300000, '[');
+    nested += Json::String(300000, ']');
+    b.settings_["stackLimit"] = 1000;
+    reader.reset(b.newCharReader());
+    JSONTEST_ASSERT_THROWS(reader->parse(
+        nested.data(), nested.data() + nested.size(), &root, nullptr));
+  }
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseWithHashedObjectMembers) {
+  Json::CharReaderBuilder b;
+  Json::Value root;
+  char const doc[] = R"({ "a" : 1, "b" : { "c" : [ { "d" : 2 } ] } })";
+  {
+    CharReaderPtr reader(b.newCharReader());
+    Json::String errs;
+    JSONTEST_ASSERT(reader->parse(doc, doc + std::strlen(doc), &root, &errs));
+    JSONTEST_ASSERT(!root.hasHashedMembers());
+  }
+  {
+    b.settings_["hashObjectMembers"] = true;
+    JSONTEST_ASSERT(b.validate(nullptr));
+    CharReaderPtr reader(b.newCharReader());
+    Json::String errs;
+    JSONTEST_ASSERT(reader->parse(doc, doc + std::strlen(doc), &root, &errs));
+    JSONTEST_ASSERT(errs.empty());
+    JSONTEST_ASSERT(root.hasHashedMembers());
+    JSONTEST_ASSERT(root["b"].hasHashedMembers());
+    JSONTEST_ASSERT(root["b"]["c"][0].hasHashedMembers());
+    JSONTEST_ASSERT_EQUAL(2, root["b"]["c"][0]["d"].asInt());
+  }
+  {
+    // So are lazy objects, even when cleared before they are read.
+    b.settings_["lazy"] = true;
+    CharReaderPtr reader(b.newCharReader());
+    JSONTEST_ASSERT(reader->parse(doc, doc + std::strlen(doc), &root, nullptr));
+    root.clear();
+    JSONTEST_ASSERT(root.empty());
+    JSONTEST_ASSERT(root.hasHashedMembers());
+  }
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseWithBorrowedStrings) {
+  Json::CharReaderBuilder b;
+  b.settings_["borrowStrings"] = true;
+  b.settings_["collectOffsets"] = true;
+  JSONTEST_ASSERT(b.validate(nullptr));
+  CharReaderPtr reader(b.newCharReader());
+  Json::Value root;
+  Json::String errs;
+  char const doc[] = R"({ "plain" : "text", "esc\"aped" : [ "a\tb", "" ] })";
+  char const* const docEnd = doc + std::strlen(doc);
+  JSONTEST_ASSERT(reader->parse(doc, docEnd, &root, &errs));
+  JSONTEST_ASSERT(errs.empty());
+  auto inDoc = [&](char const* p) { return p >= doc && p < docEnd; };
+
+  char const* begin = nullptr;
+  char const* end = nullptr;
+  JSONTEST_ASSERT(root["plain"].getString(&begin, &end));
+  JSONTEST_ASSERT(inDoc(begin));
+  JSONTEST_ASSERT_STRING_EQUAL("text", root["plain"].asString());
+  JSONTEST_ASSERT_EQUAL(12, root["plain"].getOffsetStart());
+
+  const Json::Value& escaped = root["esc\"aped"];
+  JSONTEST_ASSERT(escaped[0].getString(&begin, &end));
+  JSONTEST_ASSERT(!inDoc(begin));
+  JSONTEST_ASSERT_STRING_EQUAL("a\tb", escaped[0].asString());
+  JSONTEST_ASSERT_STRING_EQUAL("", escaped[1].asString());
+
+  // Borrowed member names are not null-terminated.
+  for (auto it = root.begin(); it != root.end(); ++it) {
+    JSONTEST_ASSERT_EQUAL(it.name() == "plain", inDoc(it.memberName(&end)));
+    JSONTEST_ASSERT_STRING_EQUAL(it.name(), it.key().asString());
+  }
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseWithOffsets) {
+  Json::CharReaderBuilder b;
+  char const doc[] = R"({ "a" : [ 1, "two" ] })";
+  char const* const docEnd = doc + std::strlen(doc);
+  Json::Value root;
+  {
+    CharReaderPtr reader(b.newCharReader());
+    JSONTEST_ASSERT(reader->parse(doc, docEnd, &root, nullptr));
+    JSONTEST_ASSERT_EQUAL(0, root["a"][1].getOffsetStart());
+    JSONTEST_ASSERT_EQUAL(0, root.getOffsetLimit());
+  }
+  b.settings_["collectOffsets"] = true;
+  {
+    CharReaderPtr reader(b.newCharReader());
+    JSONTEST_ASSERT(reader->parse(doc, docEnd, &root, nullptr));
+    JSONTEST_ASSERT_EQUAL(8, root["a"].getOffsetStart());
+    JSONTEST_ASSERT_EQUAL(13, root["a"][1].getOffsetStart());
+    JSONTEST_ASSERT_EQUAL(18, root["a"][1].getOffsetLimit());
+    JSONTEST_ASSERT_EQUAL(22, root.getOffsetLimit());
+  }
+}
+
+// Records the events of an event-driven parse as a compact trace.
+class RecordingHandler : public Json::ParseHandler {
+public:
+  Json::String trace;
+  int stopAfter = -1; // number of events to accept, or -1 for all
+
+  bool onNull() override { return record("null"); }
+  bool onBool(bool value) override { return record(value ? "T" : "F"); }
+  bool onInt(Json::LargestInt value) override {
+    return record("i" + std::to_string(value));
+  }
+  bool onUInt(Json::LargestUInt value) override {
+    return record("u" + std::to_string(value));
+  }
+  bool onDouble(double value) override {
+    return record("d" + Json::valueToString(value));
+  }
+  bool onString(char const* begin, char const* end) override {
+    return record("'" + Json::String(begin, end) + "'");
+  }
+  bool onStartObject() override { return record("{"); }
+  bool onKey(char const* begin, char const* end) override {
+    return record(Json::String(begin, end) + ":");
+  }
+  bool onEndObject() override { return record("}"); }
+  bool onStartArray() override { return record("["); }
+  bool onEndArray() override { return record("]"); }
+
+private:
+  bool record(const Json::String& event) {
+    if (stopAfter == 0)
+      return false;
+    if (stopAfter > 0)
+      --stopAfter;
+    trace += trace.empty() ? event : " " + event;
+    return true;
+  }
+};
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseEvents) {
+  Json::CharReaderBuilder b;
+  char const doc[] = "{ \"a\" : [ 1, -2, 18446744073709551615, 1.5 ], // c\n"
+                     "  \"b\" : { \"s\" : \"x\\ty\", \"t\" : true },\n"
+                     "  \"\" : null, \"f\" : false, \"e\" : [], \"o\" : {} }";
+  char const* const docEnd = doc + std::strlen(doc);
+  const Json::String expected = "{ a: [ i1 i-2 u18446744073709551615 d1.5 ] "
+                                "b: { s: 'x\ty' t: T } : null f: F "
+                                "e: [ ] o: { } }";
+  {
+    CharReaderPtr reader(b.newCharReader());
+    RecordingHandler handler;
+    Json::String errs;
+    JSONTEST_ASSERT(reader->parseEvents(doc, docEnd, &handler, &errs));
+    JSONTEST_ASSERT(errs.empty());
+    JSONTEST_ASSERT_STRING_EQUAL(expected, handler.trace);
+  }
+  {
+    // Stopping the parse from a callback is reported as an error.
+    CharReaderPtr reader(b.newCharReader());
+    RecordingHandler handler;
+    handler.stopAfter = 3;
+    Json::String errs;
+    JSONTEST_ASSERT(!reader->parseEvents(doc, docEnd, &handler, &errs));
+    JSONTEST_ASSERT_STRING_EQUAL("{ a: [", handler.trace);
+    JSONTEST_ASSERT_STRING_EQUAL("* Line 1, Column 11\n"
+                                 "  Parsing stopped by the handler.\n",
+                                 errs);
+  }
+  {
+    b.settings_["allowSingleQuotes"] = true;
+    b.settings_["allowSpecialFloats"] = true;
+    b.settings_["allowNumericKeys"] = true;
+    b.settings_["allowDroppedNullPlaceholders"] = true;
+    CharReaderPtr reader(b.newCharReader());
+    RecordingHandler handler;
+    char const special[] = "{ 'k' : [ NaN, -Infinity,, 'q' ], 7 : 1 }";
+    Json::String errs;
+    JSONTEST_ASSERT(reader->parseEvents(
+        special, special + std::strlen(special), &handler, &errs));
+    JSONTEST_ASSERT_STRING_EQUAL(
+        "{ k: [ dnull d-1e+9999 null 'q' ] 7: i1 }", handler.trace);
+  }
+  {
+    Json::CharReaderBuilder strict;
+    Json::CharReaderBuilder::strictMode(&strict.settings_);
+    CharReaderPtr reader(strict.newCharReader());
+    RecordingHandler handler;
+    char const dupKeys[] = R"({ "a" : 1, "a" : 2 })";
+    Json::String errs;
+    JSONTEST_ASSERT(!reader->parseEvents(
+        dupKeys, dupKeys + std::strlen(dupKeys), &handler, &errs));
+    JSONTEST_ASSERT_STRING_EQUAL("* Line 1, Column 12\n"
+                                 "  Duplicate key: 'a'\n",
+                                 errs);
+    char const scalar[] = "1";
+    JSONTEST_ASSERT(
+        !reader->parseEvents(scalar, scalar + 1, &handler, nullptr));
+  }
+  {
+    b.settings_["stackLimit"] = 2;
+    CharReaderPtr reader(b.newCharReader());
+    RecordingHandler handler;
+    char const nested[] = "[[[1]]]";
+    JSONTEST_ASSERT_THROWS(reader->parseEvents(
+        nested, nested + std::strlen(nested), &handler, nullptr));
+  }
+}
+
+// A CharReader that relies on the default parseEvents().
+class TreeOnlyCharReader : public Json::CharReader {
+public:
+  bool parse(char const* beginDoc, char const* endDoc, Json::Value* root,
+             Json::String* errs) override {
+    CharReaderPtr reader(Json::CharReaderBuilder().newCharReader());
+    return reader->parse(beginDoc, endDoc, root, errs);
+  }
+};
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseEventsFromTree) {
+  TreeOnlyCharReader reader;
+  RecordingHandler handler;
+  char const doc[] = R"({ "a" : [ 1, "s", null ], "b" : 2.5 })";
+  Json::String errs;
+  JSONTEST_ASSERT(
+      reader.parseEvents(doc, doc + std::strlen(doc), &handler, &errs));
+  JSONTEST_ASSERT_STRING_EQUAL("{ a: [ i1 's' null ] b: d2.5 }",
+                               handler.trace);
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseInArena) {
+  Json::CharReaderBuilder b;
+  b.settings_["collectOffsets"] = true;
+  CharReaderPtr reader(b.newCharReader());
+  char const doc[] = R"({ "name" : "text", "esc\"aped" : [ "a\tb", 1.5, {} ],
+                         "nested" : { "n" : [ null, true, "" ] } })";
+  char const* const docEnd = doc + std::strlen(doc);
+  Json::Value expected;
+  JSONTEST_ASSERT(reader->parse(doc, docEnd, &expected, nullptr));
+
+  Json::Arena arena;
+  Json::Value root;
+  Json::String errs;
+  JSONTEST_ASSERT(reader->parseInArena(doc, docEnd, &arena, &root, &errs));
+  JSONTEST_ASSERT(errs.empty());
+  JSONTEST_ASSERT(arena.capacity() > 0);
+  JSONTEST_ASSERT_EQUAL(expected, root);
+  JSONTEST_ASSERT_STRING_EQUAL("a\tb", root["esc\"aped"][0].asString());
+  JSONTEST_ASSERT_EQUAL(11, root["name"].getOffsetStart());
+  root["nested"]["added"] = "value";
+  JSONTEST_ASSERT_EQUAL(2, root["nested"].size());
+
+  char const bad[] = R"({ "a" : [ 1, 2 )";
+  JSONTEST_ASSERT(!reader->parseInArena(bad, bad + std::strlen(bad), &arena,
+                                        &root, &errs));
+  JSONTEST_ASSERT(!errs.empty());
+
+  // Readers without their own implementation parse normally.
+  TreeOnlyCharReader treeOnly;
+  JSONTEST_ASSERT(treeOnly.parseInArena(doc, docEnd, &arena, &root, &errs));
+  JSONTEST_ASSERT_EQUAL(expected, root);
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseWithInternedKeys) {
+  Json::CharReaderBuilder b;
+  char const doc[] = R"([ { "identifier": 1, "id": 2, "desc\u0072iption": 3 },
+                          { "identifier": 4, "id": 5, "description": 6 } ])";
+  char const* const docEnd = doc + std::strlen(doc);
+  CharReaderPtr plain(b.newCharReader());
+  Json::Value expected;
+  JSONTEST_ASSERT(plain->parse(doc, docEnd, &expected, nullptr));
+
+  b.settings_["internKeys"] = true;
+  CharReaderPtr reader(b.newCharReader());
+  Json::Value root;
+  Json::Value again;
+  JSONTEST_ASSERT(reader->parse(doc, docEnd, &root, nullptr));
+  JSONTEST_ASSERT(reader->parse(doc, docEnd, &again, nullptr));
+  reader.reset();
+  JSONTEST_ASSERT_EQUAL(expected, root);
+  JSONTEST_ASSERT_EQUAL(expected, again);
+  auto name = [](const Json::Value& record, int i) {
+    auto it = record.begin();
+    std::advance(it, i);
+    char const* end = nullptr;
+    return it.memberName(&end);
+  };
+  // Members are ordered "description", "id", "identifier".
+  JSONTEST_ASSERT(name(root[0], 0) == name(root[1], 0));
+  JSONTEST_ASSERT(name(root[0], 2) == name(again[1], 2));
+  JSONTEST_ASSERT(name(root[0], 1) != name(root[1], 1));
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseWithOptions) {
+  constexpr auto strict = Json::CharReaderOptions::strictMode();
+  static_assert(strict.strictRoot && !strict.allowComments &&
+                    strict.collectComments && strict.stackLimit == 1000,
+                "options are constants");
+  char const doc[] = "{ \"a\": [1, 2,], // comment\n \"b\": 1.5 }";
+  char const* const docEnd = doc + std::strlen(doc);
+
+  Json::CharReaderBuilder b;
+  CharReaderPtr fromSettings(b.newCharReader());
+  CharReaderPtr fromOptions(Json::newCharReader(Json::CharReaderOptions()));
+  Json::Value expected;
+  Json::Value root;
+  JSONTEST_ASSERT(fromSettings->parse(doc, docEnd, &expected, nullptr));
+  JSONTEST_ASSERT(fromOptions->parse(doc, docEnd, &root, nullptr));
+  JSONTEST_ASSERT_EQUAL(expected, root);
+  JSONTEST_ASSERT_STRING_EQUAL(expected["a"].getComment(Json::commentAfter),
+                               root["a"].getComment(Json::commentAfter));
+
+  Json::CharReaderBuilder::strictMode(&b.settings_);
+  fromSettings.reset(b.newCharReader());
+  fromOptions.reset(Json::newCharReader(strict));
+  Json::String settingsErrs;
+  Json::String optionsErrs;
+  JSONTEST_ASSERT(!fromSettings->parse(doc, docEnd, &root, &settingsErrs));
+  JSONTEST_ASSERT(!fromOptions->parse(doc, docEnd, &root, &optionsErrs));
+  JSONTEST_ASSERT_STRING_EQUAL(settingsErrs, optionsErrs);
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseLazy) {
+  char const doc[] = R"({
+    "name": "}{ \"][",
+    "tags": [ "a", [ [], {} ], { "x": ["]"] } ],
+    /* a } comment ] */
+    "nested": { "deep": { "deeper": [1, 2.5, null, true] } },
+    "empty": {} // end
+  })";
+  char const* const docEnd = doc + std::strlen(doc);
+  Json::CharReaderBuilder b;
+  b.settings_["collectComments"] = false;
+  b.settings_["collectOffsets"] = true;
+  CharReaderPtr eager(b.newCharReader());
+  Json::Value expected;
+  JSONTEST_ASSERT(eager->parse(doc, docEnd, &expected, nullptr));
+
+  b.settings_["lazy"] = true;
+  CharReaderPtr reader(b.newCharReader());
+  Json::Value root;
+  JSONTEST_ASSERT(reader->parse(doc, docEnd, &root, nullptr));
+  reader.reset();
+  JSONTEST_ASSERT(root.isObject());
+  Json::Value const copy = root["nested"];
+  JSONTEST_ASSERT_EQUAL(4u, copy["deep"]["deeper"].size());
+  Json::Value const& deeper = expected["nested"]["deep"]["deeper"];
+  JSONTEST_ASSERT_EQUAL(deeper[1].getOffsetStart(),
+                        copy["deep"]["deeper"][1].getOffsetStart());
+  JSONTEST_ASSERT_EQUAL(expected["tags"].getOffsetLimit(),
+                        root["tags"].getOffsetLimit());
+  JSONTEST_ASSERT_EQUAL(expected, root);
+  JSONTEST_ASSERT_STRING_EQUAL(Json::writeString(Json::StreamWriterBuilder(),
+                                                 expected),
+                               Json::writeString(Json::StreamWriterBuilder(),
+                                                 root));
+
+  // Sharing reads what is left to read, so copies may go to other threads.
+  reader.reset(b.newCharReader());
+  JSONTEST_ASSERT(reader->parse(doc, docEnd, &root, nullptr));
+  root.share();
+  std::vector<std::thread> threads;
+  bool same[4] = {};
+  for (bool& result : same) {
+    threads.emplace_back([&root, &expected, &result] {
+      Json::Value const own(root);
+      result = own == expected && own["tags"][1][1].isObject();
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  for (bool result : same)
+    JSONTEST_ASSERT(result);
+
+  // Errors inside an array or object show when it is read.
+  char const bad[] = R"({ "ok": [1], "bad": [1, 2 x], "clear": [x] })";
+  reader.reset(b.newCharReader());
+  JSONTEST_ASSERT(reader->parse(bad, bad + std::strlen(bad), &root, nullptr));
+  JSONTEST_ASSERT_EQUAL(1, root["ok"][0].asInt());
+  JSONTEST_ASSERT_THROWS(root["bad"].size());
+  root["clear"].clear();
+  JSONTEST_ASSERT(root["clear"].isArray() && root["clear"].empty());
+  char const unclosed[] = R"({ "a": [1, "]" )";
+  Json::String errs;
+  JSONTEST_ASSERT(!reader->parse(unclosed, unclosed + std::strlen(unclosed),
+                                 &root, &errs));
+  JSONTEST_ASSERT_STRING_EQUAL("* Line 1, Column 1\n"
+                               "  Missing '}' or object member name\n"
+                               "See Line 1, Column 16 for detail.\n",
+                               errs);
+  // Brackets must match, as when reading eagerly, even in a member which a
+  // later one of the same name replaces.
+  char const mismatched[] = R"({"k":["{" [1,2] NaN},"k":1})";
+  JSONTEST_ASSERT(!reader->parse(
+      mismatched, mismatched + std::strlen(mismatched), &root, &errs));
+  JSONTEST_ASSERT_STRING_EQUAL("* Line 1, Column 20\n"
+                               "  Missing ',' or ']' in array declaration\n",
+                               errs);
+
+  // Interning values leaves them unread too.
+  b.settings_["internValues"] = true;
+  reader.reset(b.newCharReader());
+  JSONTEST_ASSERT(reader->parse(bad, bad + std::strlen(bad), &root, nullptr));
+  JSONTEST_ASSERT_THROWS(root["bad"].size());
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseInternValues) {
+  char const doc[] = R"([
+    { "host": "node-1.example.com", "tags": ["http", "api"],
+      "settings": { "retries": 3, "region": "eu-west-1a" } },
+    { "host": "node-2.example.com", "tags": ["http", "api"],
+      "settings": { "retries": 3, "region": "eu-west-1a" } }, // last
+    { "host": "node-1.example.com", "tags": ["http"], "settings": {} }
+  ])";
+  char const* const docEnd = doc + std::strlen(doc);
+  Json::CharReaderBuilder b;
+  b.settings_["collectOffsets"] = true;
+  CharReaderPtr eager(b.newCharReader());
+  Json::Value expected;
+  JSONTEST_ASSERT(eager->parse(doc, docEnd, &expected, nullptr));
+
+  for (bool hashed : {false, true}) {
+    b.settings_["internValues"] = true;
+    b.settings_["hashObjectMembers"] = hashed;
+    CharReaderPtr reader(b.newCharReader());
+    Json::Value root;
+    JSONTEST_ASSERT(reader->parse(doc, docEnd, &root, nullptr));
+    JSONTEST_ASSERT_EQUAL(expected, root);
+    JSONTEST_ASSERT_STRING_EQUAL(
+        Json::writeString(Json::StreamWriterBuilder(), expected),
+        Json::writeString(Json::StreamWriterBuilder(), root));
+
+    // Equal parts share their payload, and keep their own offsets.
+    const Json::Value& first = root[0];
+    const Json::Value& second = root[1];
+    JSONTEST_ASSERT(&first["tags"][0] == &second["tags"][0]);
+    JSONTEST_ASSERT(&first["settings"]["retries"] ==
+                    &second["settings"]["retries"]);
+    JSONTEST_ASSERT(first["host"].asCString() == root[2]["host"].asCString());
+    JSONTEST_ASSERT(first["settings"].getOffsetStart() !=
+                    second["settings"].getOffsetStart());
+    JSONTEST_ASSERT_EQUAL(expected[1].getOffsetLimit(),
+                          second.getOffsetLimit());
+
+    // A change is made to a copy.
+    root[1]["settings"]["retries"] = 4;
+    JSONTEST_ASSERT_EQUAL(3, root[0]["settings"]["retries"].asInt());
+    JSONTEST_ASSERT_EQUAL(4, root[1]["settings"]["retries"].asInt());
+    root[0]["tags"].append("v2");
+    JSONTEST_ASSERT_EQUAL(2u, root[1]["tags"].size());
+  }
+
+  // A pool can be used directly, too. Short strings are not pooled.
+  Json::ValuePool pool;
+  Json::Value a = expected[0];
+  Json::Value c = expected[0];
+  a.share(pool);
+  JSONTEST_ASSERT_EQUAL(5u, pool.size());
+  c.share(pool);
+  JSONTEST_ASSERT_EQUAL(5u, pool.size());
+  const Json::Value& constA = a;
+  const Json::Value& constC = c;
+  JSONTEST_ASSERT(&constA["tags"] == &constC["tags"]);
+  pool.clear();
+  JSONTEST_ASSERT_EQUAL(0u, pool.size());
+  JSONTEST_ASSERT_EQUAL(expected[0], c);
+  Json::ValuePool full(0);
+  Json::Value d = expected[0];
+  d.share(full);
+  JSONTEST_ASSERT_EQUAL(0u, full.size());
+  JSONTEST_ASSERT(Json::Value(d) == expected[0]);
+
+  // -0.0 and 0.0 compare equal, but are not written the same.
+  char const zeros[] = "[[-0.0,1.5],[0.0,1.5]]";
+  CharReaderPtr reader(b.newCharReader());
+  Json::Value root;
+  JSONTEST_ASSERT(
+      reader->parse(zeros, zeros + std::strlen(zeros), &root, nullptr));
+  Json::StreamWriterBuilder w;
+  w["indentation"] = "";
+  JSONTEST_ASSERT_STRING_EQUAL(zeros, Json::writeString(w, root));
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parsePackNumbers) {
+  char const doc[] = R"({
+    "samples": [0.5, -1.25, 3e2, 0.0],
+    "counts": [1, -2, 3],
+    "mixed": [1, 2.5],
+    "huge": [18446744073709551615, 1],
+    "noted": [1.5, // a comment
+              2.5],
+    "nested": [[1.5, 2.5], []]
+  })";
+  char const* const docEnd = doc + std::strlen(doc);
+  Json::CharReaderBuilder b;
+  CharReaderPtr plain(b.newCharReader());
+  Json::Value expected;
+  JSONTEST_ASSERT(plain->parse(doc, docEnd, &expected, nullptr));
+  b.settings_["packNumbers"] = true;
+  CharReaderPtr reader(b.newCharReader());
+  Json::Value root;
+  JSONTEST_ASSERT(reader->parse(doc, docEnd, &root, nullptr));
+
+  double const* reals;
+  double const* realsEnd;
+  Json::LargestInt const* ints;
+  Json::LargestInt const* intsEnd;
+  JSONTEST_ASSERT(root["samples"].getReals(&reals, &realsEnd));
+  JSONTEST_ASSERT_EQUAL(4, realsEnd - reals);
+  JSONTEST_ASSERT_EQUAL(300.0, reals[2]);
+  JSONTEST_ASSERT(!root["samples"].getLargestInts(&ints, &intsEnd));
+  JSONTEST_ASSERT(root["counts"].getLargestInts(&ints, &intsEnd));
+  JSONTEST_ASSERT_EQUAL(3, intsEnd - ints);
+  JSONTEST_ASSERT_EQUAL(-2, ints[1]);
+  JSONTEST_ASSERT(!root["mixed"].getReals(&reals, &realsEnd));
+  JSONTEST_ASSERT(!root["mixed"].getLargestInts(&ints, &intsEnd));
+  JSONTEST_ASSERT(!root["huge"].getLargestInts(&ints, &intsEnd));
+  JSONTEST_ASSERT(!root["noted"].getReals(&reals, &realsEnd));
+  JSONTEST_ASSERT(root["nested"][0].getReals(&reals, &realsEnd));
+
+  // Packed arrays read, compare, hash and write like the others, and stay
+  // packed doing so.
+  const Json::Value& samples = root["samples"];
+  JSONTEST_ASSERT_EQUAL(4u, samples.size());
+  JSONTEST_ASSERT_EQUAL(-1.25, samples.get(1, Json::Value()).asDouble());
+  JSONTEST_ASSERT(samples.get(4, Json::Value()).isNull());
+  JSONTEST_ASSERT_EQUAL(expected, root);
+  JSONTEST_ASSERT_EQUAL(expected.hash(), root.hash());
+  JSONTEST_ASSERT_STRING_EQUAL(
+      Json::writeString(Json::StreamWriterBuilder(), expected),
+      Json::writeString(Json::StreamWriterBuilder(), root));
+  JSONTEST_ASSERT(samples.getReals(&reals, &realsEnd));
+  Json::Value copy = samples;
+  double const* copyReals;
+  double const* copyRealsEnd;
+  JSONTEST_ASSERT(copy.getReals(&copyReals, &copyRealsEnd));
+  JSONTEST_ASSERT(copyReals != reals);
+
+  // Inserting a number of the same type, or removing one, keeps the array
+  // packed; anything else stores the elements as usual.
+  JSONTEST_ASSERT(copy.insert(1, 7.5));
+  Json::Value removed;
+  JSONTEST_ASSERT(copy.removeIndex(0, &removed));
+  JSONTEST_ASSERT_EQUAL(0.5, removed.asDouble());
+  JSONTEST_ASSERT(copy.getReals(&reals, &realsEnd));
+  JSONTEST_ASSERT_EQUAL(7.5, reals[0]);
+  JSONTEST_ASSERT(copy.insert(0, 1));
+  JSONTEST_ASSERT(!copy.getReals(&reals, &realsEnd));
+  JSONTEST_ASSERT_EQUAL(1, copy[0].asInt());
+  JSONTEST_ASSERT_EQUAL(7.5, copy[1].asDouble());
+  JSONTEST_ASSERT_EQUAL(5u, copy.size());
+
+  Json::Value counts = root["counts"];
+  counts[1] = "two";
+  JSONTEST_ASSERT_EQUAL(Json::Value(-2), root["counts"][1]);
+  JSONTEST_ASSERT_STRING_EQUAL("two", counts[1].asString());
+  JSONTEST_ASSERT(!counts.packNumbers());
+  counts.removeIndex(1, nullptr);
+  JSONTEST_ASSERT(counts.packNumbers());
+  JSONTEST_ASSERT(counts.getLargestInts(&ints, &intsEnd));
+  JSONTEST_ASSERT_EQUAL(2, intsEnd - ints);
+  counts.clear();
+  JSONTEST_ASSERT(counts.empty());
+  JSONTEST_ASSERT(!counts.getLargestInts(&ints, &intsEnd));
+
+  // Sharing stores the elements as usual, so copies may go to other threads.
+  root.share();
+  JSONTEST_ASSERT(!root["nested"][0].getReals(&reals, &realsEnd));
+  std::vector<std::thread> threads;
+  bool same[4] = {};
+  for (bool& result : same) {
+    threads.emplace_back([&root, &expected, &result] {
+      Json::Value const own(root);
+      result = own["samples"][1] == expected["samples"][1] &&
+               own["nested"][0][0] == expected["nested"][0][0];
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+  for (bool result : same)
+    JSONTEST_ASSERT(result);
+
+  // Lazy arrays are packed as they are read.
+  b.settings_["lazy"] = true;
+  reader.reset(b.newCharReader());
+  JSONTEST_ASSERT(reader->parse(doc, docEnd, &root, nullptr));
+  JSONTEST_ASSERT_EQUAL(4u, root["samples"].size());
+  JSONTEST_ASSERT(root["samples"].getReals(&reals, &realsEnd));
+  JSONTEST_ASSERT_EQUAL(-1.25, root["samples"].get(1, 0).asDouble());
+  JSONTEST_ASSERT_EQUAL(1.5, root["nested"][0][0].asDouble());
+  Json::LargestInt sum = 0;
+  for (const Json::Value& count : root["counts"])
+    sum += count.asLargestInt();
+  JSONTEST_ASSERT_EQUAL(2, sum);
+  // Lazy values have no comments.
+  Json::CharReaderBuilder uncommented;
+  uncommented["collectComments"] = false;
+  Json::Value flat;
+  plain.reset(uncommented.newCharReader());
+  JSONTEST_ASSERT(plain->parse(doc, docEnd, &flat, nullptr));
+  JSONTEST_ASSERT(reader->parse(doc, docEnd, &root, nullptr));
+  JSONTEST_ASSERT_STRING_EQUAL(
+      Json::writeString(Json::StreamWriterBuilder(), flat),
+      Json::writeString(Json::StreamWriterBuilder(), root));
+  JSONTEST_ASSERT_EQUAL(expected, root);
+  b.settings_["lazy"] = false;
+
+  // Neither are interned values packed.
+  b.settings_["internValues"] = true;
+  reader.reset(b.newCharReader());
+  JSONTEST_ASSERT(reader->parse(doc, docEnd, &root, nullptr));
+  JSONTEST_ASSERT(!root["samples"].getReals(&reals, &realsEnd));
+  JSONTEST_ASSERT_EQUAL(expected, root);
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, reuseReader) {
+  char const bad[] = R"({ "nested": { "a": [1, 2 } })";
+  char const good[] = R"({ "lo\u006Eg name": { "x": "\"y\"" },
+                          "long member name": { "\u00e9": 1 } })";
+  Json::CharReaderBuilder b;
+  CharReaderPtr fresh(b.newCharReader());
+  Json::Value expected;
+  JSONTEST_ASSERT(fresh->parse(good, good + std::strlen(good), &expected,
+                               nullptr));
+
+  Json::CharReader& reader = Json::threadLocalCharReader(b);
+  JSONTEST_ASSERT(&reader == &Json::threadLocalCharReader(b));
+  Json::Value root;
+  Json::String errs;
+  JSONTEST_ASSERT(!reader.parse(bad, bad + std::strlen(bad), &root, &errs));
+  JSONTEST_ASSERT(!errs.empty());
+  // The errors and the stack of the failed parse are gone.
+  for (int i = 0; i < 2; ++i) {
+    Json::Value value;
+    JSONTEST_ASSERT(
+        reader.parse(good, good + std::strlen(good), &value, &errs));
+    JSONTEST_ASSERT_STRING_EQUAL("", errs);
+    JSONTEST_ASSERT_EQUAL(expected, value);
+  }
+  JSONTEST_ASSERT_STRING_EQUAL("\"y\"", expected["long name"]["x"].asString());
+
+  // Other settings make another reader.
+  b.settings_["allowNumericKeys"] = true;
+  char const numeric[] = "{ 1: { 2.5: true } }";
+  JSONTEST_ASSERT(Json::threadLocalCharReader(b).parse(
+      numeric, numeric + std::strlen(numeric), &root, &errs));
+  JSONTEST_ASSERT(root["1"]["2.5"].asBool());
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseWhitespaceRuns) {
+  // Runs of every length up to a few vector widths, ending at each offset.
+  const char pattern[] = " \t\r\n    \n\t  ";
+  Json::String doc = "[";
+  for (int length = 0; length < 80; ++length) {
+    for (int i = 0; i < length; ++i)
+      doc += pattern[(i * 7 + length) % (sizeof(pattern) - 1)];
+    doc += std::to_string(length) + ",";
+  }
+  doc += "\vnull]";
+  Json::CharReaderBuilder b;
+  b.settings_["collectOffsets"] = true;
+  CharReaderPtr reader(b.newCharReader());
+  Json::Value root;
+  Json::String errs;
+  JSONTEST_ASSERT(!reader->parse(doc.data(), doc.data() + doc.size(), &root,
+                                 &errs));
+  JSONTEST_ASSERT(errs.find("Syntax error: value, object or array expected.") !=
+                  Json::String::npos);
+  doc[doc.size() - 6] = ' ';
+  doc.append(100, '\n');
+  JSONTEST_ASSERT(reader->parse(doc.data(), doc.data() + doc.size(), &root,
+                                &errs));
+  JSONTEST_ASSERT_EQUAL(81, root.size());
+  for (int length = 0; length < 80; ++length) {
+    JSONTEST_ASSERT_EQUAL(length, root[length].asInt());
+    JSONTEST_ASSERT_EQUAL(std::to_string(length),
+                          doc.substr(size_t(root[length].getOffsetStart()),
+                                     size_t(root[length].getOffsetLimit() -
+                                            root[length].getOffsetStart())));
+  }
+  JSONTEST_ASSERT(root[80].isNull());
+
+  Json::Reader oldReader;
+  Json::Value oldRoot;
+  JSONTEST_ASSERT(
+      oldReader.parse(doc.data(), doc.data() + doc.size(), oldRoot));
+  JSONTEST_ASSERT_EQUAL(root, oldRoot);
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseLongStrings) {
+  // Escapes and quotes at every offset of a few vector widths.
+  const char* const escapes[][2] = {{"\\\"", "\""},
+                                    {"\\\\", "\\"},
+                                    {"\\n", "\n"},
+                                    {"\\u00e9", "\xC3\xA9"},
+                                    {"\\ud83d\\ude00", "\xF0\x9F\x98\x80"}};
+  Json::String doc = "[";
+  std::vector<Json::String> expected;
+  for (int offset = 0; offset < 70; ++offset) {
+    for (const auto& escape : escapes) {
+      const Json::String before(size_t(offset), 'a');
+      const Json::String after(size_t(70 - offset), 'b');
+      doc += "\"" + before + escape[0] + after + "\",";
+      expected.push_back(before + escape[1] + after);
+    }
+    doc += "\"" + Json::String(size_t(offset), '/') + "\",";
+    expected.push_back(Json::String(size_t(offset), '/'));
+  }
+  doc += "\"\"]";
+  expected.push_back("");
+
+  for (bool borrow : {false, true}) {
+    Json::CharReaderBuilder b;
+    b.settings_["borrowStrings"] = borrow;
+    CharReaderPtr reader(b.newCharReader());
+    Json::Value root;
+    Json::String errs;
+    JSONTEST_ASSERT(reader->parse(doc.data(), doc.data() + doc.size(), &root,
+                                  &errs))
+        << errs;
+    JSONTEST_ASSERT_EQUAL(expected.size(), root.size());
+    for (Json::ArrayIndex i = 0; i < root.size(); ++i)
+      JSONTEST_ASSERT_STRING_EQUAL(expected[i], root[i].asString());
+  }
+  Json::Reader oldReader;
+  Json::Value oldRoot;
+  JSONTEST_ASSERT(
+      oldReader.parse(doc.data(), doc.data() + doc.size(), oldRoot));
+  JSONTEST_ASSERT_EQUAL(expected.size(), oldRoot.size());
+  for (Json::ArrayIndex i = 0; i < oldRoot.size(); ++i)
+    JSONTEST_ASSERT_STRING_EQUAL(expected[i], oldRoot[i].asString());
+
+  Json::CharReaderBuilder b;
+  b.settings_["allowSingleQuotes"] = true;
+  b.settings_["borrowStrings"] = true;
+  CharReaderPtr reader(b.newCharReader());
+  char const quoted[] = R"({ 'a "quoted" word, a long one' : 'a\tb' })";
+  Json::Value root;
+  JSONTEST_ASSERT(reader->parse(quoted, quoted + std::strlen(quoted), &root,
+                                nullptr));
+  JSONTEST_ASSERT_STRING_EQUAL("a\tb", root.begin()->asString());
+
+  char const unterminated[] = "[ \"a string which runs into the end \\";
+  JSONTEST_ASSERT(!reader->parse(
+      unterminated, unterminated + std::strlen(unterminated), &root, nullptr));
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseStream) {
+  // Tokens, comments and line breaks straddle the block boundaries for
+  // small blocks; the result must not depend on where they fall.
+  const Json::String doc =
+      "\xEF\xBB\xBF// leading\r\n"
+      "{ \"name\" : \"a \\\"quoted\\\" \\u00e9 string\", // same line\r\n"
+      "  \"numbers\" : [ 1, -2.5e-3, 12345678901234567890, -Infinity ],\n"
+      "  /* block\n comment */ \"nested\" : { \"t\" : true, \"f\" : false,"
+      " \"n\" : null }\n"
+      "} // trailing\n";
+  const Json::String bad = "[ \"padding the document past a few blocks\",\r\n"
+                           "  1, 2, 3,\r\n  { \"a\" 3 } ]";
+  Json::CharReaderBuilder b;
+  b.settings_["allowSpecialFloats"] = true;
+  b.settings_["collectOffsets"] = true;
+  CharReaderPtr reader(b.newCharReader());
+  Json::Value expected;
+  Json::String errs;
+  JSONTEST_ASSERT(
+      reader->parse(doc.data(), doc.data() + doc.size(), &expected, &errs));
+  JSONTEST_ASSERT(expected["numbers"][3].getOffsetStart() > 0);
+  Json::Value unused;
+  Json::String expectedErrs;
+  JSONTEST_ASSERT(!reader->parse(bad.data(), bad.data() + bad.size(), &unused,
+                                 &expectedErrs));
+  JSONTEST_ASSERT_STRING_EQUAL("* Line 3, Column 9\n"
+                               "  Missing ':' after object member name\n",
+                               expectedErrs);
+
+  for (int blockSize : {1, 2, 3, 5, 8, 13, 65536}) {
+    b.settings_["streamBlockSize"] = blockSize;
+    CharReaderPtr streamReader(b.newCharReader());
+    Json::Value root;
+    std::istringstream in(doc);
+    JSONTEST_ASSERT(streamReader->parseStream(in, &root, &errs));
+    JSONTEST_ASSERT(errs.empty());
+    JSONTEST_ASSERT_EQUAL(expected, root);
+    JSONTEST_ASSERT_STRING_EQUAL(expected.toStyledString(),
+                                 root.toStyledString());
+    JSONTEST_ASSERT_EQUAL(expected["numbers"][3].getOffsetStart(),
+                          root["numbers"][3].getOffsetStart());
+    JSONTEST_ASSERT_EQUAL(expected["nested"].getOffsetLimit(),
+                          root["nested"].getOffsetLimit());
+
+    std::istringstream badIn(bad);
+    JSONTEST_ASSERT(!streamReader->parseStream(badIn, &root, &errs));
+    JSONTEST_ASSERT_STRING_EQUAL(expectedErrs, errs);
+
+    // The text after the document is left in the stream.
+    std::istringstream twoDocs("{ \"a\" : 1 } // one\n[ 2 ] \"rest\"");
+    JSONTEST_ASSERT(streamReader->parseStream(twoDocs, &root, &errs));
+    JSONTEST_ASSERT_EQUAL(1, root["a"].asInt());
+    JSONTEST_ASSERT(streamReader->parseStream(twoDocs, &root, &errs));
+    JSONTEST_ASSERT_EQUAL(2, root[0].asInt());
+    Json::String rest;
+    JSONTEST_ASSERT(std::getline(twoDocs, rest));
+    JSONTEST_ASSERT_STRING_EQUAL("\"rest\"", rest);
+
+    // A stream which cannot seek keeps them, but is left usable.
+    struct Unseekable : std::streambuf {
+      explicit Unseekable(Json::String& text) {
+        setg(&text[0], &text[0], &text[0] + text.size());
+      }
+    };
+    Json::String text = "[ 1 ] [ 2 ]";
+    Unseekable buffer(text);
+    std::istream pipe(&buffer);
+    JSONTEST_ASSERT(streamReader->parseStream(pipe, &root, &errs));
+    JSONTEST_ASSERT_EQUAL(1, root[0].asInt());
+    JSONTEST_ASSERT(!pipe.fail());
+    JSONTEST_ASSERT(pipe.eof());
+  }
+
+  std::istringstream in(doc);
+  JSONTEST_ASSERT(Json::parseFromStream(b, in, &unused, &errs));
+  JSONTEST_ASSERT_EQUAL(expected, unused);
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseStreamLongTokens) {
+  // Strings, numbers and comments far longer than a block are read on
+  // where each block stops, rather than scanned again from their start.
+  Json::String text(100000, 'x');
+  for (size_t i = 0; i < text.size(); i += 997)
+    text.replace(i, 2, "\\\"");
+  const Json::String digits(50000, '7');
+  const Json::String doc = "/*" + Json::String(30000, '*') + "*/\n" +
+                           "[ \"" + text + "\", '" + text + "',\n" +
+                           "  0." + digits + "e-1, -" + digits + ".5e-49990, " +
+                           digits + "E-49999 // " + text + "\n]";
+  Json::CharReaderBuilder b;
+  b.settings_["allowSingleQuotes"] = true;
+  CharReaderPtr reader(b.newCharReader());
+  Json::Value expected;
+  Json::String errs;
+  JSONTEST_ASSERT(
+      reader->parse(doc.data(), doc.data() + doc.size(), &expected, &errs));
+  JSONTEST_ASSERT_EQUAL(5u, expected.size());
+
+  for (int blockSize : {7, 64, 4096}) {
+    b.settings_["streamBlockSize"] = blockSize;
+    CharReaderPtr streamReader(b.newCharReader());
+    Json::Value root;
+    std::istringstream in(doc);
+    JSONTEST_ASSERT(streamReader->parseStream(in, &root, &errs));
+    JSONTEST_ASSERT(errs.empty());
+    JSONTEST_ASSERT_EQUAL(expected, root);
+    JSONTEST_ASSERT_STRING_EQUAL(expected.toStyledString(),
+                                 root.toStyledString());
+
+    std::istringstream unterminated("[ \"" + text);
+    JSONTEST_ASSERT(!streamReader->parseStream(unterminated, &root, &errs));
+  }
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseFromFile) {
+  const char* const path = "jsoncpp_test_parseFromFile.json";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << R"({ "name" : "mapped", "values" : [ 1, 2, 3 ] })";
+  }
+  Json::CharReaderBuilder b;
+  Json::Value root;
+  Json::String errs;
+  JSONTEST_ASSERT(Json::parseFromFile(b, path, &root, &errs));
+  JSONTEST_ASSERT(errs.empty());
+  JSONTEST_ASSERT_STRING_EQUAL("mapped", root["name"].asString());
+  JSONTEST_ASSERT_EQUAL(3, root["values"][2].asInt());
+
+  // Strings borrowed from the file stay valid while it is open.
+  Json::MappedFile file;
+  JSONTEST_ASSERT(file.open(path, &errs));
+#if defined(__unix__) || defined(__APPLE__)
+  JSONTEST_ASSERT(file.isMapped());
+#endif
+  b.settings_["borrowStrings"] = true;
+  CharReaderPtr reader(b.newCharReader());
+  JSONTEST_ASSERT(reader->parse(file.begin(), file.end(), &root, &errs));
+  char const* begin = nullptr;
+  char const* end = nullptr;
+  JSONTEST_ASSERT(root["name"].getString(&begin, &end));
+  JSONTEST_ASSERT(begin >= file.begin() && end <= file.end());
+  JSONTEST_ASSERT_STRING_EQUAL("mapped", root["name"].asString());
+  file.close();
+  JSONTEST_ASSERT(file.begin() == file.end());
+
+  // So do lazy values, given the file to keep open.
+  b.settings_["lazy"] = true;
+  JSONTEST_ASSERT(reader->refersToDocument());
+  JSONTEST_ASSERT(Json::parseFromFile(b, path, &file, &root, &errs));
+  JSONTEST_ASSERT(root["name"].getString(&begin, &end));
+  JSONTEST_ASSERT(begin >= file.begin() && end <= file.end());
+  JSONTEST_ASSERT_EQUAL(3, root["values"][2].asInt());
+
+  // Without it, parseFromFile() refuses rather than leave values referring
+  // to the closed file.
+  JSONTEST_ASSERT(!Json::parseFromFile(b, path, &root, &errs));
+  JSONTEST_ASSERT(errs.find("MappedFile") != Json::String::npos);
+  b.settings_["borrowStrings"] = false;
+  JSONTEST_ASSERT(!Json::parseFromFile(b, path, &root, &errs));
+  b.settings_["lazy"] = false;
+  JSONTEST_ASSERT(Json::parseFromFile(b, path, &root, &errs));
+  JSONTEST_ASSERT_STRING_EQUAL("mapped", root["name"].asString());
+  file.close();
+  std::remove(path);
+
+  JSONTEST_ASSERT(!Json::parseFromFile(b, path, &root, &errs));
+  JSONTEST_ASSERT(errs.find(path) != Json::String::npos);
+  JSONTEST_ASSERT(!file.open(path, nullptr));
+
+#if defined(__unix__) || defined(__APPLE__)
+  // A FIFO is read through the one descriptor opened for it.
+  const char* const fifo = "jsoncpp_test_parseFromFile.fifo";
+  std::remove(fifo);
+  JSONTEST_ASSERT(mkfifo(fifo, 0600) == 0);
+  std::thread writer([fifo] {
+    std::ofstream out(fifo, std::ios::binary);
+    out << "[ 1, 2 ]";
+  });
+  const bool ok = Json::parseFromFile(b, fifo, &root, &errs);
+  writer.join();
+  std::remove(fifo);
+  JSONTEST_ASSERT(ok);
+  JSONTEST_ASSERT_EQUAL(2, root[1].asInt());
+#endif
+}
+
+JSONTEST_FIXTURE_LOCAL(CharReaderTest, parseNdjson) {
+  // Every 100th record is broken; blank lines and DOS EOLs are tolerated.
+  const int count = 1000;
+  Json::String doc;
+  for (int i = 0; i < count; ++i) {
+    if (i % 100 == 42)
+      doc += "{ \"id\" : " + std::to_string(i) + ", }\r\n";
+    else
+      doc += "{ \"id\" : " + std::to_string(i) + " }\n";
+    if (i % 250 == 0)
+      doc += "  \n";
+  }
+  Json::CharReaderBuilder b;
+  b.settings_["allowTrailingCommas"] = false;
+
+  for (unsigned threads : {1U, 4U}) {
+    Json::NdjsonReader reader(b, threads);
+    std::vector<Json::NdjsonReader::Record> records;
+    JSONTEST_ASSERT(
+        !reader.parse(doc.data(), doc.data() + doc.size(), &records));
+    JSONTEST_ASSERT_EQUAL(count, records.size());
+    size_t line = 0;
+    for (int i = 0; i < count; ++i) {
+      const Json::NdjsonReader::Record& record = records[size_t(i)];
+      line += 1 + (i % 250 == 1);
+      JSONTEST_ASSERT_EQUAL(line, record.line);
+      if (i % 100 == 42) {
+        JSONTEST_ASSERT_EQUAL(1, record.errors.size());
+        JSONTEST_ASSERT_EQUAL(13 + (i >= 100), record.errors[0].offset_start);
+        JSONTEST_ASSERT_STRING_EQUAL("Missing '}' or object member name",
+                                     record.errors[0].message);
+      } else {
+        JSONTEST_ASSERT(record.errors.empty());
+        JSONTEST_ASSERT_EQUAL(i, record.value["id"].asInt());
+      }
+    }
+
+    std::vector<int> seen(count);
+    JSONTEST_ASSERT(!reader.parse(doc.data(), doc.data() + doc.size(),
+                                  [&](Json::NdjsonReader::Record& record) {
+                                    if (record.errors.empty())
+                                      ++seen[record.value["id"].asUInt()];
+                                  }));
+    for (int i = 0; i < count; ++i)
+      JSONTEST_ASSERT_EQUAL(i % 100 == 42 ? 0 : 1, seen[size_t(i)]);
+
+    JSONTEST_ASSERT_THROWS(reader.parse(
+        doc.data(), doc.data() + doc.size(),
+        [](Json::NdjsonReader::Record&) { throw std::runtime_error("stop"); }));
+  }
+
+  // Exceptions of the reader are reported as errors of their line.
+  b.settings_["stackLimit"] = 2;
+  Json::NdjsonReader reader(b, 2);
+  const Json::String nested = "[1]\n[[[1]]]\n";
+  std::vector<Json::NdjsonReader::Record> records;
+  JSONTEST_ASSERT(
+      !reader.parse(nested.data(), nested.data() + nested.size(), &records));
+  JSONTEST_ASSERT_EQUAL(2, records.size());
+  JSONTEST_ASSERT(records[0].errors.empty());
+  JSONTEST_ASSERT_STRING_EQUAL("Exceeded stackLimit in readValue().",
+                               records[1].errors[0].message);
 }
 
 JSONTEST_FIXTURE_LOCAL(CharReaderTest, testOperator) {
@@ -3891,6 +5665,101 @@ JSONTEST_FIXTURE_LOCAL(RValueTest, moveConstruction) {
   JSONTEST_ASSERT_EQUAL(Json::stringValue, moved["key"].type());
 }
 
+struct SerializerTest : JsonTest::TestCase {};
+
+namespace {
+struct SerializedItem {
+  int id = 0;
+  std::string name = "unnamed";
+  void Serialize(JsonSerializer& s) {
+    s.SerializeNVP(id);
+    s.SerializeNVP(name);
+  }
+};
+
+struct SerializedRecord {
+  SerializedItem item;
+  std::vector<SerializedItem> items;
+  std::map<std::string, int> counts;
+  double ratio = 0.5;
+  unsigned long long total = 0;
+  void Serialize(JsonSerializer& s) {
+    s.SerializeNVP(item);
+    s.SerializeNVP(items);
+    s.SerializeNVP(counts);
+    s.SerializeNVP(ratio);
+    s.SerializeNVP(total);
+  }
+};
+} // namespace
+
+JSONTEST_FIXTURE_LOCAL(SerializerTest, roundTrip) {
+  SerializedRecord record;
+  record.item.id = 1;
+  record.item.name = "one";
+  record.items.resize(2);
+  record.items[0].id = 2;
+  record.items[1].name = "three";
+  record.counts["a"] = 4;
+  record.counts["b"] = 5;
+  record.ratio = 0.25;
+  record.total = 5000000000ULL;
+
+  JsonSerializer writer(SerializerMode::Writer);
+  record.Serialize(writer);
+  const Json::Value& json = writer.JsonValue;
+  JSONTEST_ASSERT_EQUAL(1, json["item"]["id"]);
+  JSONTEST_ASSERT_EQUAL("one", json["item"]["name"]);
+  JSONTEST_ASSERT_EQUAL(2u, json["items"].size());
+  JSONTEST_ASSERT_EQUAL(2, json["items"][0]["id"]);
+  JSONTEST_ASSERT_EQUAL("three", json["items"][1]["name"]);
+  JSONTEST_ASSERT_EQUAL(4, json["counts"]["a"]);
+  JSONTEST_ASSERT_EQUAL(5, json["counts"]["b"]);
+  JSONTEST_ASSERT_EQUAL(0.25, json["ratio"]);
+  JSONTEST_ASSERT_EQUAL(Json::UInt64(5000000000ULL), json["total"].asUInt64());
+
+  JsonSerializer reader(false, json);
+  SerializedRecord copy;
+  copy.Serialize(reader);
+  JSONTEST_ASSERT_EQUAL(1, copy.item.id);
+  JSONTEST_ASSERT_STRING_EQUAL("one", copy.item.name);
+  JSONTEST_ASSERT_EQUAL(2u, copy.items.size());
+  JSONTEST_ASSERT_EQUAL(2, copy.items[0].id);
+  JSONTEST_ASSERT_STRING_EQUAL("unnamed", copy.items[0].name);
+  JSONTEST_ASSERT_EQUAL(0, copy.items[1].id);
+  JSONTEST_ASSERT_STRING_EQUAL("three", copy.items[1].name);
+  JSONTEST_ASSERT(copy.counts == record.counts);
+  JSONTEST_ASSERT_EQUAL(0.25, copy.ratio);
+  JSONTEST_ASSERT_EQUAL(record.total, copy.total);
+  JSONTEST_ASSERT_EQUAL(json, reader.JsonValue);
+}
+
+JSONTEST_FIXTURE_LOCAL(SerializerTest, readLeavesSourceUnchanged) {
+  Json::Value source;
+  source["item"]["id"] = 7;
+  source["items"][0]["name"] = "only";
+  source["counts"] = Json::objectValue;
+  const Json::Value original = source;
+
+  JsonSerializer reader(false, source);
+  SerializedRecord record;
+  record.counts["stale"] = 1;
+  record.Serialize(reader);
+
+  // Missing keys keep their defaults and are not added to the source.
+  const Json::Value& read = reader.JsonValue;
+  JSONTEST_ASSERT_EQUAL(original, read);
+  JSONTEST_ASSERT(!read["item"].isMember("name"));
+  JSONTEST_ASSERT(!read.isMember("ratio"));
+  JSONTEST_ASSERT_EQUAL(7, record.item.id);
+  JSONTEST_ASSERT_STRING_EQUAL("unnamed", record.item.name);
+  JSONTEST_ASSERT_EQUAL(1u, record.items.size());
+  JSONTEST_ASSERT_EQUAL(0, record.items[0].id);
+  JSONTEST_ASSERT_STRING_EQUAL("only", record.items[0].name);
+  JSONTEST_ASSERT(record.counts.empty());
+  JSONTEST_ASSERT_EQUAL(0.5, record.ratio);
+}
+
 struct FuzzTest : JsonTest::TestCase {};
 
 // Build and run the fuzz test without any fuzzer, so that it's guaranteed not